@@ -9,13 +9,17 @@ set "LIB_FLAGS=-L"%LIB_DIR%""
 set "LIBS=-lraylib -lm -lgdi32 -lwinmm -lole32 -luuid -lmfplat -lmfreadwrite -lmfuuid -lshlwapi"
 
 echo Building desktop_app...
-gcc main.c win_clipboard.c win_video.c -o desktop_app %COMMON_FLAGS% %INCLUDE_FLAGS% %LIB_FLAGS% %LIBS%
+gcc main.c pixel_store.c job_queue.c scene.c scene_index.c scene_tiles.c drawing_shape.c text_layout.c text_buffer.c win_clipboard.c win_video.c -o desktop_app %COMMON_FLAGS% %INCLUDE_FLAGS% %LIB_FLAGS% %LIBS%
 if errorlevel 1 goto :error
 
 echo Building video_probe...
 gcc video_probe.c win_video.c -o video_probe %COMMON_FLAGS% %INCLUDE_FLAGS% %LIB_FLAGS% %LIBS%
 if errorlevel 1 goto :error
 
+echo Building scene_bench...
+gcc scene_bench.c scene.c scene_index.c -o scene_bench -O2 %COMMON_FLAGS% %INCLUDE_FLAGS% %LIB_FLAGS% %LIBS%
+if errorlevel 1 goto :error
+
 echo Build complete.
 endlocal
 exit /b 0
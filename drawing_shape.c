@@ -0,0 +1,587 @@
+#include "drawing_shape.h"
+#include "rlgl.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Ellipse tessellation bounds, in segments per outline. */
+#define DRAWING_SHAPE_MIN_SEGMENTS 24
+#define DRAWING_SHAPE_MAX_SEGMENTS 512
+/* Upper bound on a journaled point count, to reject corrupt records. */
+#define DRAWING_SHAPE_MAX_POINTS (1 << 24)
+/* Triangles per half turn of a round cap or join. */
+#define DRAWING_SHAPE_ROUND_SEGMENTS 12
+/* Joins turning less than this (as a direction cosine) between segments at
+   least a stroke radius long are mitred; the rest get a round join, which stays
+   correct for reversals and for segments too short to hold a miter. */
+#define DRAWING_SHAPE_MITER_COS 0.95f
+/* Vertices handed to rlgl per rlBegin block, well under its batch size. */
+#define DRAWING_SHAPE_EMIT_CHUNK (3 * 1024)
+
+/* Rectangle and ellipse outlines are shaded analytically from a signed distance
+   over the box quad. fragTexCoord carries the position relative to the box
+   centre in world units. The outline's outer edge is the box edge, so a
+   pixel-aligned box gets crisp full-coverage edges. */
+static const char* DRAWING_SHAPE_OUTLINE_FS =
+    "#version 330\n"
+    "in vec2 fragTexCoord;\n"
+    "in vec4 fragColor;\n"
+    "uniform vec2 halfSize;\n"
+    "uniform float strokeWidth;\n"
+    "uniform int ellipse;\n"
+    "out vec4 finalColor;\n"
+    "float BoxDistance(vec2 p, vec2 b) {\n"
+    "    vec2 d = abs(p) - b;\n"
+    "    return length(max(d, 0.0)) + min(max(d.x, d.y), 0.0);\n"
+    "}\n"
+    "float EllipseDistance(vec2 p, vec2 r) {\n"
+    "    float k0 = length(p / r);\n"
+    "    float k1 = length(p / (r * r));\n"
+    "    return (k1 > 0.0) ? k0 * (k0 - 1.0) / k1 : -min(r.x, r.y);\n"
+    "}\n"
+    "void main() {\n"
+    "    float px = max(length(fwidth(fragTexCoord)) * 0.7071, 1e-4);\n"
+    "    vec2 outer = max(halfSize, vec2(1e-3));\n"
+    "    float d = (ellipse != 0) ? EllipseDistance(fragTexCoord, outer) : BoxDistance(fragTexCoord, outer);\n"
+    "    float ring = abs(d + 0.5 * strokeWidth) - 0.5 * strokeWidth;\n"
+    "    finalColor = vec4(fragColor.rgb, fragColor.a * clamp(0.5 - ring / px, 0.0, 1.0));\n"
+    "}\n";
+
+static Shader gOutlineShader = {0};
+static int gOutlineShaderState = 0;     /* 0 not loaded yet, 1 ready, -1 unavailable */
+static int gOutlineHalfSizeLoc = -1;
+static int gOutlineStrokeWidthLoc = -1;
+static int gOutlineEllipseLoc = -1;
+
+struct DrawingShape {
+    int refCount;
+    ShapeKind kind;
+    Color color;
+    float thickness;
+    float baseWidth;
+    float baseHeight;
+    /* Stroke tessellation, box-local, for the box size it was built at. */
+    Vector2* mesh;
+    int meshCount;
+    int meshCapacity;
+    float meshWidth;
+    float meshHeight;
+    int pointCount;
+    Vector2 points[];
+};
+
+static DrawingShape* DrawingShape_Alloc(int pointCount) {
+    DrawingShape* shape = (DrawingShape*)malloc(sizeof(DrawingShape) + (size_t)pointCount * sizeof(Vector2));
+    if (shape != NULL) {
+        memset(shape, 0, sizeof(DrawingShape));
+        shape->refCount = 1;
+        shape->pointCount = pointCount;
+    }
+    return shape;
+}
+
+DrawingShape* DrawingShape_Create(ShapeKind kind, Color color, float thickness,
+                                  float baseWidth, float baseHeight,
+                                  const Vector2* points, int pointCount) {
+    if (baseWidth <= 0.0f || baseHeight <= 0.0f || pointCount < 0 || (pointCount > 0 && points == NULL)) {
+        return NULL;
+    }
+
+    DrawingShape* shape = DrawingShape_Alloc(pointCount);
+    if (shape == NULL) {
+        return NULL;
+    }
+    shape->kind = kind;
+    shape->color = color;
+    shape->thickness = thickness;
+    shape->baseWidth = baseWidth;
+    shape->baseHeight = baseHeight;
+    if (pointCount > 0) {
+        memcpy(shape->points, points, (size_t)pointCount * sizeof(Vector2));
+    }
+    return shape;
+}
+
+DrawingShape* DrawingShape_Retain(DrawingShape* shape) {
+    if (shape != NULL) {
+        shape->refCount++;
+    }
+    return shape;
+}
+
+void DrawingShape_Release(DrawingShape* shape) {
+    if (shape != NULL && --shape->refCount <= 0) {
+        free(shape->mesh);
+        free(shape);
+    }
+}
+
+size_t DrawingShape_GetByteCount(const DrawingShape* shape) {
+    if (shape == NULL) {
+        return 0;
+    }
+    return sizeof(DrawingShape) + (size_t)shape->pointCount * sizeof(Vector2);
+}
+
+static int DrawingShape_GrowPoints(Vector2** points, int* capacity, int required) {
+    if (required <= *capacity) {
+        return 1;
+    }
+    int newCapacity = (*capacity > 0) ? *capacity : 256;
+    while (newCapacity < required) {
+        newCapacity *= 2;
+    }
+    Vector2* grown = (Vector2*)realloc(*points, (size_t)newCapacity * sizeof(Vector2));
+    if (grown == NULL) {
+        return 0;
+    }
+    *points = grown;
+    *capacity = newCapacity;
+    return 1;
+}
+
+/* Appends a triangle wound the way rlgl treats as front-facing, so backface
+   culling never drops part of a stroke that folds over itself. */
+static void DrawingShape_AddTriangle(DrawingShape* shape, Vector2 a, Vector2 b, Vector2 c) {
+    if (!DrawingShape_GrowPoints(&shape->mesh, &shape->meshCapacity, shape->meshCount + 3)) {
+        return;
+    }
+    float cross = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    Vector2* out = &shape->mesh[shape->meshCount];
+    out[0] = a;
+    out[1] = (cross <= 0.0f) ? b : c;
+    out[2] = (cross <= 0.0f) ? c : b;
+    shape->meshCount += 3;
+}
+
+/* Fan around center from direction `from`, turning by sweep radians. */
+static void DrawingShape_AddArc(DrawingShape* shape, Vector2 center, Vector2 from, float sweep, float radius) {
+    int steps = (int)ceilf(fabsf(sweep) / PI * DRAWING_SHAPE_ROUND_SEGMENTS);
+    if (steps < 1) {
+        steps = 1;
+    }
+    Vector2 prev = {center.x + from.x * radius, center.y + from.y * radius};
+    for (int i = 1; i <= steps; i++) {
+        float angle = sweep * (float)i / (float)steps;
+        float c = cosf(angle);
+        float s = sinf(angle);
+        Vector2 dir = {from.x * c - from.y * s, from.x * s + from.y * c};
+        Vector2 next = {center.x + dir.x * radius, center.y + dir.y * radius};
+        DrawingShape_AddTriangle(shape, center, prev, next);
+        prev = next;
+    }
+}
+
+/* Quad between two cross sections of the stroke. */
+static void DrawingShape_AddSpan(DrawingShape* shape, Vector2 p, Vector2 pOffset, Vector2 q, Vector2 qOffset) {
+    Vector2 pl = {p.x + pOffset.x, p.y + pOffset.y};
+    Vector2 pr = {p.x - pOffset.x, p.y - pOffset.y};
+    Vector2 ql = {q.x + qOffset.x, q.y + qOffset.y};
+    Vector2 qr = {q.x - qOffset.x, q.y - qOffset.y};
+    DrawingShape_AddTriangle(shape, pl, pr, ql);
+    DrawingShape_AddTriangle(shape, pr, ql, qr);
+}
+
+/* Tessellates the polyline for a dest of width x height: a strip of quads with
+   mitred gentle joins, round sharp joins and round caps. */
+static void DrawingShape_BuildStrokeMesh(DrawingShape* shape, float width, float height) {
+    shape->meshCount = 0;
+    shape->meshWidth = width;
+    shape->meshHeight = height;
+
+    float scaleX = width / shape->baseWidth;
+    float scaleY = height / shape->baseHeight;
+    float radius = shape->thickness * 0.5f;
+
+    /* Scaled points with repeats dropped, so every segment has a direction. */
+    Vector2* path = (Vector2*)malloc((size_t)shape->pointCount * sizeof(Vector2));
+    if (path == NULL) {
+        return;
+    }
+    int count = 0;
+    for (int i = 0; i < shape->pointCount; i++) {
+        Vector2 p = {shape->points[i].x * scaleX, shape->points[i].y * scaleY};
+        if (count > 0 && fabsf(p.x - path[count - 1].x) < 1.0e-4f && fabsf(p.y - path[count - 1].y) < 1.0e-4f) {
+            continue;
+        }
+        path[count++] = p;
+    }
+
+    if (count == 1) {
+        DrawingShape_AddArc(shape, path[0], (Vector2){1.0f, 0.0f}, 2.0f * PI, radius);
+        free(path);
+        return;
+    }
+
+    Vector2 dir = {0};
+    Vector2 normal = {0};
+    float prevLength = 0.0f;
+    Vector2 spanStart = path[0];
+    Vector2 spanOffset = {0};
+    for (int i = 0; i + 1 < count; i++) {
+        float dx = path[i + 1].x - path[i].x;
+        float dy = path[i + 1].y - path[i].y;
+        float length = sqrtf(dx * dx + dy * dy);
+        Vector2 nextDir = {dx / length, dy / length};
+        Vector2 nextNormal = {-nextDir.y, nextDir.x};
+
+        if (i == 0) {
+            /* Start cap: half turn from the normal round the back of the stroke. */
+            DrawingShape_AddArc(shape, path[0], nextNormal, PI, radius);
+            spanOffset = (Vector2){nextNormal.x * radius, nextNormal.y * radius};
+        } else {
+            float turnCos = dir.x * nextDir.x + dir.y * nextDir.y;
+            if (turnCos >= DRAWING_SHAPE_MITER_COS && prevLength >= radius && length >= radius) {
+                Vector2 miter = {normal.x + nextNormal.x, normal.y + nextNormal.y};
+                float miterLength = sqrtf(miter.x * miter.x + miter.y * miter.y);
+                miter.x /= miterLength;
+                miter.y /= miterLength;
+                float scale = radius / (miter.x * nextNormal.x + miter.y * nextNormal.y);
+                Vector2 offset = {miter.x * scale, miter.y * scale};
+                DrawingShape_AddSpan(shape, spanStart, spanOffset, path[i], offset);
+                spanOffset = offset;
+            } else {
+                Vector2 endOffset = {normal.x * radius, normal.y * radius};
+                DrawingShape_AddSpan(shape, spanStart, spanOffset, path[i], endOffset);
+                /* Fill the outer side of the corner; the inner side overlaps. */
+                float turn = dir.x * nextDir.y - dir.y * nextDir.x;
+                float side = (turn > 0.0f) ? -1.0f : 1.0f;
+                Vector2 outerFrom = {normal.x * side, normal.y * side};
+                /* Rotate through the forward direction, which also settles a full reversal. */
+                float sweep = -side * acosf(fmaxf(-1.0f, fminf(1.0f, turnCos)));
+                DrawingShape_AddArc(shape, path[i], outerFrom, sweep, radius);
+                spanOffset = (Vector2){nextNormal.x * radius, nextNormal.y * radius};
+            }
+            spanStart = path[i];
+        }
+        dir = nextDir;
+        normal = nextNormal;
+        prevLength = length;
+    }
+
+    Vector2 end = path[count - 1];
+    Vector2 endOffset = {normal.x * radius, normal.y * radius};
+    DrawingShape_AddSpan(shape, spanStart, spanOffset, end, endOffset);
+    DrawingShape_AddArc(shape, end, (Vector2){-normal.x, -normal.y}, PI, radius);
+    free(path);
+}
+
+/* Sends the cached mesh, offset to origin. Consecutive rlBegin blocks in the
+   same mode and texture share one draw call. */
+static void DrawingShape_EmitMesh(const DrawingShape* shape, Vector2 origin) {
+    for (int first = 0; first < shape->meshCount; first += DRAWING_SHAPE_EMIT_CHUNK) {
+        int count = shape->meshCount - first;
+        if (count > DRAWING_SHAPE_EMIT_CHUNK) {
+            count = DRAWING_SHAPE_EMIT_CHUNK;
+        }
+        rlCheckRenderBatchLimit(count);
+        rlBegin(RL_TRIANGLES);
+        rlColor4ub(shape->color.r, shape->color.g, shape->color.b, shape->color.a);
+        for (int i = first; i < first + count; i++) {
+            rlVertex2f(origin.x + shape->mesh[i].x, origin.y + shape->mesh[i].y);
+        }
+        rlEnd();
+    }
+}
+
+/* Loaded on first use, since it needs the GL context. */
+static int DrawingShape_EnsureOutlineShader(void) {
+    if (gOutlineShaderState == 0) {
+        gOutlineShader = LoadShaderFromMemory(NULL, DRAWING_SHAPE_OUTLINE_FS);
+        if (gOutlineShader.id == 0 || gOutlineShader.id == rlGetShaderIdDefault()) {
+            TraceLog(LOG_WARNING, "Drawing shapes: outline shader unavailable, using tessellated outlines");
+            gOutlineShader = (Shader){0};
+            gOutlineShaderState = -1;
+        } else {
+            gOutlineHalfSizeLoc = GetShaderLocation(gOutlineShader, "halfSize");
+            gOutlineStrokeWidthLoc = GetShaderLocation(gOutlineShader, "strokeWidth");
+            gOutlineEllipseLoc = GetShaderLocation(gOutlineShader, "ellipse");
+            gOutlineShaderState = 1;
+        }
+    }
+    return gOutlineShaderState > 0;
+}
+
+/* One quad per outline; the uniforms change per shape, so each is its own batch. */
+static int DrawingShape_DrawOutline(const DrawingShape* shape, Rectangle dest) {
+    if (!DrawingShape_EnsureOutlineShader()) {
+        return 0;
+    }
+
+    Vector2 halfSize = {dest.width * 0.5f, dest.height * 0.5f};
+    int ellipse = (shape->kind == SHAPE_CIRCLE);
+    BeginShaderMode(gOutlineShader);
+    SetShaderValue(gOutlineShader, gOutlineHalfSizeLoc, &halfSize, SHADER_UNIFORM_VEC2);
+    SetShaderValue(gOutlineShader, gOutlineStrokeWidthLoc, &shape->thickness, SHADER_UNIFORM_FLOAT);
+    SetShaderValue(gOutlineShader, gOutlineEllipseLoc, &ellipse, SHADER_UNIFORM_INT);
+    rlBegin(RL_QUADS);
+    rlColor4ub(shape->color.r, shape->color.g, shape->color.b, shape->color.a);
+    rlTexCoord2f(-halfSize.x, -halfSize.y);
+    rlVertex2f(dest.x, dest.y);
+    rlTexCoord2f(-halfSize.x, halfSize.y);
+    rlVertex2f(dest.x, dest.y + dest.height);
+    rlTexCoord2f(halfSize.x, halfSize.y);
+    rlVertex2f(dest.x + dest.width, dest.y + dest.height);
+    rlTexCoord2f(halfSize.x, -halfSize.y);
+    rlVertex2f(dest.x + dest.width, dest.y);
+    rlEnd();
+    EndShaderMode();
+    return 1;
+}
+
+static void DrawingShape_DrawEllipse(Rectangle dest, float thickness, float pixelsPerUnit, Color color) {
+    /* Stroke centred inside the box so the outline stays within its bounds. */
+    float rx = fmaxf(0.0f, dest.width * 0.5f - thickness * 0.5f);
+    float ry = fmaxf(0.0f, dest.height * 0.5f - thickness * 0.5f);
+    Vector2 center = {dest.x + dest.width * 0.5f, dest.y + dest.height * 0.5f};
+
+    /* Roughly one segment per four screen pixels of outline. */
+    float perimeterPixels = 2.0f * PI * sqrtf((rx * rx + ry * ry) * 0.5f) * pixelsPerUnit;
+    int segments = (int)(perimeterPixels / 4.0f);
+    if (segments < DRAWING_SHAPE_MIN_SEGMENTS) segments = DRAWING_SHAPE_MIN_SEGMENTS;
+    if (segments > DRAWING_SHAPE_MAX_SEGMENTS) segments = DRAWING_SHAPE_MAX_SEGMENTS;
+
+    Vector2 outline[DRAWING_SHAPE_MAX_SEGMENTS];
+    for (int i = 0; i < segments; i++) {
+        float angle = 2.0f * PI * (float)i / (float)segments;
+        outline[i] = (Vector2){center.x + cosf(angle) * rx, center.y + sinf(angle) * ry};
+    }
+    for (int i = 0; i < segments; i++) {
+        DrawLineEx(outline[i], outline[(i + 1) % segments], thickness, color);
+    }
+}
+
+void DrawingShape_Draw(DrawingShape* shape, Rectangle dest, float pixelsPerUnit) {
+    if (shape == NULL || dest.width <= 0.0f || dest.height <= 0.0f) {
+        return;
+    }
+
+    switch (shape->kind) {
+        case SHAPE_RECT:
+            if (!DrawingShape_DrawOutline(shape, dest)) {
+                DrawRectangleLinesEx(dest, shape->thickness, shape->color);
+            }
+            break;
+        case SHAPE_CIRCLE:
+            if (!DrawingShape_DrawOutline(shape, dest)) {
+                DrawingShape_DrawEllipse(dest, shape->thickness, pixelsPerUnit, shape->color);
+            }
+            break;
+        case SHAPE_SEGMENT:
+        case SHAPE_PEN:
+            if (shape->pointCount <= 0) {
+                break;
+            }
+            if (shape->meshWidth != dest.width || shape->meshHeight != dest.height) {
+                DrawingShape_BuildStrokeMesh(shape, dest.width, dest.height);
+            }
+            DrawingShape_EmitMesh(shape, (Vector2){dest.x, dest.y});
+            break;
+        default:
+            break;
+    }
+}
+
+int DrawingShape_Write(const DrawingShape* shape, FILE* file) {
+    if (shape == NULL || file == NULL) {
+        return 0;
+    }
+    int header[2] = {(int)shape->kind, shape->pointCount};
+    float metrics[3] = {shape->thickness, shape->baseWidth, shape->baseHeight};
+    if (fwrite(header, sizeof(header), 1, file) != 1 ||
+        fwrite(&shape->color, sizeof(Color), 1, file) != 1 ||
+        fwrite(metrics, sizeof(metrics), 1, file) != 1) {
+        return 0;
+    }
+    return shape->pointCount == 0 ||
+           fwrite(shape->points, sizeof(Vector2), (size_t)shape->pointCount, file) == (size_t)shape->pointCount;
+}
+
+DrawingShape* DrawingShape_Read(FILE* file) {
+    if (file == NULL) {
+        return NULL;
+    }
+
+    int header[2] = {0};
+    Color color = {0};
+    float metrics[3] = {0};
+    if (fread(header, sizeof(header), 1, file) != 1 ||
+        fread(&color, sizeof(Color), 1, file) != 1 ||
+        fread(metrics, sizeof(metrics), 1, file) != 1 ||
+        header[1] < 0 || header[1] > DRAWING_SHAPE_MAX_POINTS ||
+        metrics[1] <= 0.0f || metrics[2] <= 0.0f) {
+        return NULL;
+    }
+
+    DrawingShape* shape = DrawingShape_Alloc(header[1]);
+    if (shape == NULL) {
+        return NULL;
+    }
+    shape->kind = (ShapeKind)header[0];
+    shape->color = color;
+    shape->thickness = metrics[0];
+    shape->baseWidth = metrics[1];
+    shape->baseHeight = metrics[2];
+    if (shape->pointCount > 0 &&
+        fread(shape->points, sizeof(Vector2), (size_t)shape->pointCount, file) != (size_t)shape->pointCount) {
+        free(shape);
+        return NULL;
+    }
+    return shape;
+}
+
+int DrawingShape_BeginStroke(PenStroke* stroke, Vector2 point) {
+    stroke->count = 0;
+    if (!DrawingShape_GrowPoints(&stroke->points, &stroke->capacity, 1)) {
+        return 0;
+    }
+    stroke->points[stroke->count++] = point;
+    stroke->minX = stroke->maxX = point.x;
+    stroke->minY = stroke->maxY = point.y;
+    return 1;
+}
+
+int DrawingShape_AppendStroke(PenStroke* stroke, Vector2 point, float minDistance) {
+    if (stroke->count <= 0) {
+        return 0;
+    }
+    Vector2 last = stroke->points[stroke->count - 1];
+    float dx = point.x - last.x;
+    float dy = point.y - last.y;
+    if (dx * dx + dy * dy < minDistance * minDistance ||
+        !DrawingShape_GrowPoints(&stroke->points, &stroke->capacity, stroke->count + 1)) {
+        return 0;
+    }
+    stroke->points[stroke->count++] = point;
+    if (point.x < stroke->minX) stroke->minX = point.x;
+    if (point.y < stroke->minY) stroke->minY = point.y;
+    if (point.x > stroke->maxX) stroke->maxX = point.x;
+    if (point.y > stroke->maxY) stroke->maxY = point.y;
+    return 1;
+}
+
+static float DrawingShape_SegmentDistanceSq(Vector2 p, Vector2 a, Vector2 b) {
+    float dx = b.x - a.x;
+    float dy = b.y - a.y;
+    float lengthSq = dx * dx + dy * dy;
+    float t = 0.0f;
+    if (lengthSq > 0.0f) {
+        t = ((p.x - a.x) * dx + (p.y - a.y) * dy) / lengthSq;
+        t = (t < 0.0f) ? 0.0f : (t > 1.0f) ? 1.0f : t;
+    }
+    float ex = p.x - (a.x + dx * t);
+    float ey = p.y - (a.y + dy * t);
+    return ex * ex + ey * ey;
+}
+
+/* Ramer-Douglas-Peucker with an explicit stack, since strokes are unbounded. */
+static void DrawingShape_Simplify(PenStroke* stroke, float tolerance) {
+    int count = stroke->count;
+    if (count < 3) {
+        return;
+    }
+    unsigned char* keep = (unsigned char*)calloc((size_t)count, 1);
+    int* stack = (int*)malloc((size_t)count * 2 * sizeof(int));
+    if (keep == NULL || stack == NULL) {
+        free(keep);
+        free(stack);
+        return;
+    }
+
+    float toleranceSq = tolerance * tolerance;
+    int top = 0;
+    keep[0] = 1;
+    keep[count - 1] = 1;
+    stack[top++] = 0;
+    stack[top++] = count - 1;
+    while (top > 0) {
+        int last = stack[--top];
+        int first = stack[--top];
+        float worstSq = 0.0f;
+        int worst = -1;
+        for (int i = first + 1; i < last; i++) {
+            float distSq = DrawingShape_SegmentDistanceSq(stroke->points[i], stroke->points[first], stroke->points[last]);
+            if (distSq > worstSq) {
+                worstSq = distSq;
+                worst = i;
+            }
+        }
+        if (worst >= 0 && worstSq > toleranceSq) {
+            keep[worst] = 1;
+            stack[top++] = first;
+            stack[top++] = worst;
+            stack[top++] = worst;
+            stack[top++] = last;
+        }
+    }
+
+    int kept = 0;
+    for (int i = 0; i < count; i++) {
+        if (keep[i]) {
+            stroke->points[kept++] = stroke->points[i];
+        }
+    }
+    stroke->count = kept;
+    free(keep);
+    free(stack);
+}
+
+/* One round of Chaikin corner cutting; the end points stay where they are. */
+static void DrawingShape_Smooth(PenStroke* stroke) {
+    int count = stroke->count;
+    if (count < 3) {
+        return;
+    }
+    int smoothedCount = 2 * (count - 1) + 2;
+    Vector2* smoothed = (Vector2*)malloc((size_t)smoothedCount * sizeof(Vector2));
+    if (smoothed == NULL) {
+        return;
+    }
+    int out = 0;
+    smoothed[out++] = stroke->points[0];
+    for (int i = 0; i + 1 < count; i++) {
+        Vector2 a = stroke->points[i];
+        Vector2 b = stroke->points[i + 1];
+        smoothed[out++] = (Vector2){a.x * 0.75f + b.x * 0.25f, a.y * 0.75f + b.y * 0.25f};
+        smoothed[out++] = (Vector2){a.x * 0.25f + b.x * 0.75f, a.y * 0.25f + b.y * 0.75f};
+    }
+    smoothed[out++] = stroke->points[count - 1];
+    free(stroke->points);
+    stroke->points = smoothed;
+    stroke->count = out;
+    stroke->capacity = smoothedCount;
+}
+
+void DrawingShape_FinishStroke(PenStroke* stroke, float tolerance, int smoothingPasses) {
+    if (stroke->count <= 0) {
+        return;
+    }
+    DrawingShape_Simplify(stroke, tolerance);
+    for (int i = 0; i < smoothingPasses; i++) {
+        DrawingShape_Smooth(stroke);
+    }
+
+    stroke->minX = stroke->maxX = stroke->points[0].x;
+    stroke->minY = stroke->maxY = stroke->points[0].y;
+    for (int i = 1; i < stroke->count; i++) {
+        Vector2 p = stroke->points[i];
+        if (p.x < stroke->minX) stroke->minX = p.x;
+        if (p.y < stroke->minY) stroke->minY = p.y;
+        if (p.x > stroke->maxX) stroke->maxX = p.x;
+        if (p.y > stroke->maxY) stroke->maxY = p.y;
+    }
+}
+
+void DrawingShape_FreeStroke(PenStroke* stroke) {
+    free(stroke->points);
+    *stroke = (PenStroke){0};
+}
+
+void DrawingShape_Shutdown(void) {
+    if (gOutlineShaderState > 0) {
+        UnloadShader(gOutlineShader);
+    }
+    gOutlineShader = (Shader){0};
+    gOutlineShaderState = 0;
+}
@@ -0,0 +1,68 @@
+#ifndef DRAWING_SHAPE_H
+#define DRAWING_SHAPE_H
+
+#include "raylib.h"
+#include <stddef.h>
+#include <stdio.h>
+
+/* Vector source of a drawing box. A shape is immutable once created and
+   reference-counted, so history snapshots share it with the live box instead
+   of copying pixels. It is drawn from its primitives every time it is rendered,
+   at whatever scale the camera is using, so it stays sharp when zoomed or when
+   the box is resized.
+
+   Points are box-local, measured against the box size the shape was created
+   for. A resized box stretches the points; stroke widths stay as created. */
+
+typedef enum {
+    SHAPE_RECT,         /* outline filling the box */
+    SHAPE_CIRCLE,       /* ellipse outline filling the box */
+    SHAPE_SEGMENT,      /* two points */
+    SHAPE_PEN           /* polyline */
+} ShapeKind;
+
+typedef struct DrawingShape DrawingShape;
+
+/* Pen input being captured, in world coordinates. The buffer grows as needed,
+   so strokes have no length limit. */
+typedef struct {
+    Vector2* points;
+    int count;
+    int capacity;
+    float minX;
+    float minY;
+    float maxX;
+    float maxY;
+} PenStroke;
+
+DrawingShape* DrawingShape_Create(ShapeKind kind, Color color, float thickness,
+                                  float baseWidth, float baseHeight,
+                                  const Vector2* points, int pointCount);
+DrawingShape* DrawingShape_Retain(DrawingShape* shape);
+void DrawingShape_Release(DrawingShape* shape);
+size_t DrawingShape_GetByteCount(const DrawingShape* shape);
+
+/* Draws the shape stretched over dest. Rectangles and circles are shaded from
+   a signed distance field, anti-aliased at any size. Strokes are built into one
+   triangle mesh with round joins and caps, cached for the box size, and go out
+   as a single batch. pixelsPerUnit is the current display scale; it only picks
+   the outline tessellation used when the shader is unavailable. */
+void DrawingShape_Draw(DrawingShape* shape, Rectangle dest, float pixelsPerUnit);
+
+int DrawingShape_Write(const DrawingShape* shape, FILE* file);
+DrawingShape* DrawingShape_Read(FILE* file);
+
+/* Starts a stroke at point, reusing the buffer of a previous stroke. */
+int DrawingShape_BeginStroke(PenStroke* stroke, Vector2 point);
+/* Adds point unless it is within minDistance of the last one. Returns 1 when
+   the point was kept. */
+int DrawingShape_AppendStroke(PenStroke* stroke, Vector2 point, float minDistance);
+/* Simplifies the stroke in place (Ramer-Douglas-Peucker within tolerance), then
+   applies smoothingPasses rounds of corner cutting, and refreshes the bounds. */
+void DrawingShape_FinishStroke(PenStroke* stroke, float tolerance, int smoothingPasses);
+void DrawingShape_FreeStroke(PenStroke* stroke);
+
+/* Releases the outline shader; call before the window closes. */
+void DrawingShape_Shutdown(void);
+
+#endif /* DRAWING_SHAPE_H */
@@ -0,0 +1,200 @@
+#include "job_queue.h"
+
+#include <stdlib.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+typedef HANDLE JobThread;
+typedef CRITICAL_SECTION JobMutex;
+typedef CONDITION_VARIABLE JobCondition;
+#else
+#include <pthread.h>
+typedef pthread_t JobThread;
+typedef pthread_mutex_t JobMutex;
+typedef pthread_cond_t JobCondition;
+#endif
+
+struct Job {
+    JobFunc func;
+    void* userData;
+    int done;
+    Job* next;
+};
+
+static JobThread gJobThread;
+static JobMutex gJobMutex;
+static JobCondition gJobAvailable;
+static JobCondition gJobFinished;
+static Job* gJobHead = NULL;
+static Job* gJobTail = NULL;
+static int gJobRunning = 0;
+static int gJobStopping = 0;
+
+#ifdef _WIN32
+static void JobMutex_Lock(void) { EnterCriticalSection(&gJobMutex); }
+static void JobMutex_Unlock(void) { LeaveCriticalSection(&gJobMutex); }
+static void JobCondition_Wait(JobCondition* condition) { SleepConditionVariableCS(condition, &gJobMutex, INFINITE); }
+static void JobCondition_Broadcast(JobCondition* condition) { WakeAllConditionVariable(condition); }
+#else
+static void JobMutex_Lock(void) { pthread_mutex_lock(&gJobMutex); }
+static void JobMutex_Unlock(void) { pthread_mutex_unlock(&gJobMutex); }
+static void JobCondition_Wait(JobCondition* condition) { pthread_cond_wait(condition, &gJobMutex); }
+static void JobCondition_Broadcast(JobCondition* condition) { pthread_cond_broadcast(condition); }
+#endif
+
+static void JobQueue_WorkerLoop(void) {
+    JobMutex_Lock();
+    for (;;) {
+        while (gJobHead == NULL && !gJobStopping) {
+            JobCondition_Wait(&gJobAvailable);
+        }
+        if (gJobHead == NULL) {
+            break;
+        }
+
+        Job* job = gJobHead;
+        gJobHead = job->next;
+        if (gJobHead == NULL) {
+            gJobTail = NULL;
+        }
+
+        JobMutex_Unlock();
+        job->func(job->userData);
+        JobMutex_Lock();
+
+        job->done = 1;
+        JobCondition_Broadcast(&gJobFinished);
+    }
+    JobMutex_Unlock();
+}
+
+#ifdef _WIN32
+static DWORD WINAPI JobQueue_ThreadMain(LPVOID param) {
+    (void)param;
+    JobQueue_WorkerLoop();
+    return 0;
+}
+#else
+static void* JobQueue_ThreadMain(void* param) {
+    (void)param;
+    JobQueue_WorkerLoop();
+    return NULL;
+}
+#endif
+
+static int JobQueue_Start(void) {
+    if (gJobRunning) {
+        return 1;
+    }
+
+    gJobStopping = 0;
+#ifdef _WIN32
+    InitializeCriticalSection(&gJobMutex);
+    InitializeConditionVariable(&gJobAvailable);
+    InitializeConditionVariable(&gJobFinished);
+    gJobThread = CreateThread(NULL, 0, JobQueue_ThreadMain, NULL, 0, NULL);
+    if (gJobThread == NULL) {
+        DeleteCriticalSection(&gJobMutex);
+        return 0;
+    }
+#else
+    pthread_mutex_init(&gJobMutex, NULL);
+    pthread_cond_init(&gJobAvailable, NULL);
+    pthread_cond_init(&gJobFinished, NULL);
+    if (pthread_create(&gJobThread, NULL, JobQueue_ThreadMain, NULL) != 0) {
+        pthread_cond_destroy(&gJobFinished);
+        pthread_cond_destroy(&gJobAvailable);
+        pthread_mutex_destroy(&gJobMutex);
+        return 0;
+    }
+#endif
+    gJobRunning = 1;
+    return 1;
+}
+
+Job* JobQueue_Submit(JobFunc func, void* userData) {
+    if (func == NULL) {
+        return NULL;
+    }
+
+    Job* job = (Job*)calloc(1, sizeof(Job));
+    if (job == NULL) {
+        func(userData);
+        return NULL;
+    }
+    job->func = func;
+    job->userData = userData;
+
+    if (!JobQueue_Start()) {
+        func(userData);
+        job->done = 1;
+        return job;
+    }
+
+    JobMutex_Lock();
+    if (gJobTail != NULL) {
+        gJobTail->next = job;
+    } else {
+        gJobHead = job;
+    }
+    gJobTail = job;
+    JobCondition_Broadcast(&gJobAvailable);
+    JobMutex_Unlock();
+    return job;
+}
+
+/* A NULL handle means the job already ran inline. */
+int JobQueue_IsDone(Job* job) {
+    if (job == NULL || !gJobRunning) {
+        return 1;
+    }
+
+    JobMutex_Lock();
+    int done = job->done;
+    JobMutex_Unlock();
+    return done;
+}
+
+void JobQueue_Wait(Job* job) {
+    if (job == NULL || !gJobRunning) {
+        return;
+    }
+
+    JobMutex_Lock();
+    while (!job->done) {
+        JobCondition_Wait(&gJobFinished);
+    }
+    JobMutex_Unlock();
+}
+
+void JobQueue_Free(Job* job) {
+    JobQueue_Wait(job);
+    free(job);
+}
+
+/* Drains outstanding jobs, then stops the worker. Handles stay owned by callers. */
+void JobQueue_Shutdown(void) {
+    if (!gJobRunning) {
+        return;
+    }
+
+    JobMutex_Lock();
+    gJobStopping = 1;
+    JobCondition_Broadcast(&gJobAvailable);
+    JobMutex_Unlock();
+
+#ifdef _WIN32
+    WaitForSingleObject(gJobThread, INFINITE);
+    CloseHandle(gJobThread);
+    DeleteCriticalSection(&gJobMutex);
+#else
+    pthread_join(gJobThread, NULL);
+    pthread_cond_destroy(&gJobFinished);
+    pthread_cond_destroy(&gJobAvailable);
+    pthread_mutex_destroy(&gJobMutex);
+#endif
+    gJobRunning = 0;
+    gJobHead = NULL;
+    gJobTail = NULL;
+}
@@ -0,0 +1,17 @@
+#ifndef JOB_QUEUE_H
+#define JOB_QUEUE_H
+
+/* Single background worker for CPU-heavy tasks that must not stall the frame
+   loop. Jobs run in submission order. If the worker cannot be started, jobs run
+   inline on the submitting thread. */
+
+typedef void (*JobFunc)(void* userData);
+typedef struct Job Job;
+
+Job* JobQueue_Submit(JobFunc func, void* userData);
+int JobQueue_IsDone(Job* job);
+void JobQueue_Wait(Job* job);
+void JobQueue_Free(Job* job);
+void JobQueue_Shutdown(void);
+
+#endif /* JOB_QUEUE_H */
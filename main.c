@@ -5,24 +5,21 @@
 #include <stdio.h>
 #include <ctype.h>
 #include <stddef.h>
+#include <stdint.h>
+#include "pixel_store.h"
+#include "job_queue.h"
+#include "scene.h"
+#include "scene_index.h"
+#include "scene_tiles.h"
+#include "drawing_shape.h"
+#include "text_layout.h"
+#include "text_buffer.h"
 
 #ifdef _WIN32
 #include "win_clipboard.h"
 #include "win_video.h"
 #endif
 
-#define MAX_BOXES 100
-#define MAX_PEN_POINTS 4096
-#define MAX_HISTORY 64
-
-typedef enum {
-    BOX_IMAGE,
-    BOX_TEXT,
-    BOX_VIDEO,
-    BOX_AUDIO,
-    BOX_DRAWING
-} BoxType;
-
 typedef enum {
     TOOL_SELECT,
     TOOL_PEN,
@@ -31,59 +28,30 @@ typedef enum {
     TOOL_RECT
 } Tool;
 
-typedef struct {
-    int x;
-    int y;
-    int width;
-    int height;
-    BoxType type;
-    union {
-        Texture2D texture;
-        char* text;
-        Music music;
-        WinVideoPlayer* video;
-    } content;
-    char* filePath;
-    int fontSize;
-    Color textColor;
-    int isSelected;
-    int videoDecodedFrames;
-    int videoFallbackFrames;
-    int videoReportedDecoded;
-    int videoReportedFallback;
-    float videoConvertAvgUs;
-    float videoConvertPeakUs;
-    float videoConvertLastUs;
-    unsigned int videoConvertSamples;
-    char videoFormatLabel[8];
-    float videoPositionSeconds;
-    float videoDurationSeconds;
-    int videoLoop;
-    int audioLoop;
-    int audioStreamStarted;
-    int audioWasPlaying;
-    float audioTimePlayed;
-    float audioDurationSeconds;
-} Box;
-
-typedef enum {
-    RESIZE_NONE,
-    RESIZE_LEFT,
-    RESIZE_RIGHT,
-    RESIZE_TOP,
-    RESIZE_BOTTOM,
-    RESIZE_TOP_LEFT,
-    RESIZE_TOP_RIGHT,
-    RESIZE_BOTTOM_LEFT,
-    RESIZE_BOTTOM_RIGHT
-} ResizeMode;
-
-static const float HANDLE_SIZE = 10.0f;
-static const float EDGE_DETECTION_MARGIN = 6.0f;
 static const float TEXT_DRAG_BORDER = 14.0f;
+static const int TARGET_FPS = 60;
+static const float CARET_BLINK_IDLE_SECONDS = 5.0f;  /* then the caret holds steady */
+static const float CAMERA_MIN_ZOOM = 0.1f;
+static const float CAMERA_MAX_ZOOM = 8.0f;
+static const float CAMERA_ZOOM_STEP = 1.1f;  /* per wheel notch */
 static const float TOOLBAR_HEIGHT = 64.0f;
 static const float TOOLBAR_PADDING = 10.0f;
 static const float STROKE_THICKNESS = 4.0f;
+static const float SHAPE_OUTLINE_THICKNESS = 1.0f;  /* rectangle and circle tools */
+static const float PEN_SIMPLIFY_TOLERANCE = 0.5f;  /* screen pixels */
+static const int PEN_SMOOTHING_PASSES = 1;
+static const int COMPRESS_PIXEL_SOURCES = 1;
+static const int TEXT_RASTER_MAX_SIZE = 4096;      /* texture pixels per side */
+/* First font found is used for all text; without one the bitmap default font is. */
+static const char* CANVAS_FONT_FILE = "fonts/canvas.ttf";  /* next to the executable */
+static const char* CANVAS_SYSTEM_FONTS[] = {
+    "C:/Windows/Fonts/segoeui.ttf",
+    "C:/Windows/Fonts/arial.ttf",
+    "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf",
+    "/usr/share/fonts/TTF/DejaVuSans.ttf",
+    "/System/Library/Fonts/Supplemental/Arial.ttf",
+};
+static const size_t TEXT_RASTER_MEMORY_BUDGET = 64 * 1024 * 1024;
 static const int AUDIO_BOX_WIDTH = 260;
 static const int AUDIO_BOX_HEIGHT = 96;
 static const int DEFAULT_VIDEO_BOX_WIDTH = 320;
@@ -116,9 +84,10 @@ static const int FONT_SIZE_STEP = 2;
 
 /* Text editing state */
 int editingBoxIndex = -1;
-char editingText[1024] = {0};
-char editingOriginalText[1024] = {0};
+TextBuffer editingBuffer = {0};     /* text of the box being edited */
+TextLines editingLines = {0};       /* line index of editingBuffer, updated on every edit */
 int editingFontSize = DEFAULT_FONT_SIZE;
+int editingWrapWidth = 0;           /* wrap width of the box being edited */
 int editingOriginalFontSize = DEFAULT_FONT_SIZE;
 int cursorPosition = 0;
 int selectionStart = 0;
@@ -130,17 +99,13 @@ float cursorBlinkTime = 0.0f;
 int lastTextEditChanged = 0;
 
 void UpdateEditingBoxSize(Box* boxes);
-ResizeMode GetResizeModeForPoint(const Box* box, Vector2 point);
 void ApplyResize(Box* box, ResizeMode mode, Vector2 delta);
+void UpdateCanvasCamera(Camera2D* camera, Vector2 screenMouse, int* isPanning);
 int MouseCursorForResizeMode(ResizeMode mode);
-Rectangle GetBoxRect(const Box* box);
-int FindTopmostBoxAtPoint(Vector2 point, Box* boxes, int boxCount);
 int IsPointInTextDragZone(const Box* box, Vector2 point);
 void StopTextEditAndRecord(Box* boxes, int boxCount, int selectedBox);
 void StopTextEdit(Box* boxes);
 void DestroyBox(Box* box);
-int BringBoxToFront(Box* boxes, int boxCount, int index);
-int SendBoxToBack(Box* boxes, int boxCount, int index);
 void ClearAllBoxes(Box* boxes, int* boxCount, int* selectedBox);
 void ResetEditingState(void);
 int ColorsEqual(Color a, Color b);
@@ -151,29 +116,97 @@ void ToggleVideoPlayback(Box* box, char* statusMessage, size_t statusMessageSize
 
 typedef struct {
     Box box;
-    Image imageCopy;
+    PixelBlob* pixels;
+    DrawingShape* shape;
     char* textCopy;
     char* filePathCopy;
+    BoxMedia media;     /* copy of the box's media record, handles cleared */
+    /* A box removed by delete/undo-create is parked here with its texture, music
+       stream or video player intact, so restoring it does not reopen anything. */
+    Box live;
+    int hasLive;
 } BoxSnapshot;
 
+/* Undo history records only the boxes an action touched. Each entry is a list of
+   ops that are replayed forward for redo and inverted back-to-front for undo. */
+typedef enum {
+    HISTORY_OP_MODIFY,
+    HISTORY_OP_CREATE,
+    HISTORY_OP_DELETE
+} HistoryOpType;
+
+enum {
+    HISTORY_FIELD_GEOMETRY = 1 << 0,
+    HISTORY_FIELD_STYLE = 1 << 1,
+    HISTORY_FIELD_TEXT = 1 << 2,
+    HISTORY_FIELD_LOOP = 1 << 3,
+    HISTORY_FIELD_ZORDER = 1 << 4
+};
+
 typedef struct {
-    BoxSnapshot boxes[MAX_BOXES];
-    int boxCount;
-    int selectedBox;
-} CanvasSnapshot;
-
-void FreeSnapshot(CanvasSnapshot* snapshot);
-void CaptureSnapshot(CanvasSnapshot* snapshot, Box* boxes, int boxCount, int selectedBox);
-void PushHistoryState(Box* boxes, int boxCount, int selectedBox);
-void RestoreSnapshotState(Box* boxes, int* boxCount, int* selectedBox, int targetIndex);
-int PerformUndo(Box* boxes, int* boxCount, int* selectedBox);
-int PerformRedo(Box* boxes, int* boxCount, int* selectedBox);
-
-static CanvasSnapshot historyStates[MAX_HISTORY];
+    HistoryOpType type;
+    BoxId id;
+    unsigned int fields;
+    BoxSnapshot before;
+    BoxSnapshot after;
+} HistoryOp;
+
+/* Entries live in a ring buffer. Once the resident entries exceed
+   HISTORY_MEMORY_BUDGET those furthest from the undo position are written to a
+   temp-file journal and only their selection and journal offset stay in memory. */
+typedef struct {
+    HistoryOp* ops;
+    int opCount;
+    int opCapacity;
+    BoxId selectedBefore;
+    BoxId selectedAfter;
+    size_t byteCost;
+    int spilled;
+    long journalOffset;
+    long journalSize;
+    BoxId* spilledIds;      /* ids a spilled entry's ops hold references to */
+    int spilledIdCount;
+} HistoryEntry;
+
+void FreeSnapshot(BoxSnapshot* snapshot);
+void CaptureSnapshot(BoxSnapshot* snapshot, const Box* box, int includeContent);
+void BeginHistoryGroup(void);
+void EndHistoryGroup(int selectedBox);
+void PushCreateHistory(Box* boxes, int index, int selectedBox);
+void PushDeleteHistory(Box* box, int selectedBox);
+void PushModifyHistory(BoxSnapshot* before, const Box* after, int selectedBox);
+void ClearHistory(void);
+int PerformUndo(Box** boxes, int* boxCount, int* boxCapacity, int* selectedBox);
+int PerformRedo(Box** boxes, int* boxCount, int* boxCapacity, int* selectedBox);
+
+static const size_t HISTORY_MEMORY_BUDGET = 32 * 1024 * 1024;
+static const int HISTORY_PARKED_ENTRY_LIMIT = 16;
+static const long HISTORY_JOURNAL_SLACK = 4 * 1024 * 1024;  /* dead bytes kept before compacting */
+static HistoryEntry* historyRing = NULL;
+static int historyCapacity = 0;
+static int historyHead = 0;
+static HistoryEntry pendingEntry = {0};
 static int historyCount = 0;
-static int historyIndex = -1;
+static int historyIndex = 0;
+static size_t historyResidentBytes = 0;  /* excluding pixel blobs, see HistoryPixelBytes */
+static PixelBlob** historyBlobScratch = NULL;
+static int historyBlobScratchCapacity = 0;
+static int historySpillCursor = 0;     /* entries below it are all spilled */
+static int historySpillTop = 0;        /* entries from it up are all spilled */
+static int historySpilledCount = 0;
+static FILE* historyJournal = NULL;
+static long historyJournalLiveBytes = 0;
+static int historyGroupDepth = 0;
+static BoxId historySelection = BOX_ID_NONE;
 static int suppressHistory = 0;
+static BoxSnapshot editingBeforeState = {0};
 static int audioDeviceReady = 0;
+/* Screen-sized scratch target holding the pen stroke being drawn, and how many
+   of its points are already in it under penPreviewCamera. */
+static RenderTexture2D penPreviewTarget = {0};
+static size_t textRasterBytes = 0;
+static int penPreviewPoints = 0;
+static Camera2D penPreviewCamera = {0};
 
 const char* GetClipboardTextSafe(void) {
     #ifdef _WIN32
@@ -199,25 +232,21 @@ const char* GetClipboardTextSafe(void) {
     #endif
 }
 
-static int ClampCursorIndex(const char* text, int index);
-
-static int FindPreviousWordBoundary(const char* text, int index) {
-    if (text == NULL) {
-        return 0;
-    }
+static int ClampCursorIndex(int index);
 
-    int pos = ClampCursorIndex(text, index);
+static int FindPreviousWordBoundary(const TextBuffer* buffer, int index) {
+    int pos = ClampCursorIndex(index);
     if (pos <= 0) {
         return 0;
     }
 
     pos--;
 
-    while (pos > 0 && isspace((unsigned char)text[pos])) {
+    while (pos > 0 && isspace((unsigned char)TextBuffer_GetChar(buffer, pos))) {
         pos--;
     }
 
-    while (pos > 0 && !isspace((unsigned char)text[pos - 1])) {
+    while (pos > 0 && !isspace((unsigned char)TextBuffer_GetChar(buffer, pos - 1))) {
         pos--;
     }
 
@@ -227,22 +256,18 @@ static int FindPreviousWordBoundary(const char* text, int index) {
     return pos;
 }
 
-static int FindNextWordBoundary(const char* text, int index) {
-    if (text == NULL) {
-        return 0;
-    }
-
-    int len = (int)strlen(text);
-    int pos = ClampCursorIndex(text, index);
+static int FindNextWordBoundary(const TextBuffer* buffer, int index) {
+    int len = TextBuffer_GetLength(buffer);
+    int pos = ClampCursorIndex(index);
     if (pos >= len) {
         return len;
     }
 
-    while (pos < len && isspace((unsigned char)text[pos])) {
+    while (pos < len && isspace((unsigned char)TextBuffer_GetChar(buffer, pos))) {
         pos++;
     }
 
-    while (pos < len && !isspace((unsigned char)text[pos])) {
+    while (pos < len && !isspace((unsigned char)TextBuffer_GetChar(buffer, pos))) {
         pos++;
     }
 
@@ -252,19 +277,6 @@ static int FindNextWordBoundary(const char* text, int index) {
     return pos;
 }
 
-static char* CopySubstring(const char* start, int length) {
-    if (start == NULL || length <= 0) {
-        return NULL;
-    }
-    char* buffer = (char*)malloc((size_t)length + 1);
-    if (buffer == NULL) {
-        return NULL;
-    }
-    memcpy(buffer, start, (size_t)length);
-    buffer[length] = '\0';
-    return buffer;
-}
-
 static void TrimSurroundingQuotes(char* str) {
     if (str == NULL) {
         return;
@@ -340,17 +352,17 @@ static void StopAudioPlayback(Box* box) {
         return;
     }
     if (!audioDeviceReady) {
-        box->audioStreamStarted = 0;
-        box->audioWasPlaying = 0;
-        box->audioTimePlayed = 0.0f;
+        box->media->audioStreamStarted = 0;
+        box->media->audioWasPlaying = 0;
+        box->media->audioTimePlayed = 0.0f;
         return;
     }
-    if (IsMusicReady(box->content.music)) {
-        StopMusicStream(box->content.music);
-        SeekMusicStream(box->content.music, 0.0f);
-        box->audioStreamStarted = 0;
-        box->audioWasPlaying = 0;
-        box->audioTimePlayed = 0.0f;
+    if (IsMusicReady(box->media->music)) {
+        StopMusicStream(box->media->music);
+        SeekMusicStream(box->media->music, 0.0f);
+        box->media->audioStreamStarted = 0;
+        box->media->audioWasPlaying = 0;
+        box->media->audioTimePlayed = 0.0f;
     }
 }
 
@@ -365,7 +377,7 @@ static void ToggleAudioPlayback(Box* box, char* statusMessage, size_t statusMess
         }
         return;
     }
-    if (!IsMusicReady(box->content.music)) {
+    if (!IsMusicReady(box->media->music)) {
         if (statusMessage && statusMessageSize > 0 && statusMessageTimer) {
             snprintf(statusMessage, statusMessageSize, "Audio not ready");
             *statusMessageTimer = 1.8f;
@@ -373,30 +385,30 @@ static void ToggleAudioPlayback(Box* box, char* statusMessage, size_t statusMess
         return;
     }
 
-    int isPlaying = box->audioStreamStarted && IsMusicStreamPlaying(box->content.music);
-    float length = GetMusicTimeLength(box->content.music);
+    int isPlaying = box->media->audioStreamStarted && IsMusicStreamPlaying(box->media->music);
+    float length = GetMusicTimeLength(box->media->music);
     if (length < 0.0f) length = 0.0f;
-    float played = GetMusicTimePlayed(box->content.music);
+    float played = GetMusicTimePlayed(box->media->music);
 
     if (isPlaying) {
-        PauseMusicStream(box->content.music);
-        box->audioWasPlaying = 0;
+        PauseMusicStream(box->media->music);
+        box->media->audioWasPlaying = 0;
         if (statusMessage && statusMessageSize > 0 && statusMessageTimer) {
             snprintf(statusMessage, statusMessageSize, "Paused %s", ExtractFileName(box->filePath));
             *statusMessageTimer = 1.4f;
         }
     } else {
-        if (!box->audioStreamStarted) {
-            PlayMusicStream(box->content.music);
-            box->audioStreamStarted = 1;
+        if (!box->media->audioStreamStarted) {
+            PlayMusicStream(box->media->music);
+            box->media->audioStreamStarted = 1;
         } else {
             if (length > 0.0f && played >= length - 0.01f) {
-                SeekMusicStream(box->content.music, 0.0f);
+                SeekMusicStream(box->media->music, 0.0f);
             }
-            ResumeMusicStream(box->content.music);
+            ResumeMusicStream(box->media->music);
         }
-        box->content.music.looping = box->audioLoop ? true : false;
-        box->audioWasPlaying = 1;
+        box->media->music.looping = box->media->audioLoop ? true : false;
+        box->media->audioWasPlaying = 1;
         if (statusMessage && statusMessageSize > 0 && statusMessageTimer) {
             snprintf(statusMessage, statusMessageSize, "Playing %s", ExtractFileName(box->filePath));
             *statusMessageTimer = 1.4f;
@@ -404,6 +416,27 @@ static void ToggleAudioPlayback(Box* box, char* statusMessage, size_t statusMess
     }
 }
 
+/* Uploads the texture for an image box and keeps the pixels as the box's
+   CPU-side source, so history never has to read the texture back. Takes
+   ownership of image.data; hashing and compression finish on the worker. */
+static void AssignBoxPixels(Box* box, Image image) {
+    box->content.texture = LoadTextureFromImage(image);
+    box->pixels = PixelStore_AdoptImageAsync(image);
+    if (COMPRESS_PIXEL_SOURCES) {
+        PixelStore_Compress(box->pixels);
+    }
+}
+
+/* Makes box a drawing whose vector source is sized to its current bounds.
+   Points are box-local; nothing is rasterized until the box is drawn. */
+static void AssignDrawingShape(Box* box, ShapeKind kind, Color color, float thickness,
+                               const Vector2* points, int pointCount) {
+    box->type = BOX_DRAWING;
+    box->content.shape = DrawingShape_Create(kind, color, thickness, (float)box->width, (float)box->height,
+                                             points, pointCount);
+    box->pixels = NULL;
+}
+
 void ConfigureVideoBoxSize(Box* box, const Texture2D* texture) {
     if (box == NULL) {
         return;
@@ -560,24 +593,8 @@ static Rectangle GetVideoProgressRect(const Box* box) {
     return rect;
 }
 
-static int MeasureTextSegmentWidth(const char* start, int length, int fontSize) {
-    if (start == NULL || length <= 0) {
-        return 0;
-    }
-    char* segment = CopySubstring(start, length);
-    if (segment == NULL) {
-        return 0;
-    }
-    int width = MeasureText(segment, fontSize);
-    free(segment);
-    return width;
-}
-
-static int ClampCursorIndex(const char* text, int index) {
-    if (text == NULL) {
-        return 0;
-    }
-    int len = (int)strlen(text);
+static int ClampCursorIndex(int index) {
+    int len = TextBuffer_GetLength(&editingBuffer);
     if (index < 0) index = 0;
     if (index > len) index = len;
     return index;
@@ -596,7 +613,7 @@ static int SelectionMax(void) {
 }
 
 static void MoveCursorTo(int position, int extendSelection) {
-    int clamped = ClampCursorIndex(editingText, position);
+    int clamped = ClampCursorIndex(position);
     if (extendSelection) {
         selectionEnd = clamped;
     } else {
@@ -610,16 +627,76 @@ static void MoveCursorTo(int position, int extendSelection) {
     cursorBlinkTime = 0.0f;
 }
 
+/* Inserts text at index, keeping the line index in step. Returns 0 when out of memory. */
+static int InsertEditingText(int index, const char* text, int length) {
+    if (!TextBuffer_Insert(&editingBuffer, index, text, length)) {
+        return 0;
+    }
+    if (!TextLayout_InsertLines(&editingLines, index, text, length)) {
+        TextBuffer_Delete(&editingBuffer, index, index + length);
+        return 0;
+    }
+    return 1;
+}
+
+static void DeleteEditingText(int start, int end) {
+    int len = TextBuffer_GetLength(&editingBuffer);
+    if (start < 0) start = 0;
+    if (end > len) end = len;
+    if (end <= start) {
+        return;
+    }
+    TextBuffer_Delete(&editingBuffer, start, end);
+    TextLayout_DeleteLines(&editingLines, start, end);
+}
+
+static const char* GetEditingLineText(int line) {
+    int start = TextLayout_GetLineStart(&editingLines, line);
+    return TextBuffer_GetRange(&editingBuffer, start, TextLayout_GetLineEnd(&editingLines, line));
+}
+
+/* Brings the wrapped rows of a box's text, or of the editing buffer when text
+   is NULL, up to date and returns the row count. Only lines edited since the
+   last call are wrapped again, unless the width or font size changed. */
+static int WrapTextLines(const char* text, TextBuffer* buffer, TextLines* lines, int fontSize, int wrapWidth) {
+    for (int line = TextLayout_PrepareWrap(lines, fontSize, wrapWidth); line < lines->count; line++) {
+        const char* lineText = NULL;
+        if (wrapWidth > 0 && !TextLayout_IsLineWrapped(lines, line)) {
+            int start = TextLayout_GetLineStart(lines, line);
+            lineText = (text != NULL) ? text + start : TextBuffer_GetRange(buffer, start, TextLayout_GetLineEnd(lines, line));
+        }
+        TextLayout_WrapLine(lines, line, lineText);
+    }
+    return TextLayout_GetRowCount(lines);
+}
+
+static int WrapEditingLines(void) {
+    return WrapTextLines(NULL, &editingBuffer, &editingLines, editingFontSize, editingWrapWidth);
+}
+
+/* Last caret position on a row. A row that wraps ends before the character it
+   wrapped after, since the row's end offset is where the next row starts. */
+static int GetEditingRowCaretEnd(int row) {
+    int start = TextLayout_GetRowStart(&editingLines, row);
+    int end = TextLayout_GetRowEnd(&editingLines, row);
+    int line = TextLayout_FindRowLine(&editingLines, row);
+    if (end > start && end < TextLayout_GetLineEnd(&editingLines, line)) {
+        end--;
+        while (end > start && ((unsigned char)TextBuffer_GetChar(&editingBuffer, end) & 0xC0) == 0x80) {
+            end--;
+        }
+    }
+    return end;
+}
+
 static int DeleteSelectionRange(void) {
     if (!SelectionHasRange()) {
         return 0;
     }
     int start = SelectionMin();
     int end = SelectionMax();
-    int len = (int)strlen(editingText);
     if (start < 0) start = 0;
-    if (end > len) end = len;
-    memmove(editingText + start, editingText + end, (size_t)(len - end + 1));
+    DeleteEditingText(start, end);
     selectionStart = selectionEnd = start;
     cursorPosition = start;
     cursorPreferredColumn = -1;
@@ -627,179 +704,105 @@ static int DeleteSelectionRange(void) {
     return 1;
 }
 
-static int GetLineStartIndex(const char* text, int index) {
-    if (text == NULL) return 0;
-    int clamped = ClampCursorIndex(text, index);
-    while (clamped > 0 && text[clamped - 1] != '\n') {
-        clamped--;
-    }
-    return clamped;
-}
-
-static int GetLineEndIndex(const char* text, int index) {
-    if (text == NULL) return 0;
-    int len = (int)strlen(text);
-    int clamped = ClampCursorIndex(text, index);
-    while (clamped < len && text[clamped] != '\n') {
-        clamped++;
-    }
-    return clamped;
-}
-
 static void MoveCursorVertical(int direction, int extendSelection) {
     if (direction == 0) {
         return;
     }
 
-    int len = (int)strlen(editingText);
+    int len = TextBuffer_GetLength(&editingBuffer);
     if (len == 0) {
         MoveCursorTo(0, extendSelection);
         return;
     }
 
-    int lineStart = GetLineStartIndex(editingText, cursorPosition);
-    int currentColumn = cursorPosition - lineStart;
+    int rowCount = WrapEditingLines();
+    int row = TextLayout_FindRow(&editingLines, cursorPosition);
+    int currentColumn = cursorPosition - TextLayout_GetRowStart(&editingLines, row);
     int preferredColumn = cursorPreferredColumn;
     if (preferredColumn < 0) {
         preferredColumn = currentColumn;
     }
 
-    if (direction < 0) {
-        if (lineStart == 0) {
-            MoveCursorTo(0, extendSelection);
-            cursorPreferredColumn = preferredColumn;
-            return;
-        }
-        int prevLineEnd = lineStart - 1;
-        int prevLineStart = GetLineStartIndex(editingText, prevLineEnd);
-        int prevLineLength = prevLineEnd - prevLineStart;
-        int targetColumn = preferredColumn;
-        if (targetColumn > prevLineLength) targetColumn = prevLineLength;
-        MoveCursorTo(prevLineStart + targetColumn, extendSelection);
+    int targetRow = row + ((direction < 0) ? -1 : 1);
+    if (targetRow < 0) {
+        MoveCursorTo(0, extendSelection);
+    } else if (targetRow >= rowCount) {
+        MoveCursorTo(len, extendSelection);
     } else {
-        int lineEnd = GetLineEndIndex(editingText, cursorPosition);
-        if (lineEnd >= len) {
-            MoveCursorTo(len, extendSelection);
-            cursorPreferredColumn = preferredColumn;
-            return;
-        }
-        int nextLineStart = lineEnd + 1;
-        if (nextLineStart > len) {
-            MoveCursorTo(len, extendSelection);
-            cursorPreferredColumn = preferredColumn;
-            return;
-        }
-        int nextLineEnd = GetLineEndIndex(editingText, nextLineStart);
-        int nextLineLength = nextLineEnd - nextLineStart;
+        int targetStart = TextLayout_GetRowStart(&editingLines, targetRow);
+        int targetLength = GetEditingRowCaretEnd(targetRow) - targetStart;
         int targetColumn = preferredColumn;
-        if (targetColumn > nextLineLength) targetColumn = nextLineLength;
-        MoveCursorTo(nextLineStart + targetColumn, extendSelection);
+        if (targetColumn > targetLength) targetColumn = targetLength;
+        MoveCursorTo(targetStart + targetColumn, extendSelection);
     }
 
     cursorPreferredColumn = preferredColumn;
 }
 
-static void GetCursorCoordinates(const char* text, int fontSize, int index, int* outX, int* outY) {
+static void GetCursorCoordinates(int fontSize, int index, int* outX, int* outY) {
     if (outX) *outX = 0;
     if (outY) *outY = 0;
-    if (text == NULL) {
-        return;
-    }
-
-    int len = (int)strlen(text);
-    int clamped = ClampCursorIndex(text, index);
-    int currentIndex = 0;
-    int lineNumber = 0;
-
-    while (currentIndex <= len) {
-        const char* linePtr = text + currentIndex;
-        const char* newline = strchr(linePtr, '\n');
-        int lineLength = newline ? (int)(newline - linePtr) : (int)strlen(linePtr);
-        int lineEnd = currentIndex + lineLength;
-
-        if (clamped <= lineEnd) {
-            int offset = clamped - currentIndex;
-            if (outX) {
-                *outX = MeasureTextSegmentWidth(linePtr, offset, fontSize);
-            }
-            if (outY) {
-                *outY = lineNumber * fontSize;
-            }
-            return;
-        }
-
-        currentIndex = lineEnd;
-        if (newline) {
-            if (clamped == currentIndex) {
-                if (outX) {
-                    *outX = MeasureTextSegmentWidth(linePtr, lineLength, fontSize);
-                }
-                if (outY) {
-                    *outY = lineNumber * fontSize;
-                }
-                return;
-            }
-            currentIndex++;
-            lineNumber++;
-        } else {
-            break;
-        }
-    }
 
+    int clamped = ClampCursorIndex(index);
+    WrapEditingLines();
+    int row = TextLayout_FindRow(&editingLines, clamped);
+    int rowStart = TextLayout_GetRowStart(&editingLines, row);
     if (outX) {
-        const char* linePtr = text + currentIndex;
-        *outX = MeasureTextSegmentWidth(linePtr, (int)strlen(linePtr), fontSize);
+        const char* rowText = TextBuffer_GetRange(&editingBuffer, rowStart, clamped);
+        *outX = TextLayout_MeasureSegment(rowText, clamped - rowStart, fontSize);
     }
     if (outY) {
-        *outY = lineNumber * fontSize;
+        *outY = row * fontSize;
     }
 }
 
-static int GetTextIndexFromPoint(const char* text, int fontSize, Vector2 local) {
-    if (text == NULL) {
+static int GetTextIndexFromPoint(int fontSize, Vector2 local) {
+    if (editingLines.count == 0) {
         return 0;
     }
 
-    int len = (int)strlen(text);
     int x = (int)local.x - 10;
     int y = (int)local.y - 10;
     if (x < 0) x = 0;
     if (y < 0) y = 0;
-    int lineIndex = y / fontSize;
-
-    int currentIndex = 0;
-    int currentLine = 0;
-
-    while (currentIndex <= len) {
-        const char* linePtr = text + currentIndex;
-        const char* newline = strchr(linePtr, '\n');
-        int lineLength = newline ? (int)(newline - linePtr) : (int)strlen(linePtr);
-        int lineEnd = currentIndex + lineLength;
-
-        if (currentLine == lineIndex || !newline) {
-            int offset = 0;
-            for (int i = 0; i <= lineLength; i++) {
-                int width = MeasureTextSegmentWidth(linePtr, i, fontSize);
-                if (x < width) {
-                    offset = i;
-                    break;
-                }
-                offset = i;
-            }
-            int target = currentIndex + offset;
-            if (target > len) target = len;
-            return target;
-        }
+    int rowCount = WrapEditingLines();
+    int row = y / fontSize;
+    if (row >= rowCount) {
+        row = rowCount - 1;
+    }
+
+    int rowStart = TextLayout_GetRowStart(&editingLines, row);
+    int rowEnd = TextLayout_GetRowEnd(&editingLines, row);
+    const char* rowText = TextBuffer_GetRange(&editingBuffer, rowStart, rowEnd);
+    int index = rowStart + TextLayout_GetIndexFromX(rowText, rowEnd - rowStart, fontSize, x);
+    int caretEnd = GetEditingRowCaretEnd(row);
+    return (index > caretEnd) ? caretEnd : index;
+}
 
-        if (!newline) {
-            break;
-        }
+/* Box size for text whose widest line and line count are known, with padding
+   and minimums. A wrapped box keeps the width it wraps at. */
+static void GetTextBoxSizeForLines(int maxWidth, int lineCount, int fontSize, int wrapWidth, int* width, int* height) {
+    if (lineCount <= 0) {
+        lineCount = 1;
+    }
 
-        currentIndex = lineEnd + 1;
-        currentLine++;
+    int paddedWidth = maxWidth + 20;   /* 10px padding on each side */
+    int paddedHeight = (lineCount * fontSize) + 20;
+
+    int minWidth = fontSize * 5;
+    if (minWidth < 80) minWidth = 80;
+    if (wrapWidth > 0) {
+        paddedWidth = wrapWidth + 20;
+    } else if (paddedWidth < minWidth) {
+        paddedWidth = minWidth;
     }
 
-    return len;
+    int minHeight = fontSize + 20;
+    if (minHeight < 30) minHeight = 30;
+    if (paddedHeight < minHeight) paddedHeight = minHeight;
+
+    *width = paddedWidth;
+    *height = paddedHeight;
 }
 
 void CalculateTextBoxSize(const char* text, int fontSize, int* width, int* height) {
@@ -816,7 +819,7 @@ void CalculateTextBoxSize(const char* text, int fontSize, int* width, int* heigh
 
         while (*ptr != '\0') {
             if (*ptr == '\n') {
-                int lineWidth = MeasureTextSegmentWidth(lineStart, (int)(ptr - lineStart), fontSize);
+                int lineWidth = TextLayout_MeasureSegment(lineStart, (int)(ptr - lineStart), fontSize);
                 if (lineWidth > maxWidth) {
                     maxWidth = lineWidth;
                 }
@@ -826,7 +829,7 @@ void CalculateTextBoxSize(const char* text, int fontSize, int* width, int* heigh
             ptr++;
         }
 
-        int lineWidth = MeasureTextSegmentWidth(lineStart, (int)(ptr - lineStart), fontSize);
+        int lineWidth = TextLayout_MeasureSegment(lineStart, (int)(ptr - lineStart), fontSize);
         if (lineWidth > maxWidth) {
             maxWidth = lineWidth;
         }
@@ -835,31 +838,73 @@ void CalculateTextBoxSize(const char* text, int fontSize, int* width, int* heigh
         lineCount = 1;
     }
 
-    if (lineCount <= 0) {
-        lineCount = 1;
-    }
-
-    int paddedWidth = maxWidth + 20;   /* 10px padding on each side */
-    int paddedHeight = (lineCount * fontSize) + 20;
+    GetTextBoxSizeForLines(maxWidth, lineCount, fontSize, 0, width, height);
+}
 
-    int minWidth = fontSize * 5;
-    if (minWidth < 80) minWidth = 80;
-    if (paddedWidth < minWidth) paddedWidth = minWidth;
+/* Gives the box ownership of text, replacing its previous text, and indexes its lines. */
+static void SetBoxText(Box* box, char* text) {
+    free(box->content.text);
+    box->content.text = text;
+    if (box->raster != NULL) {
+        box->raster->stale = 1;
+    }
+    if (box->lines == NULL) {
+        box->lines = (TextLines*)calloc(1, sizeof(TextLines));
+    }
+    if (box->lines != NULL) {
+        TextLayout_IndexLines(box->lines, text != NULL ? text : "", text != NULL ? (int)strlen(text) : 0);
+    }
+}
 
-    int minHeight = fontSize + 20;
-    if (minHeight < 30) minHeight = 30;
-    if (paddedHeight < minHeight) paddedHeight = minHeight;
+/* Moves the edited text and its line index into the box without copying. */
+static void AdoptEditingText(Box* box) {
+    char* text = TextBuffer_Take(&editingBuffer);
+    if (text == NULL) {
+        return;
+    }
+    free(box->content.text);
+    box->content.text = text;
+    if (box->raster != NULL) {
+        box->raster->stale = 1;
+    }
+    if (box->lines == NULL) {
+        box->lines = (TextLines*)calloc(1, sizeof(TextLines));
+    }
+    if (box->lines != NULL) {
+        TextLayout_FreeLines(box->lines);
+        *box->lines = editingLines;
+        editingLines = (TextLines){0};
+    }
+}
 
-    *width = paddedWidth;
-    *height = paddedHeight;
+static void CalculateEditingTextSize(int* width, int* height) {
+    if (editingWrapWidth > 0) {
+        GetTextBoxSizeForLines(0, WrapEditingLines(), editingFontSize, editingWrapWidth, width, height);
+        return;
+    }
+    int maxWidth = 0;
+    for (int line = 0; line < editingLines.count; line++) {
+        /* Only lines changed since they were last measured need their text. */
+        const char* lineText = NULL;
+        if (!TextLayout_IsLineMeasured(&editingLines, line, editingFontSize)) {
+            lineText = GetEditingLineText(line);
+        }
+        int lineWidth = TextLayout_GetLineWidth(&editingLines, line, lineText, editingFontSize);
+        if (lineWidth > maxWidth) {
+            maxWidth = lineWidth;
+        }
+    }
+    GetTextBoxSizeForLines(maxWidth, editingLines.count, editingFontSize, 0, width, height);
 }
 
-static void DrawMultilineTextWithSelection(const char* text, int x, int y, int fontSize, Color color, int selStart, int selEnd, Color highlight) {
-    if (text == NULL) {
+/* Draws a box's text, or the editing buffer when text is NULL, wrapped at
+   wrapWidth. Only rows that overlap clip vertically are touched, so the cost
+   follows what is on screen rather than the length of the text. */
+static void DrawMultilineTextWithSelection(const char* text, TextBuffer* buffer, TextLines* lines, int x, int y, int fontSize, int wrapWidth, Color color, int selStart, int selEnd, Color highlight, Rectangle clip) {
+    if ((text == NULL && buffer == NULL) || lines == NULL) {
         return;
     }
 
-    int totalLength = (int)strlen(text);
     int hasSelection = (selStart != selEnd);
     if (selStart > selEnd) {
         int tmp = selStart;
@@ -867,66 +912,183 @@ static void DrawMultilineTextWithSelection(const char* text, int x, int y, int f
         selEnd = tmp;
     }
 
-    int currentIndex = 0;
-    int currentY = y;
+    int firstRow = 0;
+    int lastRow = WrapTextLines(text, buffer, lines, fontSize, wrapWidth) - 1;
+    if (fontSize > 0) {
+        int clipFirst = (int)floorf((clip.y - (float)y) / (float)fontSize);
+        int clipLast = (int)floorf((clip.y + clip.height - (float)y) / (float)fontSize);
+        if (clipFirst > firstRow) firstRow = clipFirst;
+        if (clipLast < lastRow) lastRow = clipLast;
+    }
+
+    /* Highlights go down first so the glyphs after them share one shader run. */
+    for (int row = firstRow; hasSelection && row <= lastRow; row++) {
+        int rowStartIndex = TextLayout_GetRowStart(lines, row);
+        int rowEndIndex = TextLayout_GetRowEnd(lines, row);
+        int rowLength = rowEndIndex - rowStartIndex;
+        int line = TextLayout_FindRowLine(lines, row);
+        int newline = (line + 1 < lines->count && rowEndIndex == TextLayout_GetLineEnd(lines, line));
+        const char* rowPtr = (text != NULL) ? text + rowStartIndex : TextBuffer_GetRange(buffer, rowStartIndex, rowEndIndex);
+        int currentY = y + row * fontSize;
+
+        int highlightStart = selStart;
+        if (highlightStart < rowStartIndex) highlightStart = rowStartIndex;
+        if (highlightStart > rowEndIndex) highlightStart = rowEndIndex;
+
+        int highlightEnd = selEnd;
+        if (highlightEnd < rowStartIndex) highlightEnd = rowStartIndex;
+        if (highlightEnd > rowEndIndex) highlightEnd = rowEndIndex;
+
+        int highlightLength = highlightEnd - highlightStart;
+        if (highlightLength > 0) {
+            int preLength = highlightStart - rowStartIndex;
+            int preWidth = TextLayout_MeasureSegment(rowPtr, preLength, fontSize);
+            int highlightWidth = TextLayout_MeasureSegment(rowPtr + preLength, highlightLength, fontSize);
+            if (highlightWidth <= 0) highlightWidth = fontSize / 2;
+            DrawRectangle(x + preWidth, currentY, (float)highlightWidth, (float)fontSize, highlight);
+        } else if (rowLength == 0 && selStart <= rowStartIndex && selEnd > rowStartIndex) {
+            DrawRectangle(x, currentY, (float)(fontSize / 2), (float)fontSize, highlight);
+        }
+
+        if (selStart <= rowEndIndex && selEnd > rowEndIndex && newline) {
+            /* An unwrapped line's width is cached in the line index. */
+            int endWidth = (rowStartIndex == TextLayout_GetLineStart(lines, line))
+                               ? TextLayout_GetLineWidth(lines, line, rowPtr, fontSize)
+                               : TextLayout_MeasureSegment(rowPtr, rowLength, fontSize);
+            DrawRectangle(x + endWidth, currentY, (float)(fontSize / 2), (float)fontSize, highlight);
+        }
+    }
 
-    while (1) {
-        const char* linePtr = text + currentIndex;
-        const char* newline = strchr(linePtr, '\n');
-        int lineLength = newline ? (int)(newline - linePtr) : (int)strlen(linePtr);
-        int lineStartIndex = currentIndex;
-        int lineEndIndex = lineStartIndex + lineLength;
+    TextLayout_BeginText();
+    for (int row = firstRow; row <= lastRow; row++) {
+        int rowStartIndex = TextLayout_GetRowStart(lines, row);
+        int rowEndIndex = TextLayout_GetRowEnd(lines, row);
+        if (rowEndIndex > rowStartIndex) {
+            const char* rowPtr = (text != NULL) ? text + rowStartIndex : TextBuffer_GetRange(buffer, rowStartIndex, rowEndIndex);
+            TextLayout_DrawSegment(rowPtr, rowEndIndex - rowStartIndex, (float)x, (float)(y + row * fontSize), fontSize, color);
+        }
+    }
+    TextLayout_EndText();
+}
 
-        if (hasSelection) {
-            int highlightStart = selStart;
-            if (highlightStart < lineStartIndex) highlightStart = lineStartIndex;
-            if (highlightStart > lineEndIndex) highlightStart = lineEndIndex;
+static int GetBoxFontSize(const Box* box) {
+    return box->fontSize > 0 ? box->fontSize : DEFAULT_FONT_SIZE;
+}
 
-            int highlightEnd = selEnd;
-            if (highlightEnd < lineStartIndex) highlightEnd = lineStartIndex;
-            if (highlightEnd > lineEndIndex) highlightEnd = lineEndIndex;
+static Color GetBoxTextColor(const Box* box) {
+    return (box->textColor.a == 0) ? BLACK : box->textColor;
+}
 
-            int highlightLength = highlightEnd - highlightStart;
-            if (highlightLength > 0) {
-                int preLength = highlightStart - lineStartIndex;
-                int preWidth = MeasureTextSegmentWidth(linePtr, preLength, fontSize);
-                int highlightWidth = MeasureTextSegmentWidth(linePtr + preLength, highlightLength, fontSize);
-                if (highlightWidth <= 0) highlightWidth = fontSize / 2;
-                DrawRectangle(x + preWidth, currentY, (float)highlightWidth, (float)fontSize, highlight);
-            } else if (lineLength == 0 && selStart <= lineStartIndex && selEnd > lineStartIndex) {
-                DrawRectangle(x, currentY, (float)(fontSize / 2), (float)fontSize, highlight);
-            }
+/* Power-of-two texture scale for showing a text box at zoom, or 0 when the box
+   is too large to render at that scale and is drawn glyph by glyph instead. */
+static float GetTextRasterScale(const Box* box, float zoom) {
+    float scale = exp2f(ceilf(log2f(zoom)));
+    if (box->width * scale > (float)TEXT_RASTER_MAX_SIZE || box->height * scale > (float)TEXT_RASTER_MAX_SIZE) {
+        return 0.0f;
+    }
+    return scale;
+}
 
-            if (selStart <= lineEndIndex && selEnd > lineEndIndex && newline) {
-                int endWidth = MeasureTextSegmentWidth(linePtr, lineLength, fontSize);
-                DrawRectangle(x + endWidth, currentY, (float)(fontSize / 2), (float)fontSize, highlight);
-            }
-        }
+static int IsTextRasterCurrent(const Box* box) {
+    const BoxTextRaster* raster = box->raster;
+    return raster != NULL && raster->target.id != 0 && !raster->stale &&
+           raster->width == box->width && raster->height == box->height &&
+           raster->fontSize == GetBoxFontSize(box) && ColorsEqual(raster->color, GetBoxTextColor(box));
+}
 
-        if (lineLength > 0) {
-            char* line = CopySubstring(linePtr, lineLength);
-            if (line != NULL) {
-                DrawText(line, x, currentY, fontSize, color);
-                free(line);
-            }
-        }
+static void ReleaseTextRaster(BoxTextRaster* raster) {
+    if (raster == NULL || raster->target.id == 0) {
+        return;
+    }
+    textRasterBytes -= (size_t)raster->target.texture.width * (size_t)raster->target.texture.height * 4;
+    UnloadRenderTexture(raster->target);
+    raster->target = (RenderTexture2D){0};
+}
 
-        if (!newline) {
-            break;
+/* Renders the box's background and text into its raster. Must run outside
+   BeginDrawing and any other texture mode. */
+static void RenderTextRaster(Box* box, float scale) {
+    BoxTextRaster* raster = box->raster;
+    int textureWidth = (int)ceilf(box->width * scale);
+    int textureHeight = (int)ceilf(box->height * scale);
+    if (raster->target.id == 0 || raster->target.texture.width != textureWidth ||
+        raster->target.texture.height != textureHeight) {
+        ReleaseTextRaster(raster);
+        raster->target = LoadRenderTexture(textureWidth, textureHeight);
+        if (raster->target.id == 0) {
+            return;
         }
+        SetTextureFilter(raster->target.texture, TEXTURE_FILTER_BILINEAR);
+        textRasterBytes += (size_t)textureWidth * (size_t)textureHeight * 4;
+    }
+
+    Camera2D rasterCamera = {0};
+    rasterCamera.target = (Vector2){(float)box->x, (float)box->y};
+    rasterCamera.zoom = scale;
+    int fontSize = GetBoxFontSize(box);
+    Color color = GetBoxTextColor(box);
+
+    BeginTextureMode(raster->target);
+    ClearBackground(WHITE);
+    BeginMode2D(rasterCamera);
+    DrawMultilineTextWithSelection(box->content.text, NULL, box->lines, box->x + 10, box->y + 10, fontSize, box->wrapWidth, color, 0, 0, TEXT_SELECTION_COLOR, GetBoxRect(box));
+    EndMode2D();
+    EndTextureMode();
+
+    raster->stale = 0;
+    raster->width = box->width;
+    raster->height = box->height;
+    raster->fontSize = fontSize;
+    raster->color = color;
+    raster->scale = scale;
+}
 
-        currentIndex = lineEndIndex + 1;
-        currentY += fontSize;
+static void DrawTextRaster(const Box* box) {
+    const BoxTextRaster* raster = box->raster;
+    /* Render textures are stored bottom-up, so the box sits at the top of the texture. */
+    float sourceWidth = box->width * raster->scale;
+    float sourceHeight = box->height * raster->scale;
+    Rectangle source = {0.0f, (float)raster->target.texture.height - sourceHeight, sourceWidth, -sourceHeight};
+    Rectangle dest = {(float)box->x, (float)box->y, (float)box->width, (float)box->height};
+    DrawTexturePro(raster->target.texture, source, dest, (Vector2){0.0f, 0.0f}, 0.0f, WHITE);
+}
 
-        if (currentIndex > totalLength) {
-            break;
+/* Brings the rasters of visible text boxes up to date for the camera's zoom,
+   rendering only those whose text, style, size or scale changed. When the
+   rasters outgrow their memory budget, those of boxes off screen are dropped.
+   Must run outside BeginDrawing. */
+static void UpdateTextRasters(Box* boxes, int boxCount, Camera2D camera, Rectangle view) {
+    static unsigned int frame = 0;
+    frame++;
+
+    const int* order = NULL;
+    int count = SceneIndex_QueryRect(view, boxes, boxCount, &order);
+    for (int i = 0; i < count; i++) {
+        Box* box = &boxes[order[i]];
+        if (box->type != BOX_TEXT || order[i] == editingBoxIndex) {
+            continue;
+        }
+        float scale = GetTextRasterScale(box, camera.zoom);
+        if (scale <= 0.0f) {
+            continue;
+        }
+        if (box->raster == NULL) {
+            box->raster = (BoxTextRaster*)calloc(1, sizeof(BoxTextRaster));
+            if (box->raster == NULL) {
+                continue;
+            }
         }
+        box->raster->usedFrame = frame;
+        if (!IsTextRasterCurrent(box) || box->raster->scale != scale) {
+            RenderTextRaster(box, scale);
+        }
+    }
 
-        if (currentIndex == totalLength) {
-            if (hasSelection && selStart <= currentIndex && selEnd > currentIndex) {
-                DrawRectangle(x, currentY, (float)(fontSize / 2), (float)fontSize, highlight);
+    if (textRasterBytes > TEXT_RASTER_MEMORY_BUDGET) {
+        for (int i = 0; i < boxCount; i++) {
+            if (boxes[i].type == BOX_TEXT && boxes[i].raster != NULL && boxes[i].raster->usedFrame != frame) {
+                ReleaseTextRaster(boxes[i].raster);
             }
-            break;
         }
     }
 }
@@ -937,13 +1099,20 @@ void StartTextEdit(int boxIndex, Box* boxes) {
             boxes[boxIndex].textColor = BLACK;
         }
         editingBoxIndex = boxIndex;
-        strncpy(editingText, boxes[boxIndex].content.text, sizeof(editingText) - 1);
-        editingText[sizeof(editingText) - 1] = '\0';
-        strncpy(editingOriginalText, editingText, sizeof(editingOriginalText) - 1);
-        editingOriginalText[sizeof(editingOriginalText) - 1] = '\0';
+        FreeSnapshot(&editingBeforeState);
+        CaptureSnapshot(&editingBeforeState, &boxes[boxIndex], 1);
+        const char* text = boxes[boxIndex].content.text != NULL ? boxes[boxIndex].content.text : "";
+        int length = (int)strlen(text);
+        TextBuffer_SetText(&editingBuffer, text, length);
+        /* Start from the box's index so its measured line widths carry over. */
+        if (boxes[boxIndex].lines == NULL || boxes[boxIndex].lines->length != length ||
+            !TextLayout_CopyLines(&editingLines, boxes[boxIndex].lines)) {
+            TextLayout_IndexLines(&editingLines, text, length);
+        }
         editingFontSize = boxes[boxIndex].fontSize > 0 ? boxes[boxIndex].fontSize : DEFAULT_FONT_SIZE;
         editingOriginalFontSize = editingFontSize;
-        cursorPosition = strlen(editingText);
+        editingWrapWidth = boxes[boxIndex].wrapWidth;
+        cursorPosition = TextBuffer_GetLength(&editingBuffer);
         if (selectAllOnStart) {
             selectionStart = 0;
             selectionEnd = cursorPosition;
@@ -961,26 +1130,29 @@ void StartTextEdit(int boxIndex, Box* boxes) {
 
 void StopTextEdit(Box* boxes) {
     if (editingBoxIndex >= 0) {
-        /* Update the box text with edited content */
-        if (boxes[editingBoxIndex].content.text) {
-            free(boxes[editingBoxIndex].content.text);
-        }
-        boxes[editingBoxIndex].content.text = strdup(editingText);
-
         /* Resize box to fit new text */
         int textWidth, textHeight;
-        CalculateTextBoxSize(editingText, editingFontSize, &textWidth, &textHeight);
+        MarkBoxDirty(&boxes[editingBoxIndex]);
+        CalculateEditingTextSize(&textWidth, &textHeight);
+
+        /* Update the box text with edited content */
+        AdoptEditingText(&boxes[editingBoxIndex]);
         boxes[editingBoxIndex].width = textWidth;
         boxes[editingBoxIndex].height = textHeight;
         boxes[editingBoxIndex].fontSize = editingFontSize;
+        SceneIndex_Update(boxes, editingBoxIndex);
+        MarkBoxDirty(&boxes[editingBoxIndex]);
 
-        lastTextEditChanged = (strcmp(editingOriginalText, editingText) != 0) || (editingOriginalFontSize != editingFontSize);
+        const char* originalText = editingBeforeState.textCopy;
+        lastTextEditChanged = originalText == NULL || strcmp(originalText, boxes[editingBoxIndex].content.text) != 0 ||
+                              (editingOriginalFontSize != editingFontSize);
 
         editingBoxIndex = -1;
-        memset(editingText, 0, sizeof(editingText));
-        memset(editingOriginalText, 0, sizeof(editingOriginalText));
+        TextBuffer_SetText(&editingBuffer, NULL, 0);
+        TextLayout_IndexLines(&editingLines, "", 0);
         editingFontSize = DEFAULT_FONT_SIZE;
         editingOriginalFontSize = DEFAULT_FONT_SIZE;
+        editingWrapWidth = 0;
         cursorPosition = 0;
         selectionStart = 0;
         selectionEnd = 0;
@@ -990,21 +1162,46 @@ void StopTextEdit(Box* boxes) {
 }
 
 void StopTextEditAndRecord(Box* boxes, int boxCount, int selectedBox) {
+    int editedIndex = editingBoxIndex;
     StopTextEdit(boxes);
-    if (lastTextEditChanged) {
-        PushHistoryState(boxes, boxCount, selectedBox);
-        lastTextEditChanged = 0;
+    if (lastTextEditChanged && editedIndex >= 0 && editedIndex < boxCount) {
+        PushModifyHistory(&editingBeforeState, &boxes[editedIndex], selectedBox);
     }
+    FreeSnapshot(&editingBeforeState);
+    lastTextEditChanged = 0;
 }
 
 void UpdateEditingBoxSize(Box* boxes) {
     if (editingBoxIndex < 0) return;
 
     int textWidth, textHeight;
-    CalculateTextBoxSize(editingText, editingFontSize, &textWidth, &textHeight);
+    MarkBoxDirty(&boxes[editingBoxIndex]);
+    CalculateEditingTextSize(&textWidth, &textHeight);
     boxes[editingBoxIndex].width = textWidth;
     boxes[editingBoxIndex].height = textHeight;
     boxes[editingBoxIndex].fontSize = editingFontSize;
+    SceneIndex_Update(boxes, editingBoxIndex);
+    MarkBoxDirty(&boxes[editingBoxIndex]);
+}
+
+/* Wraps a text box's lines at its new width, less padding, and fits its
+   height to the rows. Every line is wrapped again for the new width. */
+static void ReflowTextBox(Box* boxes, int index) {
+    Box* box = &boxes[index];
+    int wrapWidth = box->width - 20;
+    if (wrapWidth < 1) wrapWidth = 1;
+    box->wrapWidth = wrapWidth;
+    if (index == editingBoxIndex) {
+        editingWrapWidth = wrapWidth;
+        CalculateEditingTextSize(&box->width, &box->height);
+        return;
+    }
+    int fontSize = GetBoxFontSize(box);
+    int rows = 1;
+    if (box->lines != NULL && box->content.text != NULL) {
+        rows = WrapTextLines(box->content.text, NULL, box->lines, fontSize, wrapWidth);
+    }
+    GetTextBoxSizeForLines(0, rows, fontSize, wrapWidth, &box->width, &box->height);
 }
 
 void HandleTextInput(Box* boxes, char* statusMessage, size_t statusMessageSize, float* statusMessageTimer) {
@@ -1045,9 +1242,7 @@ void HandleTextInput(Box* boxes, char* statusMessage, size_t statusMessageSize,
 
     if (ctrlDown && IsKeyPressed(KEY_C)) {
         if (SelectionHasRange()) {
-            int start = SelectionMin();
-            int length = SelectionMax() - start;
-            char* sliced = CopySubstring(editingText + start, length);
+            char* sliced = TextBuffer_CopyRange(&editingBuffer, SelectionMin(), SelectionMax());
             if (sliced != NULL) {
                 SetClipboardText(sliced);
                 free(sliced);
@@ -1057,9 +1252,7 @@ void HandleTextInput(Box* boxes, char* statusMessage, size_t statusMessageSize,
 
     if (ctrlDown && IsKeyPressed(KEY_X)) {
         if (SelectionHasRange()) {
-            int start = SelectionMin();
-            int length = SelectionMax() - start;
-            char* sliced = CopySubstring(editingText + start, length);
+            char* sliced = TextBuffer_CopyRange(&editingBuffer, SelectionMin(), SelectionMax());
             if (sliced != NULL) {
                 SetClipboardText(sliced);
                 free(sliced);
@@ -1075,18 +1268,8 @@ void HandleTextInput(Box* boxes, char* statusMessage, size_t statusMessageSize,
                 textChanged |= DeleteSelectionRange();
             }
 
-            int currentLen = (int)strlen(editingText);
-            int available = (int)sizeof(editingText) - 1 - currentLen;
-            if (available > 0) {
-                int clipLen = (int)strlen(clip);
-                if (clipLen > available) {
-                    clipLen = available;
-                }
-
-                memmove(editingText + cursorPosition + clipLen,
-                        editingText + cursorPosition,
-                        (size_t)(currentLen - cursorPosition + 1));
-                memcpy(editingText + cursorPosition, clip, (size_t)clipLen);
+            int clipLen = (int)strlen(clip);
+            if (InsertEditingText(cursorPosition, clip, clipLen)) {
                 MoveCursorTo(cursorPosition + clipLen, 0);
                 textChanged = 1;
             }
@@ -1097,16 +1280,11 @@ void HandleTextInput(Box* boxes, char* statusMessage, size_t statusMessageSize,
     int key = GetCharPressed();
     while (key > 0) {
         if (!ctrlDown && key >= 32 && key <= 126) {
-            int currentLength = (int)strlen(editingText);
-            if (currentLength < (int)sizeof(editingText) - 1) {
-                if (DeleteSelectionRange()) {
-                    textChanged = 1;
-                }
-                /* Insert character */
-                for (int i = currentLength; i >= cursorPosition; i--) {
-                    editingText[i + 1] = editingText[i];
-                }
-                editingText[cursorPosition] = (char)key;
+            if (DeleteSelectionRange()) {
+                textChanged = 1;
+            }
+            char character = (char)key;
+            if (InsertEditingText(cursorPosition, &character, 1)) {
                 MoveCursorTo(cursorPosition + 1, 0);
                 textChanged = 1;
             }
@@ -1116,22 +1294,17 @@ void HandleTextInput(Box* boxes, char* statusMessage, size_t statusMessageSize,
 
     if (ctrlDown && IsKeyPressed(KEY_A)) {
         selectionStart = 0;
-        selectionEnd = (int)strlen(editingText);
+        selectionEnd = TextBuffer_GetLength(&editingBuffer);
         cursorPosition = selectionEnd;
         cursorBlinkTime = 0.0f;
         cursorPreferredColumn = -1;
     }
 
     if (IsKeyPressed(KEY_ENTER)) {
-        int currentLength = (int)strlen(editingText);
-        if (currentLength < (int)sizeof(editingText) - 1) {
-            if (DeleteSelectionRange()) {
-                textChanged = 1;
-            }
-            for (int i = currentLength; i >= cursorPosition; i--) {
-                editingText[i + 1] = editingText[i];
-            }
-            editingText[cursorPosition] = '\n';
+        if (DeleteSelectionRange()) {
+            textChanged = 1;
+        }
+        if (InsertEditingText(cursorPosition, "\n", 1)) {
             MoveCursorTo(cursorPosition + 1, 0);
             textChanged = 1;
         }
@@ -1141,10 +1314,7 @@ void HandleTextInput(Box* boxes, char* statusMessage, size_t statusMessageSize,
         if (SelectionHasRange()) {
             textChanged |= DeleteSelectionRange();
         } else if (cursorPosition > 0) {
-            int len = (int)strlen(editingText);
-            for (int i = cursorPosition - 1; i < len; i++) {
-                editingText[i] = editingText[i + 1];
-            }
+            DeleteEditingText(cursorPosition - 1, cursorPosition);
             MoveCursorTo(cursorPosition - 1, 0);
             textChanged = 1;
         }
@@ -1154,11 +1324,8 @@ void HandleTextInput(Box* boxes, char* statusMessage, size_t statusMessageSize,
         if (SelectionHasRange()) {
             textChanged |= DeleteSelectionRange();
         } else {
-            int len = (int)strlen(editingText);
-            if (cursorPosition < len) {
-                for (int i = cursorPosition; i < len; i++) {
-                    editingText[i] = editingText[i + 1];
-                }
+            if (cursorPosition < TextBuffer_GetLength(&editingBuffer)) {
+                DeleteEditingText(cursorPosition, cursorPosition + 1);
                 textChanged = 1;
                 cursorBlinkTime = 0.0f;
                 cursorPreferredColumn = -1;
@@ -1170,7 +1337,7 @@ void HandleTextInput(Box* boxes, char* statusMessage, size_t statusMessageSize,
         if (!shiftDown && SelectionHasRange()) {
             MoveCursorTo(SelectionMin(), 0);
         } else if (ctrlDown) {
-            int newPos = FindPreviousWordBoundary(editingText, cursorPosition);
+            int newPos = FindPreviousWordBoundary(&editingBuffer, cursorPosition);
             MoveCursorTo(newPos, shiftDown);
         } else {
             MoveCursorTo(cursorPosition - 1, shiftDown);
@@ -1181,7 +1348,7 @@ void HandleTextInput(Box* boxes, char* statusMessage, size_t statusMessageSize,
         if (!shiftDown && SelectionHasRange()) {
             MoveCursorTo(SelectionMax(), 0);
         } else if (ctrlDown) {
-            int newPos = FindNextWordBoundary(editingText, cursorPosition);
+            int newPos = FindNextWordBoundary(&editingBuffer, cursorPosition);
             MoveCursorTo(newPos, shiftDown);
         } else {
             MoveCursorTo(cursorPosition + 1, shiftDown);
@@ -1192,18 +1359,18 @@ void HandleTextInput(Box* boxes, char* statusMessage, size_t statusMessageSize,
         if (ctrlDown) {
             MoveCursorTo(0, shiftDown);
         } else {
-            int start = GetLineStartIndex(editingText, cursorPosition);
-            MoveCursorTo(start, shiftDown);
+            WrapEditingLines();
+            int row = TextLayout_FindRow(&editingLines, cursorPosition);
+            MoveCursorTo(TextLayout_GetRowStart(&editingLines, row), shiftDown);
         }
     }
 
     if (IsKeyPressed(KEY_END)) {
         if (ctrlDown) {
-            int len = (int)strlen(editingText);
-            MoveCursorTo(len, shiftDown);
+            MoveCursorTo(TextBuffer_GetLength(&editingBuffer), shiftDown);
         } else {
-            int end = GetLineEndIndex(editingText, cursorPosition);
-            MoveCursorTo(end, shiftDown);
+            WrapEditingLines();
+            MoveCursorTo(GetEditingRowCaretEnd(TextLayout_FindRow(&editingLines, cursorPosition)), shiftDown);
         }
     }
 
@@ -1229,18 +1396,11 @@ void HandleTextInput(Box* boxes, char* statusMessage, size_t statusMessageSize,
 void DrawTextCursor(int x, int y, int fontSize) {
     if (editingBoxIndex < 0) return;
 
-    /* Update cursor blink timer */
-    cursorBlinkTime += GetFrameTime();
-
-    if (SelectionHasRange()) {
-        /* Still draw the caret at the selection end for clarity */
-        cursorBlinkTime = fmodf(cursorBlinkTime, 1.0f);
-    }
-
-    if (fmodf(cursorBlinkTime, 1.0f) < 0.5f || SelectionHasRange()) {
+    /* Steady at the selection end for clarity, and once the blink has gone idle */
+    if (fmodf(cursorBlinkTime, 1.0f) < 0.5f || cursorBlinkTime >= CARET_BLINK_IDLE_SECONDS || SelectionHasRange()) {
         int relativeX = 0;
         int relativeY = 0;
-        GetCursorCoordinates(editingText, fontSize, cursorPosition, &relativeX, &relativeY);
+        GetCursorCoordinates(fontSize, cursorPosition, &relativeX, &relativeY);
         int drawX = x + 10 + relativeX;
         int drawY = y + 10 + relativeY;
         int caretWidth = (fontSize >= 28) ? 3 : 2;
@@ -1248,22 +1408,18 @@ void DrawTextCursor(int x, int y, int fontSize) {
     }
 }
 
-Rectangle GetBoxRect(const Box* box) {
-    Rectangle rect = {(float)box->x, (float)box->y, (float)box->width, (float)box->height};
-    return rect;
-}
-
 int IsPointInTextDragZone(const Box* box, Vector2 point) {
     Rectangle rect = GetBoxRect(box);
     if (!CheckCollisionPointRec(point, rect)) {
         return 0;
     }
 
+    float border = TEXT_DRAG_BORDER * GetSceneHandleScale();
     Rectangle inner = {
-        rect.x + TEXT_DRAG_BORDER,
-        rect.y + TEXT_DRAG_BORDER,
-        rect.width - 2 * TEXT_DRAG_BORDER,
-        rect.height - 2 * TEXT_DRAG_BORDER
+        rect.x + border,
+        rect.y + border,
+        rect.width - 2 * border,
+        rect.height - 2 * border
     };
 
     if (inner.width <= 0 || inner.height <= 0) {
@@ -1273,85 +1429,10 @@ int IsPointInTextDragZone(const Box* box, Vector2 point) {
     return !CheckCollisionPointRec(point, inner);
 }
 
-void SelectBox(Box* boxes, int boxCount, int index) {
-    for (int i = 0; i < boxCount; i++) {
-        boxes[i].isSelected = (i == index) ? 1 : 0;
-    }
-}
-
-int FindTopmostBoxAtPoint(Vector2 point, Box* boxes, int boxCount) {
-    for (int i = boxCount - 1; i >= 0; i--) {
-        if (GetResizeModeForPoint(&boxes[i], point) != RESIZE_NONE) {
-            return i;
-        }
-        if (CheckCollisionPointRec(point, GetBoxRect(&boxes[i]))) {
-            return i;
-        }
-    }
-    return -1;
-}
-
-ResizeMode GetResizeModeForPoint(const Box* box, Vector2 point) {
-    Rectangle rect = GetBoxRect(box);
-    float x = rect.x;
-    float y = rect.y;
-    float w = rect.width;
-    float h = rect.height;
-
-    Vector2 handleCenters[] = {
-        {x, y},
-        {x + w / 2.0f, y},
-        {x + w, y},
-        {x + w, y + h / 2.0f},
-        {x + w, y + h},
-        {x + w / 2.0f, y + h},
-        {x, y + h},
-        {x, y + h / 2.0f}
-    };
-
-    ResizeMode handleModes[] = {
-        RESIZE_TOP_LEFT,
-        RESIZE_TOP,
-        RESIZE_TOP_RIGHT,
-        RESIZE_RIGHT,
-        RESIZE_BOTTOM_RIGHT,
-        RESIZE_BOTTOM,
-        RESIZE_BOTTOM_LEFT,
-        RESIZE_LEFT
-    };
-
-    for (int i = 0; i < 8; i++) {
-        Rectangle handleRect = {
-            handleCenters[i].x - HANDLE_SIZE / 2.0f,
-            handleCenters[i].y - HANDLE_SIZE / 2.0f,
-            HANDLE_SIZE,
-            HANDLE_SIZE
-        };
-
-        if (CheckCollisionPointRec(point, handleRect)) {
-            return handleModes[i];
-        }
-    }
-
-    const float margin = EDGE_DETECTION_MARGIN;
-    if (point.x >= x - margin && point.x <= x + margin && point.y > y + margin && point.y < y + h - margin) {
-        return RESIZE_LEFT;
-    }
-    if (point.x >= x + w - margin && point.x <= x + w + margin && point.y > y + margin && point.y < y + h - margin) {
-        return RESIZE_RIGHT;
-    }
-    if (point.y >= y - margin && point.y <= y + margin && point.x > x + margin && point.x < x + w - margin) {
-        return RESIZE_TOP;
-    }
-    if (point.y >= y + h - margin && point.y <= y + h + margin && point.x > x + margin && point.x < x + w - margin) {
-        return RESIZE_BOTTOM;
-    }
-
-    return RESIZE_NONE;
-}
-
 void DrawResizeHandles(const Box* box) {
     Rectangle rect = GetBoxRect(box);
+    float scale = GetSceneHandleScale();
+    float handleSize = SCENE_HANDLE_SIZE * scale;
 
     Vector2 handleCenters[] = {
         {rect.x, rect.y},
@@ -1366,14 +1447,42 @@ void DrawResizeHandles(const Box* box) {
 
     for (int i = 0; i < 8; i++) {
         Rectangle handleRect = {
-            handleCenters[i].x - HANDLE_SIZE / 2.0f,
-            handleCenters[i].y - HANDLE_SIZE / 2.0f,
-            HANDLE_SIZE,
-            HANDLE_SIZE
+            handleCenters[i].x - handleSize / 2.0f,
+            handleCenters[i].y - handleSize / 2.0f,
+            handleSize,
+            handleSize
         };
 
         DrawRectangleRec(handleRect, LIGHTGRAY);
-        DrawRectangleLinesEx(handleRect, 1.0f, DARKGRAY);
+        DrawRectangleLinesEx(handleRect, scale, DARKGRAY);
+    }
+}
+
+/* Middle or right drag pans, the wheel zooms around the cursor. Box coordinates
+   are world coordinates, so the canvas has no edges. */
+void UpdateCanvasCamera(Camera2D* camera, Vector2 screenMouse, int* isPanning) {
+    if (IsMouseButtonPressed(MOUSE_BUTTON_MIDDLE) || IsMouseButtonPressed(MOUSE_BUTTON_RIGHT)) {
+        *isPanning = 1;
+    }
+    if (*isPanning) {
+        if (IsMouseButtonDown(MOUSE_BUTTON_MIDDLE) || IsMouseButtonDown(MOUSE_BUTTON_RIGHT)) {
+            Vector2 delta = GetMouseDelta();
+            camera->target.x -= delta.x / camera->zoom;
+            camera->target.y -= delta.y / camera->zoom;
+        } else {
+            *isPanning = 0;
+        }
+    }
+
+    float wheel = GetMouseWheelMove();
+    if (wheel != 0.0f) {
+        Vector2 anchor = GetScreenToWorld2D(screenMouse, *camera);
+        float zoom = camera->zoom * powf(CAMERA_ZOOM_STEP, wheel);
+        if (zoom < CAMERA_MIN_ZOOM) zoom = CAMERA_MIN_ZOOM;
+        if (zoom > CAMERA_MAX_ZOOM) zoom = CAMERA_MAX_ZOOM;
+        camera->offset = screenMouse;
+        camera->target = anchor;
+        camera->zoom = zoom;
     }
 }
 
@@ -1448,39 +1557,425 @@ int MouseCursorForResizeMode(ResizeMode mode) {
     }
 }
 
-int main(void)
-{
+/* Draws a box's content in world coordinates. pointer is the world-space mouse
+   position used for media control hover states; clip is the visible world rect. */
+static void DrawBoxContent(const Box* box, int index, Vector2 pointer, Rectangle clip) {
+    if (box->type == BOX_TEXT) {
+        DrawRectangle(box->x, box->y, box->width, box->height, WHITE);
+    }
+
+    switch (box->type) {
+        case BOX_IMAGE:
+            {
+                Rectangle source = {0.0f, 0.0f, (float)box->content.texture.width, (float)box->content.texture.height};
+                Rectangle dest = {(float)box->x, (float)box->y, (float)box->width, (float)box->height};
+                Vector2 origin = {0.0f, 0.0f};
+                DrawTexturePro(box->content.texture, source, dest, origin, 0.0f, WHITE);
+            }
+            break;
+        case BOX_TEXT:
+            {
+                Color textColor = box->textColor;
+                if (textColor.a == 0) {
+                    textColor = BLACK;
+                }
+                int boxFontSize = box->fontSize > 0 ? box->fontSize : DEFAULT_FONT_SIZE;
+                if (editingBoxIndex == index) {
+                    DrawMultilineTextWithSelection(NULL, &editingBuffer, &editingLines, box->x + 10, box->y + 10, editingFontSize, editingWrapWidth, textColor, selectionStart, selectionEnd, TEXT_SELECTION_COLOR, clip);
+                    DrawTextCursor(box->x, box->y, editingFontSize);
+                } else if (IsTextRasterCurrent(box)) {
+                    DrawTextRaster(box);
+                } else {
+                    DrawMultilineTextWithSelection(box->content.text, NULL, box->lines, box->x + 10, box->y + 10, boxFontSize, box->wrapWidth, textColor, 0, 0, TEXT_SELECTION_COLOR, clip);
+                }
+            }
+            break;
+        case BOX_AUDIO:
+            {
+                Rectangle playRect = GetAudioPlayButtonRect(box);
+                Rectangle loopRect = GetAudioLoopButtonRect(box);
+                Rectangle progressRect = GetAudioProgressRect(box);
+
+                int musicReady = audioDeviceReady && IsMusicReady(box->media->music);
+                int playing = musicReady && IsMusicStreamPlaying(box->media->music);
+
+                float duration = box->media->audioDurationSeconds;
+                float played = box->media->audioTimePlayed;
+                if (duration < 0.0f) duration = 0.0f;
+                if (played < 0.0f) played = 0.0f;
+                if (duration > 0.0f && played > duration) played = duration;
+
+                Color progressBg = musicReady ? Fade(DARKBLUE, 0.20f) : Fade(MAROON, 0.25f);
+                Color progressFill = musicReady ? Fade(DARKBLUE, 0.70f) : Fade(MAROON, 0.55f);
+                DrawRectangleRounded(progressRect, 0.45f, 6, progressBg);
+                if (progressRect.width > 0.0f) {
+                    float ratio = (duration > 0.0f) ? (played / duration) : 0.0f;
+                    if (ratio < 0.0f) ratio = 0.0f;
+                    if (ratio > 1.0f) ratio = 1.0f;
+                    Rectangle fillRect = progressRect;
+                    fillRect.width *= ratio;
+                    if (fillRect.width < 2.0f) {
+                        fillRect.width = 2.0f;
+                    }
+                    DrawRectangleRounded(fillRect, 0.45f, 6, progressFill);
+                }
+
+                char timeNow[16] = {0};
+                char timeTotal[16] = {0};
+                FormatTimeString(played, timeNow, sizeof(timeNow));
+                if (duration <= 0.0f) {
+                    snprintf(timeTotal, sizeof(timeTotal), "--:--");
+                } else {
+                    FormatTimeString(duration, timeTotal, sizeof(timeTotal));
+                }
+                int timeFont = 16;
+                TextLayout_DrawText(timeNow, (int)progressRect.x, (int)progressRect.y - 20, timeFont, Fade(DARKBLUE, 0.85f));
+                int totalWidth = TextLayout_MeasureText(timeTotal, timeFont);
+                TextLayout_DrawText(timeTotal, (int)(progressRect.x + progressRect.width - totalWidth), (int)progressRect.y - 20, timeFont, Fade(DARKBLUE, 0.85f));
+
+                bool playHover = CheckCollisionPointRec(pointer, playRect);
+                bool loopHover = CheckCollisionPointRec(pointer, loopRect);
+
+                Color playFill;
+                Color playOutline = Fade(BLACK, 0.35f);
+                if (!musicReady) {
+                    playFill = Fade(MAROON, playHover ? 0.55f : 0.45f);
+                } else if (playing) {
+                    playFill = Fade(DARKGREEN, playHover ? 0.75f : 0.60f);
+                } else {
+                    playFill = Fade(DARKBLUE, playHover ? 0.75f : 0.55f);
+                }
+                DrawRectangleRounded(playRect, 0.45f, 6, playFill);
+                DrawRectangleRoundedLines(playRect, 0.45f, 6, 2.0f, playOutline);
+                if (!musicReady) {
+                    DrawLine((int)playRect.x + 6, (int)playRect.y + 6, (int)(playRect.x + playRect.width) - 6, (int)(playRect.y + playRect.height) - 6, RAYWHITE);
+                    DrawLine((int)playRect.x + 6, (int)(playRect.y + playRect.height) - 6, (int)(playRect.x + playRect.width) - 6, (int)playRect.y + 6, RAYWHITE);
+                } else if (playing) {
+                    float pad = 6.0f;
+                    DrawRectangle((int)(playRect.x + pad), (int)(playRect.y + pad), 6, (int)(playRect.height - pad * 2.0f), RAYWHITE);
+                    DrawRectangle((int)(playRect.x + playRect.width - pad - 6.0f), (int)(playRect.y + pad), 6, (int)(playRect.height - pad * 2.0f), RAYWHITE);
+                } else {
+                    Vector2 p1 = {playRect.x + 8.0f, playRect.y + 6.0f};
+                    Vector2 p2 = {playRect.x + 8.0f, playRect.y + playRect.height - 6.0f};
+                    Vector2 p3 = {playRect.x + playRect.width - 6.0f, playRect.y + playRect.height * 0.5f};
+                    DrawTriangle(p1, p2, p3, RAYWHITE);
+                }
+
+                Color loopFill;
+                if (!musicReady) {
+                    loopFill = Fade(GRAY, loopHover ? 0.5f : 0.4f);
+                } else if (box->media->audioLoop) {
+                    loopFill = Fade(DARKGREEN, loopHover ? 0.75f : 0.60f);
+                } else {
+                    loopFill = Fade(DARKBLUE, loopHover ? 0.65f : 0.45f);
+                }
+
+                DrawRectangleRounded(loopRect, 0.45f, 6, loopFill);
+                DrawRectangleRoundedLines(loopRect, 0.45f, 6, 2.0f, Fade(BLACK, loopHover ? 0.45f : 0.35f));
+
+                int loopTextWidth = TextLayout_MeasureText("Loop", 16);
+                float loopTextX = loopRect.x + (loopRect.width - loopTextWidth) * 0.5f;
+                float loopTextY = loopRect.y + (loopRect.height - 16.0f) * 0.5f;
+                TextLayout_DrawText("Loop", (int)loopTextX, (int)loopTextY, 16, RAYWHITE);
+
+                const char* hintText = NULL;
+                Color hintColor = DARKGRAY;
+                if (!audioDeviceReady) {
+                    hintText = "Audio disabled";
+                    hintColor = MAROON;
+                } else if (!musicReady) {
+                    hintText = "Audio failed to load";
+                    hintColor = MAROON;
+                } else if (playing) {
+                    hintText = "Playing (Space / dbl-click)";
+                    hintColor = DARKGREEN;
+                } else {
+                    hintText = "Paused (Space / dbl-click)";
+                    hintColor = DARKBLUE;
+                }
+                TextLayout_DrawText(hintText, box->x + 16, box->y + box->height - 32, 16, hintColor);
+            }
+            break;
+        case BOX_VIDEO:
+            {
+                Rectangle dest = {(float)box->x, (float)box->y, (float)box->width, (float)box->height};
+                DrawRectangleRec(dest, Fade(BLACK, 0.15f));
+                DrawRectangleLines(box->x, box->y, box->width, box->height, Fade(DARKBLUE, 0.45f));
+
+                Texture2D* tex = WinVideo_GetTexture(box->content.video);
+                if (tex != NULL && tex->id != 0 && WinVideo_IsReady(box->content.video)) {
+                    Rectangle source = {0.0f, 0.0f, (float)tex->width, (float)tex->height};
+                    DrawTexturePro(*tex, source, dest, (Vector2){0.0f, 0.0f}, 0.0f, WHITE);
+                } else {
+                    DrawRectangleLinesEx(dest, 2.0f, Fade(WHITE, 0.2f));
+                    TextLayout_DrawText("Loading video...", box->x + 16, box->y + (box->height / 2) - 12, 20, LIGHTGRAY);
+                }
+
+                const char* fileName = ExtractFileName(box->filePath);
+                if (fileName == NULL || fileName[0] == '\0') {
+                    fileName = "(Video)";
+                }
+                int titleFont = 20;
+                while (titleFont > 12 && TextLayout_MeasureText(fileName, titleFont) > box->width - 32) {
+                    titleFont -= 2;
+                }
+
+                int infoBarHeight = (box->media->videoConvertSamples > 0u) ? 56 : 32;
+                DrawRectangle(box->x, box->y, box->width, infoBarHeight, Fade(BLACK, 0.35f));
+                TextLayout_DrawText(fileName, box->x + 16, box->y + 8, titleFont, RAYWHITE);
+
+                int statsFont = 16;
+                char frameStats[80];
+                snprintf(frameStats, sizeof(frameStats), "Frames: %d real · %d fallback", box->media->videoDecodedFrames, box->media->videoFallbackFrames);
+                Color statsColor = (box->media->videoFallbackFrames > 0) ? ORANGE : Fade(RAYWHITE, 0.85f);
+                int statsWidth = TextLayout_MeasureText(frameStats, statsFont);
+                int statsX = box->x + box->width - statsWidth - 16;
+                if (statsX < box->x + 16) {
+                    statsX = box->x + 16;
+                }
+                TextLayout_DrawText(frameStats, statsX, box->y + 8, statsFont, statsColor);
+
+                if (box->media->videoConvertSamples > 0u) {
+                    float avgMs = box->media->videoConvertAvgUs / 1000.0f;
+                    float peakMs = box->media->videoConvertPeakUs / 1000.0f;
+                    unsigned int sampleCount = box->media->videoConvertSamples;
+                    const char* formatLabel = (box->media->videoFormatLabel[0] != '\0') ? box->media->videoFormatLabel : "Unknown";
+                    char convertStats[112];
+                    snprintf(convertStats, sizeof(convertStats), "Convert: %.2f ms avg · %.2f ms peak · %s · n=%u",
+                             avgMs, peakMs, formatLabel, sampleCount);
+                    int convertFont = 15;
+                    Color convertColor = (box->media->videoFallbackFrames > 0) ? ORANGE : Fade(RAYWHITE, 0.78f);
+                    TextLayout_DrawText(convertStats, box->x + 16, box->y + 32, convertFont, convertColor);
+                }
+                Rectangle transportBar = { (float)box->x, (float)box->y + (float)box->height - 68.0f, (float)box->width, 68.0f };
+                DrawRectangleRec(transportBar, Fade(BLACK, 0.35f));
+
+                Rectangle playRect = GetVideoPlayButtonRect(box);
+                Rectangle loopRect = GetVideoLoopButtonRect(box);
+                Rectangle progressRect = GetVideoProgressRect(box);
+
+                int paused = WinVideo_IsPaused(box->content.video);
+                int loopEnabled = box->media->videoLoop;
+                double duration = box->media->videoDurationSeconds;
+                if (duration < 0.0) duration = 0.0;
+                double position = box->media->videoPositionSeconds;
+                if (position < 0.0) position = 0.0;
+                if (duration > 0.0 && position > duration) position = duration;
+
+                DrawRectangleRounded(progressRect, 0.45f, 6, Fade(RAYWHITE, 0.18f));
+                if (progressRect.width > 0.0f) {
+                    double ratio = (duration > 0.0) ? (position / duration) : 0.0;
+                    if (ratio < 0.0) ratio = 0.0;
+                    if (ratio > 1.0) ratio = 1.0;
+                    Rectangle fillRect = progressRect;
+                    fillRect.width *= (float)ratio;
+                    if (fillRect.width < 2.0f) {
+                        fillRect.width = 2.0f;
+                    }
+                    DrawRectangleRounded(fillRect, 0.45f, 6, Fade(SKYBLUE, 0.8f));
+                }
+
+                char timeNow[16] = {0};
+                char timeTotal[16] = {0};
+                FormatTimeString(position, timeNow, sizeof(timeNow));
+                if (duration <= 0.0) {
+                    snprintf(timeTotal, sizeof(timeTotal), "--:--");
+                } else {
+                    FormatTimeString(duration, timeTotal, sizeof(timeTotal));
+                }
+                int timeFont = 18;
+                TextLayout_DrawText(timeNow, (int)progressRect.x, (int)progressRect.y - 24, timeFont, RAYWHITE);
+                int totalWidth = TextLayout_MeasureText(timeTotal, timeFont);
+                TextLayout_DrawText(timeTotal, (int)(progressRect.x + progressRect.width - totalWidth), (int)progressRect.y - 24, timeFont, RAYWHITE);
+
+                bool playHover = CheckCollisionPointRec(pointer, playRect);
+                bool loopHover = CheckCollisionPointRec(pointer, loopRect);
+
+                Color playFill = paused ? Fade(SKYBLUE, playHover ? 0.85f : 0.65f) : Fade(GREEN, playHover ? 0.85f : 0.65f);
+                DrawRectangleRounded(playRect, 0.45f, 8, playFill);
+                DrawRectangleRoundedLines(playRect, 0.45f, 8, 2.0f, Fade(RAYWHITE, 0.6f));
+                if (paused) {
+                    Vector2 p1 = {playRect.x + 10.0f, playRect.y + 6.0f};
+                    Vector2 p2 = {playRect.x + 10.0f, playRect.y + playRect.height - 6.0f};
+                    Vector2 p3 = {playRect.x + playRect.width - 8.0f, playRect.y + playRect.height * 0.5f};
+                    DrawTriangle(p1, p2, p3, RAYWHITE);
+                } else {
+                    float pad = 8.0f;
+                    DrawRectangle((int)(playRect.x + pad), (int)(playRect.y + pad), 8, (int)(playRect.height - pad * 2.0f), RAYWHITE);
+                    DrawRectangle((int)(playRect.x + playRect.width - pad - 8.0f), (int)(playRect.y + pad), 8, (int)(playRect.height - pad * 2.0f), RAYWHITE);
+                }
+
+                Color loopFill = loopEnabled ? Fade(DARKGREEN, loopHover ? 0.8f : 0.65f) : Fade(SKYBLUE, loopHover ? 0.7f : 0.5f);
+                DrawRectangleRounded(loopRect, 0.45f, 8, loopFill);
+                DrawRectangleRoundedLines(loopRect, 0.45f, 8, 2.0f, Fade(RAYWHITE, 0.6f));
+                int loopLabelWidth = TextLayout_MeasureText("Loop", 18);
+                TextLayout_DrawText("Loop", (int)(loopRect.x + (loopRect.width - loopLabelWidth) * 0.5f), (int)(loopRect.y + loopRect.height * 0.5f - 9.0f), 18, RAYWHITE);
+
+                const char* actionLabel = paused ? "Play (Space / dbl-click)" : "Pause (Space / dbl-click)";
+                TextLayout_DrawText(actionLabel, box->x + 16, (int)(transportBar.y + transportBar.height - 28), 18, RAYWHITE);
+            }
+            break;
+        case BOX_DRAWING:
+            {
+                /* Drawn from the vector source at the camera's scale, so tiles and
+                   live boxes are sharp at any zoom and after a resize. */
+                Rectangle dest = {(float)box->x, (float)box->y, (float)box->width, (float)box->height};
+                DrawingShape_Draw(box->content.shape, dest, 1.0f / GetSceneHandleScale());
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/* Selection outline and resize handles, kept at a constant on-screen width. */
+static void DrawBoxSelection(const Box* box, int index) {
+    float px = GetSceneHandleScale();  /* one screen pixel */
+    Rectangle selectionRect = {
+        (float)box->x - px,
+        (float)box->y - px,
+        (float)box->width + 2.0f * px,
+        (float)box->height + 2.0f * px
+    };
+
+    Color borderColor = BOX_SELECTION_BORDER_COLOR;
+
+    if (box->type == BOX_TEXT && editingBoxIndex == index) {
+        Rectangle glowRect = {
+            selectionRect.x - 2.0f * px,
+            selectionRect.y - 2.0f * px,
+            selectionRect.width + 4.0f * px,
+            selectionRect.height + 4.0f * px
+        };
+        DrawRectangleLinesEx(glowRect, 2.0f * px, Fade(TEXT_EDIT_BORDER_COLOR, 0.35f));
+        borderColor = TEXT_EDIT_BORDER_COLOR;
+    }
+
+    DrawRectangleLinesEx(selectionRect, 2.0f * px, borderColor);
+
+    if (box->type == BOX_TEXT || box->type == BOX_IMAGE || box->type == BOX_AUDIO || box->type == BOX_VIDEO) {
+        DrawResizeHandles(box);
+    }
+}
+
+/* Boxes whose pixels change from frame to frame without any scene edit. */
+static int IsBoxAnimating(const Box* box) {
+    if (box->type == BOX_AUDIO) {
+        return box->media != NULL && audioDeviceReady && IsMusicReady(box->media->music) &&
+               IsMusicStreamPlaying(box->media->music);
+    }
+    if (box->type == BOX_VIDEO) {
+        return box->content.video != NULL &&
+               (!WinVideo_IsReady(box->content.video) || !WinVideo_IsPaused(box->content.video));
+    }
+    return 0;
+}
+
+/* Tile callback: cached boxes never show a hover state. */
+static void DrawStaticBox(const Box* boxes, int index, Rectangle clip, void* user) {
+    (void)user;
+    DrawBoxContent(&boxes[index], index, (Vector2){-1.0e9f, -1.0e9f}, clip);
+}
+
+/* Appends the stroke's new segments to the scratch target, so a frame costs the
+   same however long the stroke is. The whole stroke is replayed only when the
+   camera or window changes. Must run outside BeginDrawing; returns 0 when no
+   render texture is available and the caller draws the stroke itself. */
+static int UpdatePenPreview(const PenStroke* stroke, Camera2D camera, int screenWidth, int screenHeight, Color color) {
+    if (penPreviewTarget.id == 0 || penPreviewTarget.texture.width != screenWidth ||
+        penPreviewTarget.texture.height != screenHeight) {
+        if (penPreviewTarget.id != 0) {
+            UnloadRenderTexture(penPreviewTarget);
+        }
+        penPreviewTarget = LoadRenderTexture(screenWidth, screenHeight);
+        penPreviewPoints = 0;
+    }
+    if (penPreviewTarget.id == 0) {
+        return 0;
+    }
+
+    if (camera.zoom != penPreviewCamera.zoom ||
+        camera.target.x != penPreviewCamera.target.x || camera.target.y != penPreviewCamera.target.y ||
+        camera.offset.x != penPreviewCamera.offset.x || camera.offset.y != penPreviewCamera.offset.y) {
+        penPreviewCamera = camera;
+        penPreviewPoints = 0;
+    }
+    if (penPreviewPoints >= stroke->count) {
+        return 1;
+    }
+
+    float radius = STROKE_THICKNESS * 0.5f;
+    BeginTextureMode(penPreviewTarget);
+    if (penPreviewPoints == 0) {
+        ClearBackground(BLANK);
+    }
+    BeginMode2D(penPreviewCamera);
+    if (penPreviewPoints == 0) {
+        DrawCircleV(stroke->points[0], radius, color);
+        penPreviewPoints = 1;
+    }
+    for (int i = penPreviewPoints; i < stroke->count; i++) {
+        DrawLineEx(stroke->points[i - 1], stroke->points[i], STROKE_THICKNESS, color);
+        DrawCircleV(stroke->points[i], radius, color);
+    }
+    EndMode2D();
+    EndTextureMode();
+    penPreviewPoints = stroke->count;
+    return 1;
+}
+
+static void LoadCanvasFont(void) {
+    if (TextLayout_LoadFont(TextFormat("%s%s", GetApplicationDirectory(), CANVAS_FONT_FILE))) {
+        return;
+    }
+    int count = (int)(sizeof(CANVAS_SYSTEM_FONTS) / sizeof(CANVAS_SYSTEM_FONTS[0]));
+    for (int i = 0; i < count; i++) {
+        if (TextLayout_LoadFont(CANVAS_SYSTEM_FONTS[i])) {
+            return;
+        }
+    }
+    TraceLog(LOG_INFO, "No canvas font found, using the default font");
+}
+
+int main(void)
+{
     const int screenWidth = 800;
     const int screenHeight = 600;
 
     SetConfigFlags(FLAG_WINDOW_RESIZABLE);
 
     InitWindow(screenWidth, screenHeight, "Desktop Canvas App");
+    LoadCanvasFont();
     InitAudioDevice();
     audioDeviceReady = IsAudioDeviceReady();
     if (!audioDeviceReady) {
         TraceLog(LOG_WARNING, "Audio device failed to initialize");
     }
 
-    Box boxes[MAX_BOXES] = {0};
+    Box* boxes = NULL;
     int boxCount = 0;
+    int boxCapacity = 0;
     int selectedBox = -1;
     Vector2 mousePos, prevMousePos;
+    Vector2 screenMousePos = {0}, prevScreenMousePos = {0};
+    Vector2 dragRemainder = {0};
+    Camera2D camera = {0};
+    camera.zoom = 1.0f;
+    int isPanning = 0;
     int isDragging = 0;
     ResizeMode resizeMode = RESIZE_NONE;
     Tool currentTool = TOOL_SELECT;
     int isDrawing = 0;
     int startX, startY;
     Color currentDrawColor = BLACK;
-    Vector2 penPoints[MAX_PEN_POINTS];
-    int penPointCount = 0;
-    float penMinX = 0.0f, penMinY = 0.0f, penMaxX = 0.0f, penMaxY = 0.0f;
+    PenStroke penStroke = {0};
     int requestExportClipboard = 0;
     float statusMessageTimer = 0.0f;
     char statusMessage[128] = {0};
     int showClearConfirm = 0;
     int dragBoxValid = 0;
     int dragChanged = 0;
+    BoxSnapshot dragBeforeState = {0};
 
     if (!audioDeviceReady) {
         snprintf(statusMessage, sizeof(statusMessage), "Audio disabled: device unavailable");
@@ -1493,16 +1988,45 @@ int main(void)
     const double doubleClickInterval = 0.5;  /* 500ms */
     const float doubleClickDistance = 10.0f;  /* 10 pixel tolerance */
 
-    SetTargetFPS(60);
+    SetTargetFPS(TARGET_FPS);
 
     int currentCursor = MOUSE_CURSOR_DEFAULT;
 
-    PushHistoryState(boxes, boxCount, selectedBox);
+    /* When nothing animates on its own the loop blocks in EndDrawing until the
+       next input event; skipped frames are the 60 Hz slots slept through. */
+    int eventWaiting = 0;
+    double lastFrameStart = 0.0;
+    unsigned long long framesRendered = 0;
+    unsigned long long framesSkipped = 0;
 
     while (!WindowShouldClose())
     {
-        mousePos = GetMousePosition();
+        double frameStart = GetTime();
+        if (eventWaiting && lastFrameStart > 0.0) {
+            long long slots = (long long)((frameStart - lastFrameStart) * TARGET_FPS + 0.5);
+            if (slots > 1) {
+                framesSkipped += (unsigned long long)(slots - 1);
+            }
+        }
+        lastFrameStart = frameStart;
+        framesRendered++;
+        /* The caret blinks until CARET_BLINK_IDLE_SECONDS pass without input, then
+           holds steady so the loop can sleep; input waking it restarts the blink. */
+        if (eventWaiting) {
+            cursorBlinkTime = 0.0f;
+        } else if (editingBoxIndex >= 0 && cursorBlinkTime < CARET_BLINK_IDLE_SECONDS) {
+            cursorBlinkTime += GetFrameTime();
+        }
+
+        screenMousePos = GetMousePosition();
+        if (!showClearConfirm) {
+            UpdateCanvasCamera(&camera, screenMousePos, &isPanning);
+        }
+        SetSceneHandleScale(1.0f / camera.zoom);
+        mousePos = GetScreenToWorld2D(screenMousePos, camera);
+        prevMousePos = GetScreenToWorld2D(prevScreenMousePos, camera);
         float frameDelta = GetFrameTime();
+        PixelStore_Update();
 #ifdef _WIN32
         for (int i = 0; i < boxCount; i++) {
             if (boxes[i].type == BOX_VIDEO && boxes[i].content.video != NULL) {
@@ -1525,31 +2049,31 @@ int main(void)
                 formatLabel = "Unknown";
             }
 
-            unsigned int previousSamples = boxes[i].videoConvertSamples;
+            unsigned int previousSamples = boxes[i].media->videoConvertSamples;
 
-            boxes[i].videoDecodedFrames = decoded;
-            boxes[i].videoFallbackFrames = fallback;
-            boxes[i].videoConvertAvgUs = (float)avgConvertUs;
-            boxes[i].videoConvertPeakUs = (float)peakConvertUs;
-            boxes[i].videoConvertLastUs = (float)lastConvertUs;
-            boxes[i].videoConvertSamples = samples;
-            strncpy(boxes[i].videoFormatLabel, formatLabel, sizeof(boxes[i].videoFormatLabel) - 1);
-            boxes[i].videoFormatLabel[sizeof(boxes[i].videoFormatLabel) - 1] = '\0';
-            boxes[i].videoDurationSeconds = (float)WinVideo_GetDurationSeconds(boxes[i].content.video);
-            boxes[i].videoPositionSeconds = (float)WinVideo_GetPositionSeconds(boxes[i].content.video);
-            boxes[i].videoLoop = WinVideo_IsLooping(boxes[i].content.video);
+            boxes[i].media->videoDecodedFrames = decoded;
+            boxes[i].media->videoFallbackFrames = fallback;
+            boxes[i].media->videoConvertAvgUs = (float)avgConvertUs;
+            boxes[i].media->videoConvertPeakUs = (float)peakConvertUs;
+            boxes[i].media->videoConvertLastUs = (float)lastConvertUs;
+            boxes[i].media->videoConvertSamples = samples;
+            strncpy(boxes[i].media->videoFormatLabel, formatLabel, sizeof(boxes[i].media->videoFormatLabel) - 1);
+            boxes[i].media->videoFormatLabel[sizeof(boxes[i].media->videoFormatLabel) - 1] = '\0';
+            boxes[i].media->videoDurationSeconds = (float)WinVideo_GetDurationSeconds(boxes[i].content.video);
+            boxes[i].media->videoPositionSeconds = (float)WinVideo_GetPositionSeconds(boxes[i].content.video);
+            boxes[i].media->videoLoop = WinVideo_IsLooping(boxes[i].content.video);
 
             if (decoded <= 0 && fallback <= 0) {
-                boxes[i].videoReportedDecoded = 0;
+                boxes[i].media->videoReportedDecoded = 0;
             }
 
-            if (fallback > boxes[i].videoReportedFallback) {
+            if (fallback > boxes[i].media->videoReportedFallback) {
                 const char* fileName = boxes[i].filePath != NULL ? ExtractFileName(boxes[i].filePath) : "(Video)";
                 snprintf(statusMessage, sizeof(statusMessage), "Video fallback: %s • %d decoded / %d fallback", fileName, decoded, fallback);
                 statusMessageTimer = 2.6f;
-                boxes[i].videoReportedFallback = fallback;
-                if (decoded > boxes[i].videoReportedDecoded) {
-                    boxes[i].videoReportedDecoded = decoded;
+                boxes[i].media->videoReportedFallback = fallback;
+                if (decoded > boxes[i].media->videoReportedDecoded) {
+                    boxes[i].media->videoReportedDecoded = decoded;
                 }
             } else if (previousSamples == 0 && samples > 0 && statusMessageTimer <= 0.1f) {
                 const char* fileName = boxes[i].filePath != NULL ? ExtractFileName(boxes[i].filePath) : "(Video)";
@@ -1557,16 +2081,52 @@ int main(void)
                 float peakMs = (float)(peakConvertUs / 1000.0);
                 snprintf(statusMessage, sizeof(statusMessage), "Video convert: %s • %s %.2f ms avg (%.2f ms peak)", fileName, formatLabel, avgMs, peakMs);
                 statusMessageTimer = 2.2f;
-            } else if (fallback == 0 && decoded > 0 && boxes[i].videoReportedDecoded == 0 && statusMessageTimer <= 0.05f) {
+            } else if (fallback == 0 && decoded > 0 && boxes[i].media->videoReportedDecoded == 0 && statusMessageTimer <= 0.05f) {
                 const char* fileName = boxes[i].filePath != NULL ? ExtractFileName(boxes[i].filePath) : "(Video)";
                 snprintf(statusMessage, sizeof(statusMessage), "Video ready: %s • %d decoded frames", fileName, decoded);
                 statusMessageTimer = 1.8f;
-                boxes[i].videoReportedDecoded = decoded;
-            } else if (decoded > boxes[i].videoReportedDecoded) {
-                boxes[i].videoReportedDecoded = decoded;
+                boxes[i].media->videoReportedDecoded = decoded;
+            } else if (decoded > boxes[i].media->videoReportedDecoded) {
+                boxes[i].media->videoReportedDecoded = decoded;
             }
         }
 #endif
+
+        for (int i = 0; i < boxCount; i++) {
+            if (boxes[i].type != BOX_AUDIO) {
+                continue;
+            }
+
+            if (!audioDeviceReady || !IsMusicReady(boxes[i].media->music)) {
+                boxes[i].media->audioTimePlayed = 0.0f;
+                if (!audioDeviceReady) {
+                    boxes[i].media->audioStreamStarted = 0;
+                    boxes[i].media->audioWasPlaying = 0;
+                }
+                continue;
+            }
+
+            boxes[i].media->music.looping = boxes[i].media->audioLoop ? 1 : 0;
+
+            if (boxes[i].media->audioStreamStarted) {
+                UpdateMusicStream(boxes[i].media->music);
+            }
+
+            boxes[i].media->audioDurationSeconds = GetMusicTimeLength(boxes[i].media->music);
+            boxes[i].media->audioTimePlayed = GetMusicTimePlayed(boxes[i].media->music);
+
+            int playing = IsMusicStreamPlaying(boxes[i].media->music);
+            if (!playing && boxes[i].media->audioStreamStarted && boxes[i].media->audioWasPlaying) {
+                if (boxes[i].media->audioLoop && boxes[i].media->audioDurationSeconds > 0.0f) {
+                    SeekMusicStream(boxes[i].media->music, 0.0f);
+                    PlayMusicStream(boxes[i].media->music);
+                    boxes[i].media->audioStreamStarted = 1;
+                    playing = 1;
+                }
+            }
+
+            boxes[i].media->audioWasPlaying = playing;
+        }
         int ctrlDown = IsKeyDown(KEY_LEFT_CONTROL) || IsKeyDown(KEY_RIGHT_CONTROL);
         int shiftDown = IsKeyDown(KEY_LEFT_SHIFT) || IsKeyDown(KEY_RIGHT_SHIFT);
 
@@ -1615,7 +2175,7 @@ int main(void)
             }
         }
 
-        int overToolbar = (mousePos.y <= TOOLBAR_HEIGHT);
+        int overToolbar = (screenMousePos.y <= TOOLBAR_HEIGHT);
 
         int hoveredToolIndex = -1;
         int hoveredColorIndex = -1;
@@ -1626,24 +2186,24 @@ int main(void)
 
         if (overToolbar && !showClearConfirm) {
             for (int i = 0; i < 5; i++) {
-                if (CheckCollisionPointRec(mousePos, toolButtons[i])) {
+                if (CheckCollisionPointRec(screenMousePos, toolButtons[i])) {
                     hoveredToolIndex = i;
                     break;
                 }
             }
             for (int i = 0; i < COLOR_PALETTE_COUNT; i++) {
-                if (CheckCollisionPointRec(mousePos, colorButtons[i])) {
+                if (CheckCollisionPointRec(screenMousePos, colorButtons[i])) {
                     hoveredColorIndex = i;
                     break;
                 }
             }
-            hoveredBringToFront = CheckCollisionPointRec(mousePos, bringToFrontButton);
-            hoveredSendToBack = CheckCollisionPointRec(mousePos, sendToBackButton);
-            hoveredExport = CheckCollisionPointRec(mousePos, exportButton);
-            hoveredClear = CheckCollisionPointRec(mousePos, clearButton);
+            hoveredBringToFront = CheckCollisionPointRec(screenMousePos, bringToFrontButton);
+            hoveredSendToBack = CheckCollisionPointRec(screenMousePos, sendToBackButton);
+            hoveredExport = CheckCollisionPointRec(screenMousePos, exportButton);
+            hoveredClear = CheckCollisionPointRec(screenMousePos, clearButton);
         }
 
-        int hoveredBox = FindTopmostBoxAtPoint(mousePos, boxes, boxCount);
+        int hoveredBox = SceneIndex_FindTopmostAtPoint(mousePos, boxes, boxCount);
         ResizeMode hoverResizeMode = RESIZE_NONE;
         if (hoveredBox != -1) {
             hoverResizeMode = GetResizeModeForPoint(&boxes[hoveredBox], mousePos);
@@ -1678,7 +2238,7 @@ int main(void)
                     int actionHandled = 0;
 
                     for (int i = 0; i < 5; i++) {
-                        if (CheckCollisionPointRec(mousePos, toolButtons[i])) {
+                        if (CheckCollisionPointRec(screenMousePos, toolButtons[i])) {
                             currentTool = toolOrder[i];
                             actionHandled = 1;
                             if (currentTool != TOOL_SELECT && editingBoxIndex >= 0) {
@@ -1690,23 +2250,27 @@ int main(void)
 
                     if (!actionHandled) {
                         for (int i = 0; i < COLOR_PALETTE_COUNT; i++) {
-                            if (CheckCollisionPointRec(mousePos, colorButtons[i])) {
+                            if (CheckCollisionPointRec(screenMousePos, colorButtons[i])) {
                                 Color chosenColor = COLOR_PALETTE[i];
                                 int targetIndex = (editingBoxIndex >= 0) ? editingBoxIndex : selectedBox;
                                 int textColorChanged = 0;
                                 currentDrawColor = chosenColor;
 
                                 if (targetIndex != -1 && boxes[targetIndex].type == BOX_TEXT) {
+                                    BoxSnapshot colorBefore;
+                                    CaptureSnapshot(&colorBefore, &boxes[targetIndex], 0);
                                     Color previous = boxes[targetIndex].textColor;
                                     boxes[targetIndex].textColor = chosenColor;
                                     if (!ColorsEqual(previous, chosenColor)) {
                                         textColorChanged = 1;
+                                        MarkBoxDirty(&boxes[targetIndex]);
                                     }
-                                }
 
-                                if (textColorChanged) {
-                                    int historySelection = (targetIndex != -1) ? targetIndex : selectedBox;
-                                    PushHistoryState(boxes, boxCount, historySelection);
+                                    if (textColorChanged) {
+                                        PushModifyHistory(&colorBefore, &boxes[targetIndex], targetIndex);
+                                    } else {
+                                        FreeSnapshot(&colorBefore);
+                                    }
                                 }
                                 actionHandled = 1;
                                 break;
@@ -1714,46 +2278,36 @@ int main(void)
                         }
                     }
 
-                    if (!actionHandled && CheckCollisionPointRec(mousePos, bringToFrontButton) && selectedBox != -1) {
-                        int previousIndex = selectedBox;
-                        int newIndex = BringBoxToFront(boxes, boxCount, selectedBox);
-                        SelectBox(boxes, boxCount, newIndex);
-                        if (editingBoxIndex == selectedBox) {
-                            editingBoxIndex = newIndex;
-                        } else if (editingBoxIndex > selectedBox) {
-                            editingBoxIndex--;
-                        }
-                        selectedBox = newIndex;
-                        if (newIndex != previousIndex) {
-                            PushHistoryState(boxes, boxCount, selectedBox);
+                    if (!actionHandled && CheckCollisionPointRec(screenMousePos, bringToFrontButton) && selectedBox != -1) {
+                        BoxSnapshot orderBefore;
+                        CaptureSnapshot(&orderBefore, &boxes[selectedBox], 0);
+                        if (BringBoxToFront(&boxes[selectedBox])) {
+                            PushModifyHistory(&orderBefore, &boxes[selectedBox], selectedBox);
+                        } else {
+                            FreeSnapshot(&orderBefore);
                         }
                         actionHandled = 1;
                     }
 
-                    if (!actionHandled && CheckCollisionPointRec(mousePos, sendToBackButton) && selectedBox != -1) {
-                        int previousIndex = selectedBox;
-                        int newIndex = SendBoxToBack(boxes, boxCount, selectedBox);
-                        SelectBox(boxes, boxCount, newIndex);
-                        if (editingBoxIndex == selectedBox) {
-                            editingBoxIndex = newIndex;
-                        } else if (editingBoxIndex >= 0 && editingBoxIndex < selectedBox) {
-                            editingBoxIndex++;
-                        }
-                        selectedBox = newIndex;
-                        if (newIndex != previousIndex) {
-                            PushHistoryState(boxes, boxCount, selectedBox);
+                    if (!actionHandled && CheckCollisionPointRec(screenMousePos, sendToBackButton) && selectedBox != -1) {
+                        BoxSnapshot orderBefore;
+                        CaptureSnapshot(&orderBefore, &boxes[selectedBox], 0);
+                        if (SendBoxToBack(&boxes[selectedBox])) {
+                            PushModifyHistory(&orderBefore, &boxes[selectedBox], selectedBox);
+                        } else {
+                            FreeSnapshot(&orderBefore);
                         }
                         actionHandled = 1;
                     }
 
-                    if (!actionHandled && CheckCollisionPointRec(mousePos, exportButton)) {
+                    if (!actionHandled && CheckCollisionPointRec(screenMousePos, exportButton)) {
                         requestExportClipboard = 1;
                         snprintf(statusMessage, sizeof(statusMessage), "Preparing canvas export...");
                         statusMessageTimer = 2.0f;
                         actionHandled = 1;
                     }
 
-                    if (!actionHandled && CheckCollisionPointRec(mousePos, clearButton)) {
+                    if (!actionHandled && CheckCollisionPointRec(screenMousePos, clearButton)) {
                         if (boxCount > 0) {
                             showClearConfirm = 1;
                             isDragging = 0;
@@ -1786,41 +2340,6 @@ int main(void)
                             };
 
                             if (!CheckCollisionPointRec(mousePos, editingRect)) {
-                        for (int i = 0; i < boxCount; i++) {
-                            if (boxes[i].type != BOX_AUDIO) {
-                                continue;
-                            }
-
-                            if (!audioDeviceReady || !IsMusicReady(boxes[i].content.music)) {
-                                boxes[i].audioTimePlayed = 0.0f;
-                                if (!audioDeviceReady) {
-                                    boxes[i].audioStreamStarted = 0;
-                                    boxes[i].audioWasPlaying = 0;
-                                }
-                                continue;
-                            }
-
-                            boxes[i].content.music.looping = boxes[i].audioLoop ? 1 : 0;
-
-                            if (boxes[i].audioStreamStarted) {
-                                UpdateMusicStream(boxes[i].content.music);
-                            }
-
-                            boxes[i].audioDurationSeconds = GetMusicTimeLength(boxes[i].content.music);
-                            boxes[i].audioTimePlayed = GetMusicTimePlayed(boxes[i].content.music);
-
-                            int playing = IsMusicStreamPlaying(boxes[i].content.music);
-                            if (!playing && boxes[i].audioStreamStarted && boxes[i].audioWasPlaying) {
-                                if (boxes[i].audioLoop && boxes[i].audioDurationSeconds > 0.0f) {
-                                    SeekMusicStream(boxes[i].content.music, 0.0f);
-                                    PlayMusicStream(boxes[i].content.music);
-                                    boxes[i].audioStreamStarted = 1;
-                                    playing = 1;
-                                }
-                            }
-
-                            boxes[i].audioWasPlaying = playing;
-                        }
                                 StopTextEditAndRecord(boxes, boxCount, selectedBox);
                             } else {
                                 ResizeMode editHover = GetResizeModeForPoint(&boxes[editingBoxIndex], mousePos);
@@ -1831,7 +2350,7 @@ int main(void)
                                         mousePos.x - (float)boxes[editingBoxIndex].x,
                                         mousePos.y - (float)boxes[editingBoxIndex].y
                                     };
-                                    int caretIndex = GetTextIndexFromPoint(editingText, editingFontSize, localPoint);
+                                    int caretIndex = GetTextIndexFromPoint(editingFontSize, localPoint);
                                     MoveCursorTo(caretIndex, shiftDown);
                                     isMouseSelecting = 1;
                                     cursorPreferredColumn = -1;
@@ -1846,14 +2365,14 @@ int main(void)
                             lastClickTime = 0.0;
                         } else {
                             double currentTime = GetTime();
-                            float dx = mousePos.x - lastClickPos.x;
-                            float dy = mousePos.y - lastClickPos.y;
+                            float dx = screenMousePos.x - lastClickPos.x;
+                            float dy = screenMousePos.y - lastClickPos.y;
                             float clickDistance = sqrtf(dx*dx + dy*dy);
                             int isDoubleClick = (currentTime - lastClickTime < doubleClickInterval) &&
                                                 (clickDistance < doubleClickDistance);
 
                             if (isDoubleClick) {
-                                int clickedBox = FindTopmostBoxAtPoint(mousePos, boxes, boxCount);
+                                int clickedBox = SceneIndex_FindTopmostAtPoint(mousePos, boxes, boxCount);
 
                                 if (clickedBox != -1) {
                                     selectedBox = clickedBox;
@@ -1865,7 +2384,7 @@ int main(void)
                                         ToggleAudioPlayback(&boxes[clickedBox], statusMessage, sizeof(statusMessage), &statusMessageTimer);
                                     } else if (boxes[clickedBox].type == BOX_VIDEO) {
                                         ToggleVideoPlayback(&boxes[clickedBox], statusMessage, sizeof(statusMessage), &statusMessageTimer);
-                                    } else if (boxCount < MAX_BOXES) {
+                                    } else if (EnsureBoxCapacity(&boxes, &boxCapacity, boxCount + 1)) {
                                         int textWidth, textHeight;
                                         const char* newText = "New text";
                                         CalculateTextBoxSize(newText, DEFAULT_FONT_SIZE, &textWidth, &textHeight);
@@ -1875,19 +2394,19 @@ int main(void)
                                         boxes[boxCount].width = textWidth;
                                         boxes[boxCount].height = textHeight;
                                         boxes[boxCount].type = BOX_TEXT;
-                                        boxes[boxCount].content.text = strdup(newText);
+                                        SetBoxText(&boxes[boxCount], strdup(newText));
                                         boxes[boxCount].filePath = NULL;
                                         boxes[boxCount].fontSize = DEFAULT_FONT_SIZE;
                                         boxes[boxCount].textColor = currentDrawColor;
                                         boxes[boxCount].isSelected = 0;
-                                        boxCount++;
+                                        CommitNewBox(boxes, &boxCount);
                                         selectedBox = boxCount - 1;
                                         SelectBox(boxes, boxCount, selectedBox);
                                         selectAllOnStart = 1;
                                         StartTextEdit(selectedBox, boxes);
-                                        PushHistoryState(boxes, boxCount, selectedBox);
+                                        PushCreateHistory(boxes, selectedBox, selectedBox);
                                     }
-                                } else if (boxCount < MAX_BOXES) {
+                                } else if (EnsureBoxCapacity(&boxes, &boxCapacity, boxCount + 1)) {
                                     int textWidth, textHeight;
                                     const char* newText = "New text";
                                     CalculateTextBoxSize(newText, DEFAULT_FONT_SIZE, &textWidth, &textHeight);
@@ -1897,17 +2416,17 @@ int main(void)
                                     boxes[boxCount].width = textWidth;
                                     boxes[boxCount].height = textHeight;
                                     boxes[boxCount].type = BOX_TEXT;
-                                    boxes[boxCount].content.text = strdup(newText);
+                                    SetBoxText(&boxes[boxCount], strdup(newText));
                                     boxes[boxCount].filePath = NULL;
                                     boxes[boxCount].fontSize = DEFAULT_FONT_SIZE;
                                     boxes[boxCount].textColor = currentDrawColor;
                                     boxes[boxCount].isSelected = 0;
-                                    boxCount++;
+                                    CommitNewBox(boxes, &boxCount);
                                     selectedBox = boxCount - 1;
                                     SelectBox(boxes, boxCount, selectedBox);
                                     selectAllOnStart = 1;
                                     StartTextEdit(selectedBox, boxes);
-                                    PushHistoryState(boxes, boxCount, selectedBox);
+                                    PushCreateHistory(boxes, selectedBox, selectedBox);
                                 }
 
                                 lastClickTime = 0.0;
@@ -1915,13 +2434,15 @@ int main(void)
                             }
 
                             lastClickTime = currentTime;
-                            lastClickPos = mousePos;
+                            lastClickPos = screenMousePos;
                         }
 
-                        int clickedBox = FindTopmostBoxAtPoint(mousePos, boxes, boxCount);
+                        int clickedBox = SceneIndex_FindTopmostAtPoint(mousePos, boxes, boxCount);
                         if (clickedBox != -1) {
                             Box* targetBox = &boxes[clickedBox];
                             int handledTransport = 0;
+                            BoxSnapshot transportBefore;
+                            CaptureSnapshot(&transportBefore, targetBox, 0);
                             if (targetBox->type == BOX_AUDIO) {
                                 Rectangle playRect = GetAudioPlayButtonRect(targetBox);
                                 Rectangle loopRect = GetAudioLoopButtonRect(targetBox);
@@ -1930,27 +2451,27 @@ int main(void)
                                     ToggleAudioPlayback(targetBox, statusMessage, sizeof(statusMessage), &statusMessageTimer);
                                     handledTransport = 1;
                                 } else if (CheckCollisionPointRec(mousePos, loopRect)) {
-                                    targetBox->audioLoop = targetBox->audioLoop ? 0 : 1;
-                                    if (audioDeviceReady && IsMusicReady(targetBox->content.music)) {
-                                        targetBox->content.music.looping = targetBox->audioLoop ? 1 : 0;
+                                    targetBox->media->audioLoop = targetBox->media->audioLoop ? 0 : 1;
+                                    if (audioDeviceReady && IsMusicReady(targetBox->media->music)) {
+                                        targetBox->media->music.looping = targetBox->media->audioLoop ? 1 : 0;
                                     }
                                     if (statusMessage && statusMessageTimer) {
-                                        snprintf(statusMessage, sizeof(statusMessage), "Audio loop %s", targetBox->audioLoop ? "enabled" : "disabled");
+                                        snprintf(statusMessage, sizeof(statusMessage), "Audio loop %s", targetBox->media->audioLoop ? "enabled" : "disabled");
                                         statusMessageTimer = 1.4f;
                                     }
                                     handledTransport = 2;
                                 } else if (CheckCollisionPointRec(mousePos, progressRect)) {
-                                    if (audioDeviceReady && IsMusicReady(targetBox->content.music)) {
+                                    if (audioDeviceReady && IsMusicReady(targetBox->media->music)) {
                                         float ratio = (float)((mousePos.x - progressRect.x) / progressRect.width);
                                         if (ratio < 0.0f) ratio = 0.0f;
                                         if (ratio > 1.0f) ratio = 1.0f;
-                                        float length = targetBox->audioDurationSeconds;
+                                        float length = targetBox->media->audioDurationSeconds;
                                         if (length > 0.01f) {
                                             float targetSeconds = length * ratio;
-                                            SeekMusicStream(targetBox->content.music, targetSeconds);
-                                            targetBox->audioTimePlayed = targetSeconds;
-                                            if (targetBox->audioStreamStarted) {
-                                                UpdateMusicStream(targetBox->content.music);
+                                            SeekMusicStream(targetBox->media->music, targetSeconds);
+                                            targetBox->media->audioTimePlayed = targetSeconds;
+                                            if (targetBox->media->audioStreamStarted) {
+                                                UpdateMusicStream(targetBox->media->music);
                                             }
                                             if (statusMessage && statusMessageTimer) {
                                                 char timeNow[16];
@@ -1972,10 +2493,10 @@ int main(void)
                                     ToggleVideoPlayback(targetBox, statusMessage, sizeof(statusMessage), &statusMessageTimer);
                                     handledTransport = 1;
                                 } else if (CheckCollisionPointRec(mousePos, loopRect)) {
-                                    targetBox->videoLoop = targetBox->videoLoop ? 0 : 1;
-                                    WinVideo_SetLooping(targetBox->content.video, targetBox->videoLoop);
+                                    targetBox->media->videoLoop = targetBox->media->videoLoop ? 0 : 1;
+                                    WinVideo_SetLooping(targetBox->content.video, targetBox->media->videoLoop);
                                     if (statusMessage && statusMessageTimer) {
-                                        snprintf(statusMessage, sizeof(statusMessage), "Video loop %s", targetBox->videoLoop ? "enabled" : "disabled");
+                                        snprintf(statusMessage, sizeof(statusMessage), "Video loop %s", targetBox->media->videoLoop ? "enabled" : "disabled");
                                         statusMessageTimer = 1.4f;
                                     }
                                     handledTransport = 2;
@@ -1987,7 +2508,7 @@ int main(void)
                                         if (ratio > 1.0) ratio = 1.0;
                                         double targetSeconds = duration * ratio;
                                         WinVideo_SetPositionSeconds(targetBox->content.video, targetSeconds);
-                                        targetBox->videoPositionSeconds = (float)targetSeconds;
+                                        targetBox->media->videoPositionSeconds = (float)targetSeconds;
                                         if (statusMessage && statusMessageTimer) {
                                             char timeNow[16];
                                             char timeTotal[16];
@@ -2009,7 +2530,7 @@ int main(void)
                                 dragBoxValid = 0;
                                 dragChanged = 0;
                                 if (handledTransport == 2) {
-                                    PushHistoryState(boxes, boxCount, selectedBox);
+                                    PushModifyHistory(&transportBefore, &boxes[selectedBox], selectedBox);
                                 }
                                 lastClickTime = 0.0;
                                 continue;
@@ -2019,8 +2540,10 @@ int main(void)
                             SelectBox(boxes, boxCount, selectedBox);
                             resizeMode = GetResizeModeForPoint(&boxes[selectedBox], mousePos);
                             isDragging = 1;
+                            dragRemainder = (Vector2){0};
                             dragBoxValid = 1;
                             dragChanged = 0;
+                            CaptureSnapshot(&dragBeforeState, &boxes[selectedBox], 0);
 
                             if (boxes[selectedBox].type == BOX_TEXT && editingBoxIndex == selectedBox) {
                                 int onHandle = (resizeMode != RESIZE_NONE);
@@ -2059,15 +2582,8 @@ int main(void)
                         dragBoxValid = 0;
 
                         if (currentTool == TOOL_PEN) {
-                            isDrawing = 1;
-                            penPointCount = 0;
-                            if (penPointCount < MAX_PEN_POINTS) {
-                                penPoints[penPointCount++] = mousePos;
-                                penMinX = mousePos.x;
-                                penMinY = mousePos.y;
-                                penMaxX = mousePos.x;
-                                penMaxY = mousePos.y;
-                            }
+                            isDrawing = DrawingShape_BeginStroke(&penStroke, mousePos);
+                            penPreviewPoints = 0;
                         } else if (currentTool == TOOL_RECT || currentTool == TOOL_CIRCLE || currentTool == TOOL_SEGMENT) {
                             startX = (int)mousePos.x;
                             startY = (int)mousePos.y;
@@ -2078,18 +2594,31 @@ int main(void)
             }
 
             if (IsMouseButtonDown(MOUSE_LEFT_BUTTON) && isDragging && selectedBox != -1) {
-                Vector2 delta = {mousePos.x - prevMousePos.x, mousePos.y - prevMousePos.y};
-                if (resizeMode == RESIZE_NONE) {
-                    boxes[selectedBox].x += (int)delta.x;
-                    boxes[selectedBox].y += (int)delta.y;
-                    if ((int)delta.x != 0 || (int)delta.y != 0) {
-                        dragChanged = 1;
-                    }
-                } else {
-                    ApplyResize(&boxes[selectedBox], resizeMode, delta);
-                    if ((int)delta.x != 0 || (int)delta.y != 0) {
-                        dragChanged = 1;
+                /* Carry sub-unit motion so boxes still follow the cursor when zoomed in. */
+                Vector2 delta = {
+                    mousePos.x - prevMousePos.x + dragRemainder.x,
+                    mousePos.y - prevMousePos.y + dragRemainder.y
+                };
+                dragRemainder.x = delta.x - (float)(int)delta.x;
+                dragRemainder.y = delta.y - (float)(int)delta.y;
+                if ((int)delta.x != 0 || (int)delta.y != 0) {
+                    MarkBoxDirty(&boxes[selectedBox]);
+                    if (resizeMode == RESIZE_NONE) {
+                        boxes[selectedBox].x += (int)delta.x;
+                        boxes[selectedBox].y += (int)delta.y;
+                    } else if (boxes[selectedBox].type == BOX_TEXT) {
+                        /* Text boxes take their height from their wrapped rows. */
+                        int oldWidth = boxes[selectedBox].width;
+                        ApplyResize(&boxes[selectedBox], resizeMode, (Vector2){delta.x, 0.0f});
+                        if (boxes[selectedBox].width != oldWidth) {
+                            ReflowTextBox(boxes, selectedBox);
+                        }
+                    } else {
+                        ApplyResize(&boxes[selectedBox], resizeMode, delta);
                     }
+                    dragChanged = 1;
+                    SceneIndex_Update(boxes, selectedBox);
+                    MarkBoxDirty(&boxes[selectedBox]);
                 }
             }
 
@@ -2105,23 +2634,14 @@ int main(void)
                         mousePos.x - (float)boxes[editingBoxIndex].x,
                         mousePos.y - (float)boxes[editingBoxIndex].y
                     };
-                    int caretIndex = GetTextIndexFromPoint(editingText, editingFontSize, localPoint);
+                    int caretIndex = GetTextIndexFromPoint(editingFontSize, localPoint);
                     MoveCursorTo(caretIndex, 1);
                 }
             }
 
-            if (IsMouseButtonDown(MOUSE_LEFT_BUTTON) && isDrawing && currentTool == TOOL_PEN && penPointCount > 0) {
-                Vector2 lastPoint = penPoints[penPointCount - 1];
-                float dx = mousePos.x - lastPoint.x;
-                float dy = mousePos.y - lastPoint.y;
-                float distSq = dx * dx + dy * dy;
-                if (distSq >= 1.0f && penPointCount < MAX_PEN_POINTS) {
-                    penPoints[penPointCount++] = mousePos;
-                    if (mousePos.x < penMinX) penMinX = mousePos.x;
-                    if (mousePos.y < penMinY) penMinY = mousePos.y;
-                    if (mousePos.x > penMaxX) penMaxX = mousePos.x;
-                    if (mousePos.y > penMaxY) penMaxY = mousePos.y;
-                }
+            if (IsMouseButtonDown(MOUSE_LEFT_BUTTON) && isDrawing && currentTool == TOOL_PEN && penStroke.count > 0) {
+                /* Drop samples closer than a screen pixel; the rest is simplified on release. */
+                DrawingShape_AppendStroke(&penStroke, mousePos, GetSceneHandleScale());
             }
 
             if (IsMouseButtonReleased(MOUSE_LEFT_BUTTON)) {
@@ -2136,8 +2656,8 @@ int main(void)
                     cursorPreferredColumn = -1;
                 }
 
-                if (wasDragging && dragBoxValid && dragChanged) {
-                    PushHistoryState(boxes, boxCount, selectedBox);
+                if (wasDragging && dragBoxValid && dragChanged && selectedBox != -1) {
+                    PushModifyHistory(&dragBeforeState, &boxes[selectedBox], selectedBox);
                 }
                 if (wasDragging) {
                     dragBoxValid = 0;
@@ -2146,7 +2666,7 @@ int main(void)
 
                 if (isDrawing) {
                     int shapeAdded = 0;
-                    if (currentTool == TOOL_RECT && boxCount < MAX_BOXES) {
+                    if (currentTool == TOOL_RECT && EnsureBoxCapacity(&boxes, &boxCapacity, boxCount + 1)) {
                         int endX = (int)mousePos.x;
                         int endY = (int)mousePos.y;
                         int x = startX < endX ? startX : endX;
@@ -2154,25 +2674,19 @@ int main(void)
                         int width = abs(endX - startX);
                         int height = abs(endY - startY);
                         if (width > 0 && height > 0) {
-                            RenderTexture2D rt = LoadRenderTexture(width, height);
-                            BeginTextureMode(rt);
-                            ClearBackground(BLANK);
-                            DrawRectangleLines(0, 0, width, height, currentDrawColor);
-                            EndTextureMode();
                             boxes[boxCount].x = x;
                             boxes[boxCount].y = y;
                             boxes[boxCount].width = width;
                             boxes[boxCount].height = height;
-                            boxes[boxCount].type = BOX_DRAWING;
-                            boxes[boxCount].content.texture = rt.texture;
+                            AssignDrawingShape(&boxes[boxCount], SHAPE_RECT, currentDrawColor, SHAPE_OUTLINE_THICKNESS, NULL, 0);
                             boxes[boxCount].filePath = NULL;
                             boxes[boxCount].isSelected = 0;
-                            boxCount++;
+                            CommitNewBox(boxes, &boxCount);
                             selectedBox = boxCount - 1;
                             SelectBox(boxes, boxCount, selectedBox);
                             shapeAdded = 1;
                         }
-                    } else if (currentTool == TOOL_CIRCLE && boxCount < MAX_BOXES) {
+                    } else if (currentTool == TOOL_CIRCLE && EnsureBoxCapacity(&boxes, &boxCapacity, boxCount + 1)) {
                         int centerX = startX;
                         int centerY = startY;
                         float dx = mousePos.x - startX;
@@ -2183,25 +2697,19 @@ int main(void)
                             int y = centerY - radius;
                             int width = radius * 2;
                             int height = radius * 2;
-                            RenderTexture2D rt = LoadRenderTexture(width, height);
-                            BeginTextureMode(rt);
-                            ClearBackground(BLANK);
-                            DrawCircleLines(radius, radius, (float)radius, currentDrawColor);
-                            EndTextureMode();
                             boxes[boxCount].x = x;
                             boxes[boxCount].y = y;
                             boxes[boxCount].width = width;
                             boxes[boxCount].height = height;
-                            boxes[boxCount].type = BOX_DRAWING;
-                            boxes[boxCount].content.texture = rt.texture;
+                            AssignDrawingShape(&boxes[boxCount], SHAPE_CIRCLE, currentDrawColor, SHAPE_OUTLINE_THICKNESS, NULL, 0);
                             boxes[boxCount].filePath = NULL;
                             boxes[boxCount].isSelected = 0;
-                            boxCount++;
+                            CommitNewBox(boxes, &boxCount);
                             selectedBox = boxCount - 1;
                             SelectBox(boxes, boxCount, selectedBox);
                             shapeAdded = 1;
                         }
-                    } else if (currentTool == TOOL_SEGMENT && boxCount < MAX_BOXES) {
+                    } else if (currentTool == TOOL_SEGMENT && EnsureBoxCapacity(&boxes, &boxCapacity, boxCount + 1)) {
                         int endX = (int)mousePos.x;
                         int endY = (int)mousePos.y;
                         float minX = (startX < endX ? startX : endX) - STROKE_THICKNESS;
@@ -2210,83 +2718,67 @@ int main(void)
                         float maxY = (startY > endY ? startY : endY) + STROKE_THICKNESS;
                         int width = (int)fmaxf(2.0f, maxX - minX);
                         int height = (int)fmaxf(2.0f, maxY - minY);
-                        RenderTexture2D rt = LoadRenderTexture(width, height);
-                        BeginTextureMode(rt);
-                        ClearBackground(BLANK);
-                        Vector2 start = {(float)startX - minX, (float)startY - minY};
-                        Vector2 end = {(float)endX - minX, (float)endY - minY};
-                        DrawLineEx(start, end, STROKE_THICKNESS, currentDrawColor);
-                        EndTextureMode();
+                        Vector2 ends[2] = {
+                            {(float)startX - minX, (float)startY - minY},
+                            {(float)endX - minX, (float)endY - minY}
+                        };
                         boxes[boxCount].x = (int)minX;
                         boxes[boxCount].y = (int)minY;
                         boxes[boxCount].width = width;
                         boxes[boxCount].height = height;
-                        boxes[boxCount].type = BOX_DRAWING;
-                        boxes[boxCount].content.texture = rt.texture;
-                            boxes[boxCount].filePath = NULL;
+                        AssignDrawingShape(&boxes[boxCount], SHAPE_SEGMENT, currentDrawColor, STROKE_THICKNESS, ends, 2);
+                        boxes[boxCount].filePath = NULL;
                         boxes[boxCount].isSelected = 0;
-                        boxCount++;
+                        CommitNewBox(boxes, &boxCount);
                         selectedBox = boxCount - 1;
                         SelectBox(boxes, boxCount, selectedBox);
                         shapeAdded = 1;
-                    } else if (currentTool == TOOL_PEN && boxCount < MAX_BOXES && penPointCount > 0) {
-                        float minX = penMinX - STROKE_THICKNESS;
-                        float minY = penMinY - STROKE_THICKNESS;
-                        float widthF = (penMaxX - penMinX) + STROKE_THICKNESS * 2.0f;
-                        float heightF = (penMaxY - penMinY) + STROKE_THICKNESS * 2.0f;
+                    } else if (currentTool == TOOL_PEN && penStroke.count > 0 && EnsureBoxCapacity(&boxes, &boxCapacity, boxCount + 1)) {
+                        DrawingShape_FinishStroke(&penStroke, PEN_SIMPLIFY_TOLERANCE * GetSceneHandleScale(), PEN_SMOOTHING_PASSES);
+                        float minX = penStroke.minX - STROKE_THICKNESS;
+                        float minY = penStroke.minY - STROKE_THICKNESS;
+                        float widthF = (penStroke.maxX - penStroke.minX) + STROKE_THICKNESS * 2.0f;
+                        float heightF = (penStroke.maxY - penStroke.minY) + STROKE_THICKNESS * 2.0f;
                         int width = (int)fmaxf(2.0f, widthF);
                         int height = (int)fmaxf(2.0f, heightF);
-                        RenderTexture2D rt = LoadRenderTexture(width, height);
-                        BeginTextureMode(rt);
-                        ClearBackground(BLANK);
-                        if (penPointCount == 1) {
-                            DrawCircleV((Vector2){penPoints[0].x - minX, penPoints[0].y - minY}, STROKE_THICKNESS * 0.5f, currentDrawColor);
-                        } else {
-                            Vector2 prev = {(penPoints[0].x - minX), (penPoints[0].y - minY)};
-                            for (int i = 1; i < penPointCount; i++) {
-                                Vector2 curr = {(penPoints[i].x - minX), (penPoints[i].y - minY)};
-                                DrawLineEx(prev, curr, STROKE_THICKNESS, currentDrawColor);
-                                prev = curr;
-                            }
-                        }
-                        EndTextureMode();
                         boxes[boxCount].x = (int)minX;
                         boxes[boxCount].y = (int)minY;
                         boxes[boxCount].width = width;
                         boxes[boxCount].height = height;
-                        boxes[boxCount].type = BOX_DRAWING;
-                        boxes[boxCount].content.texture = rt.texture;
+                        /* Rebase the stroke onto the box origin in place; the buffer is reset below. */
+                        for (int i = 0; i < penStroke.count; i++) {
+                            penStroke.points[i].x -= (float)boxes[boxCount].x;
+                            penStroke.points[i].y -= (float)boxes[boxCount].y;
+                        }
+                        AssignDrawingShape(&boxes[boxCount], SHAPE_PEN, currentDrawColor, STROKE_THICKNESS,
+                                           penStroke.points, penStroke.count);
                         boxes[boxCount].filePath = NULL;
                         boxes[boxCount].isSelected = 0;
-                        boxCount++;
+                        CommitNewBox(boxes, &boxCount);
                         selectedBox = boxCount - 1;
                         SelectBox(boxes, boxCount, selectedBox);
                         shapeAdded = 1;
                     }
 
                     isDrawing = 0;
-                    penPointCount = 0;
+                    penStroke.count = 0;
                     if (shapeAdded) {
-                        PushHistoryState(boxes, boxCount, selectedBox);
+                        PushCreateHistory(boxes, selectedBox, selectedBox);
                     }
                 }
             }
 
             if (IsKeyPressed(KEY_DELETE) && selectedBox != -1) {
+                PushDeleteHistory(&boxes[selectedBox], -1);
                 DestroyBox(&boxes[selectedBox]);
                 if (editingBoxIndex == selectedBox) {
                     ResetEditingState();
-                } else if (editingBoxIndex > selectedBox) {
-                    editingBoxIndex--;
                 }
-                for (int i = selectedBox; i < boxCount - 1; i++) {
-                    boxes[i] = boxes[i + 1];
+                if (RemoveBoxAt(boxes, &boxCount, selectedBox, NULL) == editingBoxIndex && editingBoxIndex >= 0) {
+                    editingBoxIndex = selectedBox;
                 }
-                boxes[boxCount - 1] = (Box){0};
-                boxCount--;
                 selectedBox = -1;
                 SelectBox(boxes, boxCount, -1);
-                PushHistoryState(boxes, boxCount, selectedBox);
             }
         } else {
             confirmDialogRect = (Rectangle){(screenWidthCurrent - 320.0f) / 2.0f, (screenHeightCurrent - 180.0f) / 2.0f, 320.0f, 180.0f};
@@ -2294,13 +2786,17 @@ int main(void)
             confirmNoRect = (Rectangle){confirmDialogRect.x + confirmDialogRect.width - 138.0f, confirmDialogRect.y + confirmDialogRect.height - 60.0f, 110.0f, 40.0f};
 
             if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
-                if (CheckCollisionPointRec(mousePos, confirmYesRect)) {
+                if (CheckCollisionPointRec(screenMousePos, confirmYesRect)) {
+                    BeginHistoryGroup();
+                    for (int i = boxCount - 1; i >= 0; i--) {
+                        PushDeleteHistory(&boxes[i], -1);
+                    }
                     ClearAllBoxes(boxes, &boxCount, &selectedBox);
-                    PushHistoryState(boxes, boxCount, selectedBox);
+                    EndHistoryGroup(selectedBox);
                     snprintf(statusMessage, sizeof(statusMessage), "Canvas cleared");
                     statusMessageTimer = 2.0f;
                     showClearConfirm = 0;
-                } else if (CheckCollisionPointRec(mousePos, confirmNoRect) || !CheckCollisionPointRec(mousePos, confirmDialogRect)) {
+                } else if (CheckCollisionPointRec(screenMousePos, confirmNoRect) || !CheckCollisionPointRec(screenMousePos, confirmDialogRect)) {
                     showClearConfirm = 0;
                 }
             }
@@ -2348,12 +2844,16 @@ int main(void)
             currentCursor = desiredCursor;
         }
 
-        prevMousePos = mousePos;
+        prevScreenMousePos = screenMousePos;
 
         if (!showClearConfirm) {
             if (IsKeyPressed(KEY_S)) {
                 currentTool = TOOL_SELECT;
             }
+            if (IsKeyPressed(KEY_HOME) && editingBoxIndex < 0) {
+                camera = (Camera2D){0};
+                camera.zoom = 1.0f;
+            }
             if (IsKeyPressed(KEY_P)) {
                 if (editingBoxIndex >= 0) {
                             StopTextEditAndRecord(boxes, boxCount, selectedBox);
@@ -2391,7 +2891,7 @@ int main(void)
                     if (editingBoxIndex >= 0) {
                         StopTextEditAndRecord(boxes, boxCount, selectedBox);
                     }
-                    if (PerformRedo(boxes, &boxCount, &selectedBox)) {
+                    if (PerformRedo(&boxes, &boxCount, &boxCapacity, &selectedBox)) {
                         snprintf(statusMessage, sizeof(statusMessage), "Redo");
                         statusMessageTimer = 1.2f;
                     } else {
@@ -2402,7 +2902,7 @@ int main(void)
                     if (editingBoxIndex >= 0) {
                         StopTextEditAndRecord(boxes, boxCount, selectedBox);
                     }
-                    if (PerformUndo(boxes, &boxCount, &selectedBox)) {
+                    if (PerformUndo(&boxes, &boxCount, &boxCapacity, &selectedBox)) {
                         snprintf(statusMessage, sizeof(statusMessage), "Undo");
                         statusMessageTimer = 1.2f;
                     } else {
@@ -2425,13 +2925,17 @@ int main(void)
         if (!showClearConfirm && ctrlDown && IsKeyPressed(KEY_V) && editingBoxIndex < 0) {
             int handledPaste = 0;
 #ifdef _WIN32
-            if (WinClip_HasFileDrop() && boxCount < MAX_BOXES) {
+            if (WinClip_HasFileDrop()) {
                 int dropCount = 0;
                 char** dropList = WinClip_GetFileDropList(&dropCount);
                 if (dropList != NULL && dropCount > 0) {
                     int added = 0;
                     int limited = 0;
-                    for (int i = 0; i < dropCount && boxCount < MAX_BOXES; ++i) {
+                    for (int i = 0; i < dropCount; ++i) {
+                        if (!EnsureBoxCapacity(&boxes, &boxCapacity, boxCount + 1)) {
+                            limited = 1;
+                            break;
+                        }
                         const char* filePath = dropList[i];
                         if (filePath == NULL || filePath[0] == '\0') {
                             continue;
@@ -2446,22 +2950,22 @@ int main(void)
                                             EqualsIgnoreCase(ext, ".jpeg") || EqualsIgnoreCase(ext, ".bmp"))) {
                             Image img = LoadImage(filePath);
                             if (IsImageReady(img)) {
-                                Texture2D tex = LoadTextureFromImage(img);
                                 boxes[boxCount].x = baseX;
                                 boxes[boxCount].y = baseY;
                                 boxes[boxCount].width = img.width;
                                 boxes[boxCount].height = img.height;
                                 boxes[boxCount].type = BOX_IMAGE;
-                                boxes[boxCount].content.texture = tex;
+                                AssignBoxPixels(&boxes[boxCount], img);
                                 boxes[boxCount].filePath = NULL;
                                 boxes[boxCount].isSelected = 0;
-                                boxCount++;
+                                CommitNewBox(boxes, &boxCount);
                                 selectedBox = boxCount - 1;
                                 SelectBox(boxes, boxCount, selectedBox);
-                                PushHistoryState(boxes, boxCount, selectedBox);
+                                PushCreateHistory(boxes, selectedBox, selectedBox);
                                 created = 1;
+                            } else {
+                                UnloadImage(img);
                             }
-                            UnloadImage(img);
                         } else if (ext != NULL && (EqualsIgnoreCase(ext, ".wav") || EqualsIgnoreCase(ext, ".ogg") ||
                                                      EqualsIgnoreCase(ext, ".mp3") || EqualsIgnoreCase(ext, ".flac"))) {
                             char* storedPath = strdup(filePath);
@@ -2484,20 +2988,21 @@ int main(void)
                                 boxes[boxCount].width = AUDIO_BOX_WIDTH;
                                 boxes[boxCount].height = AUDIO_BOX_HEIGHT;
                                 boxes[boxCount].type = BOX_AUDIO;
-                                boxes[boxCount].content.music = music;
+                                EnsureBoxMedia(&boxes[boxCount]);
+                                boxes[boxCount].media->music = music;
                                 boxes[boxCount].filePath = storedPath;
                                 boxes[boxCount].fontSize = 0;
                                 boxes[boxCount].textColor = BLACK;
-                                boxes[boxCount].audioLoop = 0;
-                                boxes[boxCount].audioStreamStarted = 0;
-                                boxes[boxCount].audioWasPlaying = 0;
-                                boxes[boxCount].audioTimePlayed = 0.0f;
-                                boxes[boxCount].audioDurationSeconds = musicReady ? GetMusicTimeLength(music) : 0.0f;
+                                boxes[boxCount].media->audioLoop = 0;
+                                boxes[boxCount].media->audioStreamStarted = 0;
+                                boxes[boxCount].media->audioWasPlaying = 0;
+                                boxes[boxCount].media->audioTimePlayed = 0.0f;
+                                boxes[boxCount].media->audioDurationSeconds = musicReady ? GetMusicTimeLength(music) : 0.0f;
                                 boxes[boxCount].isSelected = 0;
-                                boxCount++;
+                                CommitNewBox(boxes, &boxCount);
                                 selectedBox = boxCount - 1;
                                 SelectBox(boxes, boxCount, selectedBox);
-                                PushHistoryState(boxes, boxCount, selectedBox);
+                                PushCreateHistory(boxes, selectedBox, selectedBox);
                                 created = 1;
 
                                 const char* audioName = ExtractFileName(storedPath);
@@ -2524,37 +3029,38 @@ int main(void)
                                     boxes[boxCount].x = baseX;
                                     boxes[boxCount].y = baseY;
                                     boxes[boxCount].type = BOX_VIDEO;
+                                    EnsureBoxMedia(&boxes[boxCount]);
                                     boxes[boxCount].content.video = player;
                                     boxes[boxCount].filePath = storedPath;
                                     boxes[boxCount].fontSize = 0;
                                     boxes[boxCount].textColor = WHITE;
                                     boxes[boxCount].isSelected = 0;
-                                    boxes[boxCount].videoDecodedFrames = WinVideo_GetDecodedFrameCount(player);
-                                    boxes[boxCount].videoFallbackFrames = WinVideo_GetFallbackFrameCount(player);
-                                    boxes[boxCount].videoReportedDecoded = 0;
-                                    boxes[boxCount].videoReportedFallback = 0;
-                                    boxes[boxCount].videoConvertAvgUs = 0.0f;
-                                    boxes[boxCount].videoConvertPeakUs = 0.0f;
-                                    boxes[boxCount].videoConvertLastUs = 0.0f;
-                                    boxes[boxCount].videoConvertSamples = 0u;
+                                    boxes[boxCount].media->videoDecodedFrames = WinVideo_GetDecodedFrameCount(player);
+                                    boxes[boxCount].media->videoFallbackFrames = WinVideo_GetFallbackFrameCount(player);
+                                    boxes[boxCount].media->videoReportedDecoded = 0;
+                                    boxes[boxCount].media->videoReportedFallback = 0;
+                                    boxes[boxCount].media->videoConvertAvgUs = 0.0f;
+                                    boxes[boxCount].media->videoConvertPeakUs = 0.0f;
+                                    boxes[boxCount].media->videoConvertLastUs = 0.0f;
+                                    boxes[boxCount].media->videoConvertSamples = 0u;
                                     const char* newFormatLabel = WinVideo_GetSampleFormatLabel(player);
                                     if (newFormatLabel != NULL) {
-                                        strncpy(boxes[boxCount].videoFormatLabel, newFormatLabel, sizeof(boxes[boxCount].videoFormatLabel) - 1);
-                                        boxes[boxCount].videoFormatLabel[sizeof(boxes[boxCount].videoFormatLabel) - 1] = '\0';
+                                        strncpy(boxes[boxCount].media->videoFormatLabel, newFormatLabel, sizeof(boxes[boxCount].media->videoFormatLabel) - 1);
+                                        boxes[boxCount].media->videoFormatLabel[sizeof(boxes[boxCount].media->videoFormatLabel) - 1] = '\0';
                                     } else {
-                                        boxes[boxCount].videoFormatLabel[0] = '\0';
+                                        boxes[boxCount].media->videoFormatLabel[0] = '\0';
                                     }
                                     WinVideo_SetLooping(player, 0);
-                                    boxes[boxCount].videoLoop = 0;
-                                    boxes[boxCount].videoDurationSeconds = (float)WinVideo_GetDurationSeconds(player);
-                                    boxes[boxCount].videoPositionSeconds = (float)WinVideo_GetPositionSeconds(player);
+                                    boxes[boxCount].media->videoLoop = 0;
+                                    boxes[boxCount].media->videoDurationSeconds = (float)WinVideo_GetDurationSeconds(player);
+                                    boxes[boxCount].media->videoPositionSeconds = (float)WinVideo_GetPositionSeconds(player);
                                     ConfigureVideoBoxSize(&boxes[boxCount], tex);
                                     if (boxes[boxCount].width <= 0) boxes[boxCount].width = DEFAULT_VIDEO_BOX_WIDTH;
                                     if (boxes[boxCount].height <= 0) boxes[boxCount].height = DEFAULT_VIDEO_BOX_HEIGHT;
-                                    boxCount++;
+                                    CommitNewBox(boxes, &boxCount);
                                     selectedBox = boxCount - 1;
                                     SelectBox(boxes, boxCount, selectedBox);
-                                    PushHistoryState(boxes, boxCount, selectedBox);
+                                    PushCreateHistory(boxes, selectedBox, selectedBox);
                                     created = 1;
 
                                     const char* videoName = ExtractFileName(storedPath);
@@ -2589,15 +3095,15 @@ int main(void)
                                 boxes[boxCount].width = textWidth;
                                 boxes[boxCount].height = textHeight;
                                 boxes[boxCount].type = BOX_TEXT;
-                                boxes[boxCount].content.text = textCopy;
+                                SetBoxText(&boxes[boxCount], textCopy);
                                 boxes[boxCount].fontSize = DEFAULT_FONT_SIZE;
                                 boxes[boxCount].textColor = currentDrawColor;
                                 boxes[boxCount].filePath = NULL;
                                 boxes[boxCount].isSelected = 0;
-                                boxCount++;
+                                CommitNewBox(boxes, &boxCount);
                                 selectedBox = boxCount - 1;
                                 SelectBox(boxes, boxCount, selectedBox);
-                                PushHistoryState(boxes, boxCount, selectedBox);
+                                PushCreateHistory(boxes, selectedBox, selectedBox);
                                 created = 1;
                             }
                         }
@@ -2607,14 +3113,10 @@ int main(void)
                         }
                     }
 
-                    if (dropCount > 0 && boxCount >= MAX_BOXES) {
-                        limited = 1;
-                    }
-
                     if (added > 0) {
                         handledPaste = 1;
                         if (limited) {
-                            snprintf(statusMessage, sizeof(statusMessage), "Imported %d file%s (canvas full)", added, added == 1 ? "" : "s");
+                            snprintf(statusMessage, sizeof(statusMessage), "Imported %d file%s (out of memory)", added, added == 1 ? "" : "s");
                             statusMessageTimer = 2.0f;
                         } else if (statusMessageTimer <= 0.0f) {
                             snprintf(statusMessage, sizeof(statusMessage), "Imported %d file%s", added, added == 1 ? "" : "s");
@@ -2628,7 +3130,7 @@ int main(void)
                 }
             }
 
-            if (!handledPaste && WinClip_HasImage() && boxCount < MAX_BOXES) {
+            if (!handledPaste && WinClip_HasImage() && EnsureBoxCapacity(&boxes, &boxCapacity, boxCount + 1)) {
                 int imgWidth, imgHeight, imgChannels;
                 void* imgData = WinClip_GetImageData(&imgWidth, &imgHeight, &imgChannels);
 
@@ -2641,20 +3143,18 @@ int main(void)
                         .format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8
                     };
 
-                    Texture2D tex = LoadTextureFromImage(img);
-
                     boxes[boxCount].x = (int)mousePos.x;
                     boxes[boxCount].y = (int)mousePos.y;
                     boxes[boxCount].width = imgWidth;
                     boxes[boxCount].height = imgHeight;
                     boxes[boxCount].type = BOX_IMAGE;
-                    boxes[boxCount].content.texture = tex;
+                    AssignBoxPixels(&boxes[boxCount], ImageCopy(img));
                     boxes[boxCount].filePath = NULL;
                     boxes[boxCount].isSelected = 0;
-                    boxCount++;
+                    CommitNewBox(boxes, &boxCount);
                     selectedBox = boxCount - 1;
                     SelectBox(boxes, boxCount, selectedBox);
-                    PushHistoryState(boxes, boxCount, selectedBox);
+                    PushCreateHistory(boxes, selectedBox, selectedBox);
 
                     WinClip_FreeData(imgData);
                     handledPaste = 1;
@@ -2668,15 +3168,15 @@ int main(void)
                     boxes[boxCount].width = textWidth;
                     boxes[boxCount].height = textHeight;
                     boxes[boxCount].type = BOX_TEXT;
-                    boxes[boxCount].content.text = strdup(errorText);
+                    SetBoxText(&boxes[boxCount], strdup(errorText));
                     boxes[boxCount].fontSize = DEFAULT_FONT_SIZE;
                     boxes[boxCount].textColor = currentDrawColor;
                     boxes[boxCount].filePath = NULL;
                     boxes[boxCount].isSelected = 0;
-                    boxCount++;
+                    CommitNewBox(boxes, &boxCount);
                     selectedBox = boxCount - 1;
                     SelectBox(boxes, boxCount, selectedBox);
-                    PushHistoryState(boxes, boxCount, selectedBox);
+                    PushCreateHistory(boxes, selectedBox, selectedBox);
                     handledPaste = 1;
                 }
             }
@@ -2684,7 +3184,7 @@ int main(void)
 
             if (!handledPaste) {
                 const char* clip = GetClipboardTextSafe();
-                if (clip && strlen(clip) > 0 && boxCount < MAX_BOXES) {
+                if (clip && strlen(clip) > 0 && EnsureBoxCapacity(&boxes, &boxCapacity, boxCount + 1)) {
                     char* path = DuplicateSanitizedPath(clip);
                     int handled = 0;
                     if (path && path[0] != '\0') {
@@ -2694,21 +3194,19 @@ int main(void)
                                 EqualsIgnoreCase(ext, ".jpeg") || EqualsIgnoreCase(ext, ".bmp")) {
                                 Image img = LoadImage(path);
                                 if (IsImageReady(img)) {
-                                    Texture2D tex = LoadTextureFromImage(img);
                                     boxes[boxCount].x = (int)mousePos.x;
                                     boxes[boxCount].y = (int)mousePos.y;
                                     boxes[boxCount].width = img.width;
                                     boxes[boxCount].height = img.height;
                                     boxes[boxCount].type = BOX_IMAGE;
-                                    boxes[boxCount].content.texture = tex;
+                                    AssignBoxPixels(&boxes[boxCount], img);
                                     boxes[boxCount].filePath = NULL;
                                     boxes[boxCount].isSelected = 0;
-                                    boxCount++;
-                                    UnloadImage(img);
+                                    CommitNewBox(boxes, &boxCount);
                                     handled = 1;
                                     selectedBox = boxCount - 1;
                                     SelectBox(boxes, boxCount, selectedBox);
-                                    PushHistoryState(boxes, boxCount, selectedBox);
+                                    PushCreateHistory(boxes, selectedBox, selectedBox);
                                 }
                             } else if (EqualsIgnoreCase(ext, ".wav") || EqualsIgnoreCase(ext, ".ogg") ||
                                        EqualsIgnoreCase(ext, ".mp3") || EqualsIgnoreCase(ext, ".flac")) {
@@ -2730,21 +3228,22 @@ int main(void)
                                 boxes[boxCount].width = AUDIO_BOX_WIDTH;
                                 boxes[boxCount].height = AUDIO_BOX_HEIGHT;
                                 boxes[boxCount].type = BOX_AUDIO;
-                                boxes[boxCount].content.music = music;
+                                EnsureBoxMedia(&boxes[boxCount]);
+                                boxes[boxCount].media->music = music;
                                 boxes[boxCount].filePath = path;
                                 boxes[boxCount].fontSize = 0;
                                 boxes[boxCount].textColor = BLACK;
-                                boxes[boxCount].audioLoop = 0;
-                                boxes[boxCount].audioStreamStarted = 0;
-                                boxes[boxCount].audioWasPlaying = 0;
-                                boxes[boxCount].audioTimePlayed = 0.0f;
-                                boxes[boxCount].audioDurationSeconds = musicReady ? GetMusicTimeLength(music) : 0.0f;
+                                boxes[boxCount].media->audioLoop = 0;
+                                boxes[boxCount].media->audioStreamStarted = 0;
+                                boxes[boxCount].media->audioWasPlaying = 0;
+                                boxes[boxCount].media->audioTimePlayed = 0.0f;
+                                boxes[boxCount].media->audioDurationSeconds = musicReady ? GetMusicTimeLength(music) : 0.0f;
                                 boxes[boxCount].isSelected = 0;
-                                boxCount++;
+                                CommitNewBox(boxes, &boxCount);
                                 handled = 1;
                                 selectedBox = boxCount - 1;
                                 SelectBox(boxes, boxCount, selectedBox);
-                                PushHistoryState(boxes, boxCount, selectedBox);
+                                PushCreateHistory(boxes, selectedBox, selectedBox);
 
                                 const char* audioName = ExtractFileName(path);
 
@@ -2768,38 +3267,39 @@ int main(void)
                                     boxes[boxCount].x = (int)mousePos.x;
                                     boxes[boxCount].y = (int)mousePos.y;
                                     boxes[boxCount].type = BOX_VIDEO;
+                                    EnsureBoxMedia(&boxes[boxCount]);
                                     boxes[boxCount].content.video = player;
                                     boxes[boxCount].filePath = path;
                                     boxes[boxCount].fontSize = 0;
                                     boxes[boxCount].textColor = WHITE;
                                     boxes[boxCount].isSelected = 0;
-                                    boxes[boxCount].videoDecodedFrames = WinVideo_GetDecodedFrameCount(player);
-                                    boxes[boxCount].videoFallbackFrames = WinVideo_GetFallbackFrameCount(player);
-                                    boxes[boxCount].videoReportedDecoded = 0;
-                                    boxes[boxCount].videoReportedFallback = 0;
-                                    boxes[boxCount].videoConvertAvgUs = 0.0f;
-                                    boxes[boxCount].videoConvertPeakUs = 0.0f;
-                                    boxes[boxCount].videoConvertLastUs = 0.0f;
-                                    boxes[boxCount].videoConvertSamples = 0u;
+                                    boxes[boxCount].media->videoDecodedFrames = WinVideo_GetDecodedFrameCount(player);
+                                    boxes[boxCount].media->videoFallbackFrames = WinVideo_GetFallbackFrameCount(player);
+                                    boxes[boxCount].media->videoReportedDecoded = 0;
+                                    boxes[boxCount].media->videoReportedFallback = 0;
+                                    boxes[boxCount].media->videoConvertAvgUs = 0.0f;
+                                    boxes[boxCount].media->videoConvertPeakUs = 0.0f;
+                                    boxes[boxCount].media->videoConvertLastUs = 0.0f;
+                                    boxes[boxCount].media->videoConvertSamples = 0u;
                                     const char* newFormatLabel = WinVideo_GetSampleFormatLabel(player);
                                     if (newFormatLabel != NULL) {
-                                        strncpy(boxes[boxCount].videoFormatLabel, newFormatLabel, sizeof(boxes[boxCount].videoFormatLabel) - 1);
-                                        boxes[boxCount].videoFormatLabel[sizeof(boxes[boxCount].videoFormatLabel) - 1] = '\0';
+                                        strncpy(boxes[boxCount].media->videoFormatLabel, newFormatLabel, sizeof(boxes[boxCount].media->videoFormatLabel) - 1);
+                                        boxes[boxCount].media->videoFormatLabel[sizeof(boxes[boxCount].media->videoFormatLabel) - 1] = '\0';
                                     } else {
-                                        boxes[boxCount].videoFormatLabel[0] = '\0';
+                                        boxes[boxCount].media->videoFormatLabel[0] = '\0';
                                     }
                                     WinVideo_SetLooping(player, 0);
-                                    boxes[boxCount].videoLoop = 0;
-                                    boxes[boxCount].videoDurationSeconds = (float)WinVideo_GetDurationSeconds(player);
-                                    boxes[boxCount].videoPositionSeconds = (float)WinVideo_GetPositionSeconds(player);
+                                    boxes[boxCount].media->videoLoop = 0;
+                                    boxes[boxCount].media->videoDurationSeconds = (float)WinVideo_GetDurationSeconds(player);
+                                    boxes[boxCount].media->videoPositionSeconds = (float)WinVideo_GetPositionSeconds(player);
                                     ConfigureVideoBoxSize(&boxes[boxCount], tex);
                                     if (boxes[boxCount].width <= 0) boxes[boxCount].width = DEFAULT_VIDEO_BOX_WIDTH;
                                     if (boxes[boxCount].height <= 0) boxes[boxCount].height = DEFAULT_VIDEO_BOX_HEIGHT;
-                                    boxCount++;
+                                    CommitNewBox(boxes, &boxCount);
                                     handled = 1;
                                     selectedBox = boxCount - 1;
                                     SelectBox(boxes, boxCount, selectedBox);
-                                    PushHistoryState(boxes, boxCount, selectedBox);
+                                    PushCreateHistory(boxes, selectedBox, selectedBox);
 
                                     const char* videoName = ExtractFileName(path);
                                     if (tex != NULL && tex->id != 0) {
@@ -2836,15 +3336,15 @@ int main(void)
                             boxes[boxCount].width = textWidth;
                             boxes[boxCount].height = textHeight;
                             boxes[boxCount].type = BOX_TEXT;
-                            boxes[boxCount].content.text = textBuffer;
+                            SetBoxText(&boxes[boxCount], textBuffer);
                             boxes[boxCount].fontSize = DEFAULT_FONT_SIZE;
                             boxes[boxCount].textColor = currentDrawColor;
                             boxes[boxCount].filePath = NULL;
                             boxes[boxCount].isSelected = 0;
-                            boxCount++;
+                            CommitNewBox(boxes, &boxCount);
                             selectedBox = boxCount - 1;
                             SelectBox(boxes, boxCount, selectedBox);
-                            PushHistoryState(boxes, boxCount, selectedBox);
+                            PushCreateHistory(boxes, selectedBox, selectedBox);
                         } else {
                             if (path) {
                                 free(path);
@@ -2857,303 +3357,62 @@ int main(void)
             }
         }
 
-        BeginDrawing();
-
-        ClearBackground(RAYWHITE);
-
+        /* Static boxes come from the tile cache; these are drawn over it each frame. */
+        SceneTiles_BeginFrame();
+        if (editingBoxIndex >= 0 && editingBoxIndex < boxCount) {
+            SceneTiles_MarkLive(boxes, editingBoxIndex);
+        }
+        if (isDragging && selectedBox >= 0 && selectedBox < boxCount) {
+            SceneTiles_MarkLive(boxes, selectedBox);
+        }
+        int pointerBox = SceneIndex_FindTopmostAtPoint(mousePos, boxes, boxCount);
+        if (pointerBox >= 0 && (boxes[pointerBox].type == BOX_AUDIO || boxes[pointerBox].type == BOX_VIDEO)) {
+            SceneTiles_MarkLive(boxes, pointerBox);
+        }
+        int mediaAnimating = 0;
         for (int i = 0; i < boxCount; i++) {
-            Box* box = &boxes[i];
-            if (box->type == BOX_TEXT) {
-                DrawRectangle(box->x, box->y, box->width, box->height, WHITE);
-            }
-
-            switch (box->type) {
-                case BOX_IMAGE:
-                    {
-                        Rectangle source = {0.0f, 0.0f, (float)box->content.texture.width, (float)box->content.texture.height};
-                        Rectangle dest = {(float)box->x, (float)box->y, (float)box->width, (float)box->height};
-                        Vector2 origin = {0.0f, 0.0f};
-                        DrawTexturePro(box->content.texture, source, dest, origin, 0.0f, WHITE);
-                    }
-                    break;
-                case BOX_TEXT:
-                    {
-                        Color textColor = box->textColor;
-                        if (textColor.a == 0) {
-                            textColor = BLACK;
-                        }
-                        int boxFontSize = box->fontSize > 0 ? box->fontSize : DEFAULT_FONT_SIZE;
-
-                        Rectangle playRect = GetAudioPlayButtonRect(box);
-                        Rectangle loopRect = GetAudioLoopButtonRect(box);
-                        Rectangle progressRect = GetAudioProgressRect(box);
-
-                        int musicReady = audioDeviceReady && IsMusicReady(box->content.music);
-                        int playing = musicReady && IsMusicStreamPlaying(box->content.music);
-
-                        float duration = box->audioDurationSeconds;
-                        float played = box->audioTimePlayed;
-                        if (duration < 0.0f) duration = 0.0f;
-                        if (played < 0.0f) played = 0.0f;
-                        if (duration > 0.0f && played > duration) played = duration;
-
-                        Color progressBg = musicReady ? Fade(DARKBLUE, 0.20f) : Fade(MAROON, 0.25f);
-                        Color progressFill = musicReady ? Fade(DARKBLUE, 0.70f) : Fade(MAROON, 0.55f);
-                        DrawRectangleRounded(progressRect, 0.45f, 6, progressBg);
-                        if (progressRect.width > 0.0f) {
-                            float ratio = (duration > 0.0f) ? (played / duration) : 0.0f;
-                            if (ratio < 0.0f) ratio = 0.0f;
-                            if (ratio > 1.0f) ratio = 1.0f;
-                            Rectangle fillRect = progressRect;
-                            fillRect.width *= ratio;
-                            if (fillRect.width < 2.0f) {
-                                fillRect.width = 2.0f;
-                            }
-                            DrawRectangleRounded(fillRect, 0.45f, 6, progressFill);
-                        }
-
-                        char timeNow[16] = {0};
-                        char timeTotal[16] = {0};
-                        FormatTimeString(played, timeNow, sizeof(timeNow));
-                        if (duration <= 0.0f) {
-                            snprintf(timeTotal, sizeof(timeTotal), "--:--");
-                        } else {
-                            FormatTimeString(duration, timeTotal, sizeof(timeTotal));
-                        }
-                        int timeFont = 16;
-                        DrawText(timeNow, (int)progressRect.x, (int)progressRect.y - 20, timeFont, Fade(DARKBLUE, 0.85f));
-                        int totalWidth = MeasureText(timeTotal, timeFont);
-                        DrawText(timeTotal, (int)(progressRect.x + progressRect.width - totalWidth), (int)progressRect.y - 20, timeFont, Fade(DARKBLUE, 0.85f));
-
-                        bool playHover = CheckCollisionPointRec(mousePos, playRect);
-                        bool loopHover = CheckCollisionPointRec(mousePos, loopRect);
-
-                        Color playFill;
-                        Color playOutline = Fade(BLACK, 0.35f);
-                        if (!musicReady) {
-                            playFill = Fade(MAROON, playHover ? 0.55f : 0.45f);
-                        } else if (playing) {
-                            playFill = Fade(DARKGREEN, playHover ? 0.75f : 0.60f);
-                        } else {
-                            playFill = Fade(DARKBLUE, playHover ? 0.75f : 0.55f);
-                        }
-                        DrawRectangleRounded(playRect, 0.45f, 6, playFill);
-                        DrawRectangleRoundedLines(playRect, 0.45f, 6, 2.0f, playOutline);
-                        if (!musicReady) {
-                            DrawLine((int)playRect.x + 6, (int)playRect.y + 6, (int)(playRect.x + playRect.width) - 6, (int)(playRect.y + playRect.height) - 6, RAYWHITE);
-                            DrawLine((int)playRect.x + 6, (int)(playRect.y + playRect.height) - 6, (int)(playRect.x + playRect.width) - 6, (int)playRect.y + 6, RAYWHITE);
-                        } else if (playing) {
-                            float pad = 6.0f;
-                            DrawRectangle((int)(playRect.x + pad), (int)(playRect.y + pad), 6, (int)(playRect.height - pad * 2.0f), RAYWHITE);
-                            DrawRectangle((int)(playRect.x + playRect.width - pad - 6.0f), (int)(playRect.y + pad), 6, (int)(playRect.height - pad * 2.0f), RAYWHITE);
-                        } else {
-                            Vector2 p1 = {playRect.x + 8.0f, playRect.y + 6.0f};
-                            Vector2 p2 = {playRect.x + 8.0f, playRect.y + playRect.height - 6.0f};
-                            Vector2 p3 = {playRect.x + playRect.width - 6.0f, playRect.y + playRect.height * 0.5f};
-                            DrawTriangle(p1, p2, p3, RAYWHITE);
-                        }
-
-                        Color loopFill;
-                        if (!musicReady) {
-                            loopFill = Fade(GRAY, loopHover ? 0.5f : 0.4f);
-                        } else if (box->audioLoop) {
-                            loopFill = Fade(DARKGREEN, loopHover ? 0.75f : 0.60f);
-                        } else {
-                            loopFill = Fade(DARKBLUE, loopHover ? 0.65f : 0.45f);
-                        }
-
-                        DrawRectangleRounded(loopRect, 0.45f, 6, loopFill);
-                        DrawRectangleRoundedLines(loopRect, 0.45f, 6, 2.0f, Fade(BLACK, loopHover ? 0.45f : 0.35f));
-
-                        int loopTextWidth = MeasureText("Loop", 16);
-                        float loopTextX = loopRect.x + (loopRect.width - loopTextWidth) * 0.5f;
-                        float loopTextY = loopRect.y + (loopRect.height - 16.0f) * 0.5f;
-                        DrawText("Loop", (int)loopTextX, (int)loopTextY, 16, RAYWHITE);
-
-                        const char* hintText = NULL;
-                        Color hintColor = DARKGRAY;
-                        if (!audioDeviceReady) {
-                            hintText = "Audio disabled";
-                            hintColor = MAROON;
-                        } else if (!musicReady) {
-                            hintText = "Audio failed to load";
-                            hintColor = MAROON;
-                        } else if (playing) {
-                            hintText = "Playing (Space / dbl-click)";
-                            hintColor = DARKGREEN;
-                        } else {
-                            hintText = "Paused (Space / dbl-click)";
-                            hintColor = DARKBLUE;
-                        }
-                        DrawText(hintText, box->x + 16, box->y + box->height - 32, 16, hintColor);
-                        if (editingBoxIndex == i) {
-                            DrawMultilineTextWithSelection(editingText, box->x + 10, box->y + 10, editingFontSize, textColor, selectionStart, selectionEnd, TEXT_SELECTION_COLOR);
-                            DrawTextCursor(box->x, box->y, editingFontSize);
-                        } else {
-                            DrawMultilineTextWithSelection(box->content.text, box->x + 10, box->y + 10, boxFontSize, textColor, 0, 0, TEXT_SELECTION_COLOR);
-                        }
-                    }
-                    break;
-                case BOX_VIDEO:
-                    {
-                        Rectangle dest = {(float)box->x, (float)box->y, (float)box->width, (float)box->height};
-                        DrawRectangleRec(dest, Fade(BLACK, 0.15f));
-                        DrawRectangleLines(box->x, box->y, box->width, box->height, Fade(DARKBLUE, 0.45f));
-
-                        Texture2D* tex = WinVideo_GetTexture(box->content.video);
-                        if (tex != NULL && tex->id != 0 && WinVideo_IsReady(box->content.video)) {
-                            Rectangle source = {0.0f, 0.0f, (float)tex->width, (float)tex->height};
-                            DrawTexturePro(*tex, source, dest, (Vector2){0.0f, 0.0f}, 0.0f, WHITE);
-                        } else {
-                            DrawRectangleLinesEx(dest, 2.0f, Fade(WHITE, 0.2f));
-                            DrawText("Loading video...", box->x + 16, box->y + (box->height / 2) - 12, 20, LIGHTGRAY);
-                        }
-
-                        const char* fileName = ExtractFileName(box->filePath);
-                        if (fileName == NULL || fileName[0] == '\0') {
-                            fileName = "(Video)";
-                        }
-                        int titleFont = 20;
-                        while (titleFont > 12 && MeasureText(fileName, titleFont) > box->width - 32) {
-                            titleFont -= 2;
-                        }
-
-                        int infoBarHeight = (box->videoConvertSamples > 0u) ? 56 : 32;
-                        DrawRectangle(box->x, box->y, box->width, infoBarHeight, Fade(BLACK, 0.35f));
-                        DrawText(fileName, box->x + 16, box->y + 8, titleFont, RAYWHITE);
-
-                        int statsFont = 16;
-                        char frameStats[80];
-                        snprintf(frameStats, sizeof(frameStats), "Frames: %d real · %d fallback", box->videoDecodedFrames, box->videoFallbackFrames);
-                        Color statsColor = (box->videoFallbackFrames > 0) ? ORANGE : Fade(RAYWHITE, 0.85f);
-                        int statsWidth = MeasureText(frameStats, statsFont);
-                        int statsX = box->x + box->width - statsWidth - 16;
-                        if (statsX < box->x + 16) {
-                            statsX = box->x + 16;
-                        }
-                        DrawText(frameStats, statsX, box->y + 8, statsFont, statsColor);
-
-                        if (box->videoConvertSamples > 0u) {
-                            float avgMs = box->videoConvertAvgUs / 1000.0f;
-                            float peakMs = box->videoConvertPeakUs / 1000.0f;
-                            unsigned int sampleCount = box->videoConvertSamples;
-                            const char* formatLabel = (box->videoFormatLabel[0] != '\0') ? box->videoFormatLabel : "Unknown";
-                            char convertStats[112];
-                            snprintf(convertStats, sizeof(convertStats), "Convert: %.2f ms avg · %.2f ms peak · %s · n=%u",
-                                     avgMs, peakMs, formatLabel, sampleCount);
-                            int convertFont = 15;
-                            Color convertColor = (box->videoFallbackFrames > 0) ? ORANGE : Fade(RAYWHITE, 0.78f);
-                            DrawText(convertStats, box->x + 16, box->y + 32, convertFont, convertColor);
-                        }
-                        Rectangle transportBar = { (float)box->x, (float)box->y + (float)box->height - 68.0f, (float)box->width, 68.0f };
-                        DrawRectangleRec(transportBar, Fade(BLACK, 0.35f));
-
-                        Rectangle playRect = GetVideoPlayButtonRect(box);
-                        Rectangle loopRect = GetVideoLoopButtonRect(box);
-                        Rectangle progressRect = GetVideoProgressRect(box);
-
-                        int paused = WinVideo_IsPaused(box->content.video);
-                        int loopEnabled = box->videoLoop;
-                        double duration = box->videoDurationSeconds;
-                        if (duration < 0.0) duration = 0.0;
-                        double position = box->videoPositionSeconds;
-                        if (position < 0.0) position = 0.0;
-                        if (duration > 0.0 && position > duration) position = duration;
-
-                        DrawRectangleRounded(progressRect, 0.45f, 6, Fade(RAYWHITE, 0.18f));
-                        if (progressRect.width > 0.0f) {
-                            double ratio = (duration > 0.0) ? (position / duration) : 0.0;
-                            if (ratio < 0.0) ratio = 0.0;
-                            if (ratio > 1.0) ratio = 1.0;
-                            Rectangle fillRect = progressRect;
-                            fillRect.width *= (float)ratio;
-                            if (fillRect.width < 2.0f) {
-                                fillRect.width = 2.0f;
-                            }
-                            DrawRectangleRounded(fillRect, 0.45f, 6, Fade(SKYBLUE, 0.8f));
-                        }
-
-                        char timeNow[16] = {0};
-                        char timeTotal[16] = {0};
-                        FormatTimeString(position, timeNow, sizeof(timeNow));
-                        if (duration <= 0.0) {
-                            snprintf(timeTotal, sizeof(timeTotal), "--:--");
-                        } else {
-                            FormatTimeString(duration, timeTotal, sizeof(timeTotal));
-                        }
-                        int timeFont = 18;
-                        DrawText(timeNow, (int)progressRect.x, (int)progressRect.y - 24, timeFont, RAYWHITE);
-                        int totalWidth = MeasureText(timeTotal, timeFont);
-                        DrawText(timeTotal, (int)(progressRect.x + progressRect.width - totalWidth), (int)progressRect.y - 24, timeFont, RAYWHITE);
-
-                        bool playHover = CheckCollisionPointRec(mousePos, playRect);
-                        bool loopHover = CheckCollisionPointRec(mousePos, loopRect);
-
-                        Color playFill = paused ? Fade(SKYBLUE, playHover ? 0.85f : 0.65f) : Fade(GREEN, playHover ? 0.85f : 0.65f);
-                        DrawRectangleRounded(playRect, 0.45f, 8, playFill);
-                        DrawRectangleRoundedLines(playRect, 0.45f, 8, 2.0f, Fade(RAYWHITE, 0.6f));
-                        if (paused) {
-                            Vector2 p1 = {playRect.x + 10.0f, playRect.y + 6.0f};
-                            Vector2 p2 = {playRect.x + 10.0f, playRect.y + playRect.height - 6.0f};
-                            Vector2 p3 = {playRect.x + playRect.width - 8.0f, playRect.y + playRect.height * 0.5f};
-                            DrawTriangle(p1, p2, p3, RAYWHITE);
-                        } else {
-                            float pad = 8.0f;
-                            DrawRectangle((int)(playRect.x + pad), (int)(playRect.y + pad), 8, (int)(playRect.height - pad * 2.0f), RAYWHITE);
-                            DrawRectangle((int)(playRect.x + playRect.width - pad - 8.0f), (int)(playRect.y + pad), 8, (int)(playRect.height - pad * 2.0f), RAYWHITE);
-                        }
-
-                        Color loopFill = loopEnabled ? Fade(DARKGREEN, loopHover ? 0.8f : 0.65f) : Fade(SKYBLUE, loopHover ? 0.7f : 0.5f);
-                        DrawRectangleRounded(loopRect, 0.45f, 8, loopFill);
-                        DrawRectangleRoundedLines(loopRect, 0.45f, 8, 2.0f, Fade(RAYWHITE, 0.6f));
-                        int loopLabelWidth = MeasureText("Loop", 18);
-                        DrawText("Loop", (int)(loopRect.x + (loopRect.width - loopLabelWidth) * 0.5f), (int)(loopRect.y + loopRect.height * 0.5f - 9.0f), 18, RAYWHITE);
-
-                        const char* actionLabel = paused ? "Play (Space / dbl-click)" : "Pause (Space / dbl-click)";
-                        DrawText(actionLabel, box->x + 16, (int)(transportBar.y + transportBar.height - 28), 18, RAYWHITE);
-                    }
-                    break;
-                case BOX_DRAWING:
-                    {
-                        Rectangle source = {0.0f, 0.0f, (float)box->content.texture.width, -(float)box->content.texture.height};
-                        Rectangle dest = {(float)box->x, (float)box->y, (float)box->width, (float)box->height};
-                        Vector2 origin = {0.0f, 0.0f};
-                        DrawTexturePro(box->content.texture, source, dest, origin, 0.0f, WHITE);
-                    }
-                    break;
-                default:
-                    break;
+            if (IsBoxAnimating(&boxes[i])) {
+                SceneTiles_MarkLive(boxes, i);
+                mediaAnimating = 1;
             }
+        }
+        Vector2 viewMin = GetScreenToWorld2D((Vector2){0.0f, 0.0f}, camera);
+        Vector2 viewMax = GetScreenToWorld2D((Vector2){(float)screenWidthCurrent, (float)screenHeightCurrent}, camera);
+        Rectangle drawView = {viewMin.x, viewMin.y, viewMax.x - viewMin.x, viewMax.y - viewMin.y};
+        UpdateTextRasters(boxes, boxCount, camera, drawView);
+        int tilesReady = SceneTiles_Update(camera, screenWidthCurrent, screenHeightCurrent, boxes, boxCount, DrawStaticBox, NULL);
+        int penPreviewReady = 0;
+        if (isDrawing && currentTool == TOOL_PEN && penStroke.count > 0) {
+            /* Drawn opaque and faded as a whole, so overlapping segments do not darken. */
+            penPreviewReady = UpdatePenPreview(&penStroke, camera, screenWidthCurrent, screenHeightCurrent, currentDrawColor);
+        }
 
-            if (box->isSelected) {
-                Rectangle selectionRect = {
-                    (float)box->x - 1.0f,
-                    (float)box->y - 1.0f,
-                    (float)box->width + 2.0f,
-                    (float)box->height + 2.0f
-                };
-
-                Color borderColor = BOX_SELECTION_BORDER_COLOR;
+        BeginDrawing();
 
-                if (box->type == BOX_TEXT && editingBoxIndex == i) {
-                    Rectangle glowRect = {
-                        selectionRect.x - 2.0f,
-                        selectionRect.y - 2.0f,
-                        selectionRect.width + 4.0f,
-                        selectionRect.height + 4.0f
-                    };
-                    DrawRectangleLinesEx(glowRect, 2.0f, Fade(TEXT_EDIT_BORDER_COLOR, 0.35f));
-                    borderColor = TEXT_EDIT_BORDER_COLOR;
-                }
+        ClearBackground(RAYWHITE);
 
-                DrawRectangleLinesEx(selectionRect, 2.0f, borderColor);
+        BeginMode2D(camera);
 
-                if (box->type == BOX_TEXT || box->type == BOX_IMAGE || box->type == BOX_AUDIO || box->type == BOX_VIDEO) {
-                    DrawResizeHandles(box);
-                }
+        if (tilesReady) {
+            SceneTiles_Draw();
+            const int* liveOrder = NULL;
+            int liveCount = SceneTiles_GetLive(&liveOrder);
+            for (int d = 0; d < liveCount; d++) {
+                DrawBoxContent(&boxes[liveOrder[d]], liveOrder[d], mousePos, drawView);
+            }
+        } else {
+            /* Boxes in the visible world rect, back to front. */
+            const int* drawOrder = NULL;
+            int drawCount = SceneIndex_QueryRect(drawView, boxes, boxCount, &drawOrder);
+            for (int d = 0; d < drawCount; d++) {
+                DrawBoxContent(&boxes[drawOrder[d]], drawOrder[d], mousePos, drawView);
             }
         }
 
+        if (selectedBox >= 0 && selectedBox < boxCount && boxes[selectedBox].isSelected) {
+            DrawBoxSelection(&boxes[selectedBox], selectedBox);
+        }
+
         if (isDrawing) {
             if (currentTool == TOOL_RECT) {
                 int endX = (int)mousePos.x;
@@ -3172,17 +3431,24 @@ int main(void)
                 Vector2 start = {(float)startX, (float)startY};
                 Vector2 end = {mousePos.x, mousePos.y};
                 DrawLineEx(start, end, STROKE_THICKNESS, Fade(currentDrawColor, 0.8f));
-            } else if (currentTool == TOOL_PEN && penPointCount > 0) {
-                Vector2 prev = penPoints[0];
-                for (int i = 1; i < penPointCount; i++) {
-                    Vector2 curr = penPoints[i];
-                    DrawLineEx(prev, curr, STROKE_THICKNESS, Fade(currentDrawColor, 0.8f));
-                    prev = curr;
+            } else if (currentTool == TOOL_PEN && penStroke.count > 0) {
+                Vector2 prev = penStroke.points[penStroke.count - 1];
+                if (!penPreviewReady) {
+                    for (int i = 1; i < penStroke.count; i++) {
+                        DrawLineEx(penStroke.points[i - 1], penStroke.points[i], STROKE_THICKNESS, Fade(currentDrawColor, 0.8f));
+                    }
                 }
                 DrawLineEx(prev, mousePos, STROKE_THICKNESS, Fade(currentDrawColor, 0.5f));
             }
         }
 
+        EndMode2D();
+
+        if (penPreviewReady) {
+            Rectangle flipped = {0.0f, 0.0f, (float)penPreviewTarget.texture.width, -(float)penPreviewTarget.texture.height};
+            DrawTextureRec(penPreviewTarget.texture, flipped, (Vector2){0.0f, 0.0f}, Fade(WHITE, 0.8f));
+        }
+
         DrawRectangleRec(toolbarRect, Fade(LIGHTGRAY, 0.6f));
         DrawRectangleGradientV(0, 0, screenWidthCurrent, (int)TOOLBAR_HEIGHT, Fade(WHITE, 0.25f), Fade(LIGHTGRAY, 0.05f));
         DrawRectangle(0, (int)TOOLBAR_HEIGHT, screenWidthCurrent, 1, Fade(DARKGRAY, 0.35f));
@@ -3214,8 +3480,8 @@ int main(void)
             }
 
             Color labelColor = isActive ? DARKBLUE : (isHovered ? BLACK : DARKGRAY);
-            int labelWidth = MeasureText(toolLabels[i], 18);
-            DrawText(toolLabels[i], (int)(toolButtons[i].x + (toolButtons[i].width - labelWidth) / 2.0f), (int)(toolButtons[i].y + (toolButtons[i].height - 18.0f) / 2.0f), 18, labelColor);
+            int labelWidth = TextLayout_MeasureText(toolLabels[i], 18);
+            TextLayout_DrawText(toolLabels[i], (int)(toolButtons[i].x + (toolButtons[i].width - labelWidth) / 2.0f), (int)(toolButtons[i].y + (toolButtons[i].height - 18.0f) / 2.0f), 18, labelColor);
         }
 
         for (int i = 0; i < COLOR_PALETTE_COUNT; i++) {
@@ -3246,8 +3512,8 @@ int main(void)
 
         DrawRectangleRounded(bringToFrontButton, BUTTON_ROUNDNESS, 6, bringFill);
         DrawRectangleRoundedLines(bringToFrontButton, BUTTON_ROUNDNESS, 6, 2.0f, bringOutline);
-        int topLabel = MeasureText("Top", 18);
-        DrawText("Top", (int)(bringToFrontButton.x + (bringToFrontButton.width - topLabel) / 2.0f), (int)(bringToFrontButton.y + (bringToFrontButton.height - 18.0f) / 2.0f), 18, bringText);
+        int topLabel = TextLayout_MeasureText("Top", 18);
+        TextLayout_DrawText("Top", (int)(bringToFrontButton.x + (bringToFrontButton.width - topLabel) / 2.0f), (int)(bringToFrontButton.y + (bringToFrontButton.height - 18.0f) / 2.0f), 18, bringText);
 
         Color sendFill = canSend ? Fade(SKYBLUE, sendHovered ? 0.82f : 0.6f) : Fade(LIGHTGRAY, 0.35f);
         Color sendOutline = canSend ? Fade(DARKBLUE, sendHovered ? 0.9f : 0.7f) : Fade(GRAY, 0.8f);
@@ -3255,8 +3521,8 @@ int main(void)
 
         DrawRectangleRounded(sendToBackButton, BUTTON_ROUNDNESS, 6, sendFill);
         DrawRectangleRoundedLines(sendToBackButton, BUTTON_ROUNDNESS, 6, 2.0f, sendOutline);
-        int bottomLabel = MeasureText("Bottom", 18);
-        DrawText("Bottom", (int)(sendToBackButton.x + (sendToBackButton.width - bottomLabel) / 2.0f), (int)(sendToBackButton.y + (sendToBackButton.height - 18.0f) / 2.0f), 18, sendText);
+        int bottomLabel = TextLayout_MeasureText("Bottom", 18);
+        TextLayout_DrawText("Bottom", (int)(sendToBackButton.x + (sendToBackButton.width - bottomLabel) / 2.0f), (int)(sendToBackButton.y + (sendToBackButton.height - 18.0f) / 2.0f), 18, sendText);
 
         int exportHovered = hoveredExport && !showClearConfirm;
         Color exportFill = Fade(SKYBLUE, exportHovered ? 0.85f : 0.65f);
@@ -3265,8 +3531,8 @@ int main(void)
 
         DrawRectangleRounded(exportButton, BUTTON_ROUNDNESS, 6, exportFill);
         DrawRectangleRoundedLines(exportButton, BUTTON_ROUNDNESS, 6, 2.0f, exportOutline);
-        int exportLabel = MeasureText("Export", 18);
-        DrawText("Export", (int)(exportButton.x + (exportButton.width - exportLabel) / 2.0f), (int)(exportButton.y + (exportButton.height - 18.0f) / 2.0f), 18, exportText);
+        int exportLabel = TextLayout_MeasureText("Export", 18);
+        TextLayout_DrawText("Export", (int)(exportButton.x + (exportButton.width - exportLabel) / 2.0f), (int)(exportButton.y + (exportButton.height - 18.0f) / 2.0f), 18, exportText);
 
         int clearHovered = hoveredClear && !showClearConfirm;
         Color clearBase = showClearConfirm ? ORANGE : SKYBLUE;
@@ -3277,8 +3543,8 @@ int main(void)
 
         DrawRectangleRounded(clearButton, BUTTON_ROUNDNESS, 6, clearFill);
         DrawRectangleRoundedLines(clearButton, BUTTON_ROUNDNESS, 6, 2.0f, clearOutline);
-        int clearLabel = MeasureText("Clear", 18);
-        DrawText("Clear", (int)(clearButton.x + (clearButton.width - clearLabel) / 2.0f), (int)(clearButton.y + (clearButton.height - 18.0f) / 2.0f), 18, clearText);
+        int clearLabel = TextLayout_MeasureText("Clear", 18);
+        TextLayout_DrawText("Clear", (int)(clearButton.x + (clearButton.width - clearLabel) / 2.0f), (int)(clearButton.y + (clearButton.height - 18.0f) / 2.0f), 18, clearText);
 
         Rectangle statusBarRect = {0.0f, (float)screenHeightCurrent - STATUS_BAR_HEIGHT, (float)screenWidthCurrent, STATUS_BAR_HEIGHT};
         DrawRectangleRec(statusBarRect, Fade(LIGHTGRAY, 0.45f));
@@ -3295,33 +3561,51 @@ int main(void)
 
         int statusFontSize = 18;
         int statusY = (int)(statusBarRect.y + (statusBarRect.height - statusFontSize) / 2.0f);
-        DrawText(statusTextPtr, 16, statusY, statusFontSize, DARKGRAY);
+        TextLayout_DrawText(statusTextPtr, 16, statusY, statusFontSize, DARKGRAY);
 
         const char* audioStatus = audioDeviceReady ? "Audio ready" : "Audio disabled";
         Color audioColor = audioDeviceReady ? DARKGREEN : MAROON;
-        int audioWidth = MeasureText(audioStatus, 16);
-        DrawText(audioStatus, screenWidthCurrent - audioWidth - 16, statusY, 16, audioColor);
+        int audioWidth = TextLayout_MeasureText(audioStatus, 16);
+        TextLayout_DrawText(audioStatus, screenWidthCurrent - audioWidth - 16, statusY, 16, audioColor);
+
+        char zoomStatus[16];
+        snprintf(zoomStatus, sizeof(zoomStatus), "%d%%", (int)(camera.zoom * 100.0f + 0.5f));
+        int zoomWidth = TextLayout_MeasureText(zoomStatus, 16);
+        TextLayout_DrawText(zoomStatus, screenWidthCurrent - audioWidth - zoomWidth - 40, statusY, 16, DARKGRAY);
 
         if (showClearConfirm) {
             DrawRectangle(0, 0, screenWidthCurrent, screenHeightCurrent, Fade(BLACK, 0.45f));
             DrawRectangleRec(confirmDialogRect, RAYWHITE);
             DrawRectangleLinesEx(confirmDialogRect, 2.0f, DARKGRAY);
             const char* title = "Clear all items?";
-            int titleWidth = MeasureText(title, 22);
-            DrawText(title, (int)(confirmDialogRect.x + (confirmDialogRect.width - titleWidth) / 2.0f), (int)(confirmDialogRect.y + 28.0f), 22, BLACK);
+            int titleWidth = TextLayout_MeasureText(title, 22);
+            TextLayout_DrawText(title, (int)(confirmDialogRect.x + (confirmDialogRect.width - titleWidth) / 2.0f), (int)(confirmDialogRect.y + 28.0f), 22, BLACK);
             const char* subtitle = "This removes every box.";
-            int subtitleWidth = MeasureText(subtitle, 18);
-            DrawText(subtitle, (int)(confirmDialogRect.x + (confirmDialogRect.width - subtitleWidth) / 2.0f), (int)(confirmDialogRect.y + 62.0f), 18, DARKGRAY);
+            int subtitleWidth = TextLayout_MeasureText(subtitle, 18);
+            TextLayout_DrawText(subtitle, (int)(confirmDialogRect.x + (confirmDialogRect.width - subtitleWidth) / 2.0f), (int)(confirmDialogRect.y + 62.0f), 18, DARKGRAY);
 
             DrawRectangleRec(confirmYesRect, Fade(GREEN, 0.7f));
             DrawRectangleLinesEx(confirmYesRect, 1.0f, DARKGREEN);
-            int yesWidth = MeasureText("Confirm", 18);
-            DrawText("Confirm", (int)(confirmYesRect.x + (confirmYesRect.width - yesWidth) / 2.0f), (int)(confirmYesRect.y + (confirmYesRect.height - 18.0f) / 2.0f), 18, BLACK);
+            int yesWidth = TextLayout_MeasureText("Confirm", 18);
+            TextLayout_DrawText("Confirm", (int)(confirmYesRect.x + (confirmYesRect.width - yesWidth) / 2.0f), (int)(confirmYesRect.y + (confirmYesRect.height - 18.0f) / 2.0f), 18, BLACK);
 
             DrawRectangleRec(confirmNoRect, Fade(LIGHTGRAY, 0.7f));
             DrawRectangleLinesEx(confirmNoRect, 1.0f, DARKGRAY);
-            int noWidth = MeasureText("Cancel", 18);
-            DrawText("Cancel", (int)(confirmNoRect.x + (confirmNoRect.width - noWidth) / 2.0f), (int)(confirmNoRect.y + (confirmNoRect.height - 18.0f) / 2.0f), 18, BLACK);
+            int noWidth = TextLayout_MeasureText("Cancel", 18);
+            TextLayout_DrawText("Cancel", (int)(confirmNoRect.x + (confirmNoRect.width - noWidth) / 2.0f), (int)(confirmNoRect.y + (confirmNoRect.height - 18.0f) / 2.0f), 18, BLACK);
+        }
+
+        /* Keep polling while playback, a toast, a blinking caret or background
+           pixel work needs frames; otherwise sleep until input arrives. */
+        int caretBlinking = editingBoxIndex >= 0 && !SelectionHasRange() && cursorBlinkTime < CARET_BLINK_IDLE_SECONDS;
+        int needsFrames = mediaAnimating || statusMessageTimer > 0.0f || caretBlinking ||
+                          PixelStore_GetPendingCount() > 0 || requestExportClipboard;
+        if (needsFrames && eventWaiting) {
+            DisableEventWaiting();
+            eventWaiting = 0;
+        } else if (!needsFrames && !eventWaiting) {
+            EnableEventWaiting();
+            eventWaiting = 1;
         }
 
         EndDrawing();
@@ -3358,9 +3642,23 @@ int main(void)
         }
     }
 
-    for (int i = 0; i < historyCount; i++) {
-        FreeSnapshot(&historyStates[i]);
+    TraceLog(LOG_INFO, "Frames: %llu rendered, %llu skipped while idle", framesRendered, framesSkipped);
+
+    ClearHistory();
+    free(boxes);
+    DrawingShape_FreeStroke(&penStroke);
+    if (penPreviewTarget.id != 0) {
+        UnloadRenderTexture(penPreviewTarget);
     }
+    SceneTiles_Shutdown();
+    DrawingShape_Shutdown();
+    TextBuffer_Free(&editingBuffer);
+    TextLayout_FreeLines(&editingLines);
+    TextLayout_Shutdown();
+    SceneIndex_Shutdown();
+    FreeBoxIds();
+    PixelStore_Shutdown();
+    JobQueue_Shutdown();
 
     WinVideo_GlobalShutdown();
     CloseAudioDevice();
@@ -3380,20 +3678,32 @@ void DestroyBox(Box* box) {
                 free(box->content.text);
                 box->content.text = NULL;
             }
+            TextLayout_FreeLines(box->lines);
+            free(box->lines);
+            box->lines = NULL;
+            ReleaseTextRaster(box->raster);
+            free(box->raster);
+            box->raster = NULL;
             break;
         case BOX_IMAGE:
-        case BOX_DRAWING:
             if (box->content.texture.id != 0) {
                 UnloadTexture(box->content.texture);
                 box->content.texture.id = 0;
             }
+            PixelStore_Release(box->pixels);
+            box->pixels = NULL;
+            break;
+        case BOX_DRAWING:
+            DrawingShape_Release(box->content.shape);
+            box->content.shape = NULL;
             break;
         case BOX_AUDIO:
-            StopAudioPlayback(box);
-            if (audioDeviceReady && IsMusicReady(box->content.music)) {
-                UnloadMusicStream(box->content.music);
+            if (box->media != NULL) {
+                StopAudioPlayback(box);
+                if (audioDeviceReady && IsMusicReady(box->media->music)) {
+                    UnloadMusicStream(box->media->music);
+                }
             }
-            box->content.music = (Music){0};
             break;
         case BOX_VIDEO:
             if (box->content.video != NULL) {
@@ -3411,47 +3721,7 @@ void DestroyBox(Box* box) {
     }
 
     box->isSelected = 0;
-    box->videoDecodedFrames = 0;
-    box->videoFallbackFrames = 0;
-    box->videoReportedDecoded = 0;
-    box->videoReportedFallback = 0;
-    box->videoConvertAvgUs = 0.0f;
-    box->videoConvertPeakUs = 0.0f;
-    box->videoConvertLastUs = 0.0f;
-    box->videoConvertSamples = 0u;
-    box->videoFormatLabel[0] = '\0';
-}
-
-int BringBoxToFront(Box* boxes, int boxCount, int index) {
-    if (index < 0 || index >= boxCount) {
-        return index;
-    }
-    if (index == boxCount - 1) {
-        return index;
-    }
-
-    Box temp = boxes[index];
-    for (int i = index; i < boxCount - 1; i++) {
-        boxes[i] = boxes[i + 1];
-    }
-    boxes[boxCount - 1] = temp;
-    return boxCount - 1;
-}
-
-int SendBoxToBack(Box* boxes, int boxCount, int index) {
-    if (index < 0 || index >= boxCount) {
-        return index;
-    }
-    if (index == 0) {
-        return index;
-    }
-
-    Box temp = boxes[index];
-    for (int i = index; i > 0; i--) {
-        boxes[i] = boxes[i - 1];
-    }
-    boxes[0] = temp;
-    return 0;
+    FreeBoxMedia(box);
 }
 
 void ClearAllBoxes(Box* boxes, int* boxCount, int* selectedBox) {
@@ -3461,18 +3731,18 @@ void ClearAllBoxes(Box* boxes, int* boxCount, int* selectedBox) {
 
     for (int i = 0; i < *boxCount; i++) {
         DestroyBox(&boxes[i]);
-        boxes[i] = (Box){0};
     }
 
-    *boxCount = 0;
+    RemoveAllBoxes(boxes, boxCount);
     *selectedBox = -1;
     ResetEditingState();
 }
 
 void ResetEditingState(void) {
     editingBoxIndex = -1;
-    memset(editingText, 0, sizeof(editingText));
-    memset(editingOriginalText, 0, sizeof(editingOriginalText));
+    FreeSnapshot(&editingBeforeState);
+    TextBuffer_Free(&editingBuffer);
+    TextLayout_IndexLines(&editingLines, "", 0);
     editingFontSize = DEFAULT_FONT_SIZE;
     editingOriginalFontSize = DEFAULT_FONT_SIZE;
     cursorPosition = 0;
@@ -3509,268 +3779,1019 @@ int CopyImageToClipboard(const Image* image) {
     return success;
 }
 
-void FreeSnapshot(CanvasSnapshot* snapshot) {
+void FreeSnapshot(BoxSnapshot* snapshot) {
     if (snapshot == NULL) {
         return;
     }
 
-    for (int i = 0; i < snapshot->boxCount; i++) {
-        if (snapshot->boxes[i].textCopy != NULL) {
-            free(snapshot->boxes[i].textCopy);
-            snapshot->boxes[i].textCopy = NULL;
+    if (snapshot->textCopy != NULL) {
+        free(snapshot->textCopy);
+        snapshot->textCopy = NULL;
+    }
+    if (snapshot->pixels != NULL) {
+        PixelStore_Release(snapshot->pixels);
+        snapshot->pixels = NULL;
+    }
+    if (snapshot->shape != NULL) {
+        DrawingShape_Release(snapshot->shape);
+        snapshot->shape = NULL;
+    }
+    if (snapshot->filePathCopy != NULL) {
+        free(snapshot->filePathCopy);
+        snapshot->filePathCopy = NULL;
+    }
+    if (snapshot->hasLive) {
+        DestroyBox(&snapshot->live);
+        snapshot->live = (Box){0};
+        snapshot->hasLive = 0;
+    }
+}
+
+/* Pauses playback and moves the box's live resources into the snapshot,
+   leaving *box empty so DestroyBox on it is a no-op. */
+static void ParkBox(BoxSnapshot* snapshot, Box* box) {
+    if (snapshot->hasLive) {
+        DestroyBox(&snapshot->live);
+    }
+
+    if (box->type == BOX_AUDIO && audioDeviceReady && IsMusicReady(box->media->music) &&
+        IsMusicStreamPlaying(box->media->music)) {
+        PauseMusicStream(box->media->music);
+        box->media->audioWasPlaying = 0;
+    } else if (box->type == BOX_VIDEO && box->content.video != NULL) {
+        WinVideo_SetPaused(box->content.video, 1);
+    }
+
+    snapshot->live = *box;
+    snapshot->live.isSelected = 0;
+    snapshot->hasLive = 1;
+    *box = (Box){0};
+}
+
+void CaptureSnapshot(BoxSnapshot* snapshot, const Box* box, int includeContent) {
+    if (snapshot == NULL || box == NULL) {
+        return;
+    }
+
+    snapshot->box = *box;
+    snapshot->textCopy = NULL;
+    snapshot->pixels = NULL;
+    snapshot->shape = NULL;
+    snapshot->filePathCopy = NULL;
+    snapshot->live = (Box){0};
+    snapshot->hasLive = 0;
+    snapshot->box.filePath = NULL;
+    snapshot->box.pixels = NULL;
+    snapshot->box.media = NULL;
+    snapshot->box.lines = NULL;
+    snapshot->box.raster = NULL;
+    snapshot->box.isSelected = 0;
+    snapshot->media = (box->media != NULL) ? *box->media : (BoxMedia){0};
+    snapshot->media.music = (Music){0};
+
+    switch (box->type) {
+        case BOX_TEXT:
+            if (includeContent) {
+                snapshot->textCopy = strdup(box->content.text != NULL ? box->content.text : "");
+            }
+            snapshot->box.content.text = NULL;
+            break;
+        case BOX_IMAGE:
+            if (includeContent) {
+                snapshot->pixels = PixelStore_Retain(box->pixels);
+            }
+            snapshot->box.content.texture = (Texture2D){0};
+            break;
+        case BOX_DRAWING:
+            if (includeContent) {
+                snapshot->shape = DrawingShape_Retain(box->content.shape);
+            }
+            snapshot->box.content.shape = NULL;
+            break;
+        case BOX_AUDIO:
+            if (includeContent && box->filePath != NULL) {
+                snapshot->filePathCopy = strdup(box->filePath);
+            }
+            break;
+        case BOX_VIDEO:
+            if (includeContent && box->filePath != NULL) {
+                snapshot->filePathCopy = strdup(box->filePath);
+            }
+            snapshot->box.content.video = NULL;
+            break;
+        default:
+            break;
+    }
+}
+
+static void FreeHistoryOps(HistoryEntry* entry) {
+    for (int i = 0; i < entry->opCount; i++) {
+        FreeSnapshot(&entry->ops[i].before);
+        FreeSnapshot(&entry->ops[i].after);
+    }
+    free(entry->ops);
+    entry->ops = NULL;
+    entry->opCount = 0;
+    entry->opCapacity = 0;
+}
+
+static void ReleaseHistoryIds(HistoryEntry* entry) {
+    for (int i = 0; i < entry->opCount; i++) {
+        ReleaseBoxId(entry->ops[i].id);
+    }
+    for (int i = 0; i < entry->spilledIdCount; i++) {
+        ReleaseBoxId(entry->spilledIds[i]);
+    }
+    free(entry->spilledIds);
+    entry->spilledIds = NULL;
+    entry->spilledIdCount = 0;
+}
+
+static void FreeHistoryEntry(HistoryEntry* entry) {
+    if (entry == NULL) {
+        return;
+    }
+
+    ReleaseHistoryIds(entry);
+    FreeHistoryOps(entry);
+    if (entry->spilled) {
+        historySpilledCount--;
+        historyJournalLiveBytes -= entry->journalSize;
+    } else {
+        historyResidentBytes -= entry->byteCost;
+    }
+    *entry = (HistoryEntry){0};
+
+    /* Nothing left on disk references the journal, so drop it and reclaim the space. */
+    if (historySpilledCount == 0 && historyJournal != NULL) {
+        fclose(historyJournal);
+        historyJournal = NULL;
+        historyJournalLiveBytes = 0;
+    }
+}
+
+static HistoryEntry* HistoryEntryAt(int index) {
+    return &historyRing[(historyHead + index) % historyCapacity];
+}
+
+static size_t SnapshotByteCost(const BoxSnapshot* snapshot) {
+    size_t bytes = 0;
+    if (snapshot->textCopy != NULL) {
+        bytes += strlen(snapshot->textCopy) + 1;
+    }
+    if (snapshot->filePathCopy != NULL) {
+        bytes += strlen(snapshot->filePathCopy) + 1;
+    }
+    /* Pixel blobs may be shared with live boxes and other entries, so they are
+       tallied separately by HistoryPixelBytes. */
+    return bytes + DrawingShape_GetByteCount(snapshot->shape);
+}
+
+static size_t HistoryEntryByteCost(const HistoryEntry* entry) {
+    size_t bytes = sizeof(HistoryEntry) + (size_t)entry->opCapacity * sizeof(HistoryOp);
+    for (int i = 0; i < entry->opCount; i++) {
+        bytes += SnapshotByteCost(&entry->ops[i].before);
+        bytes += SnapshotByteCost(&entry->ops[i].after);
+    }
+    return bytes;
+}
+
+static int ComparePixelBlobs(const void* a, const void* b) {
+    uintptr_t left = (uintptr_t)*(PixelBlob* const*)a;
+    uintptr_t right = (uintptr_t)*(PixelBlob* const*)b;
+    return (left > right) - (left < right);
+}
+
+static int CollectHistoryBlob(PixelBlob* blob, int count) {
+    if (blob == NULL) {
+        return count;
+    }
+    if (count == historyBlobScratchCapacity) {
+        int newCapacity = (historyBlobScratchCapacity > 0) ? historyBlobScratchCapacity * 2 : 64;
+        PixelBlob** grown = (PixelBlob**)realloc(historyBlobScratch, (size_t)newCapacity * sizeof(PixelBlob*));
+        if (grown == NULL) {
+            return -1;
         }
-        if (snapshot->boxes[i].imageCopy.data != NULL) {
-            UnloadImage(snapshot->boxes[i].imageCopy);
-            snapshot->boxes[i].imageCopy = (Image){0};
+        historyBlobScratch = grown;
+        historyBlobScratchCapacity = newCapacity;
+    }
+    historyBlobScratch[count] = blob;
+    return count + 1;
+}
+
+static int CollectSnapshotBlobs(const BoxSnapshot* snapshot, int count) {
+    count = CollectHistoryBlob(snapshot->pixels, count);
+    if (count >= 0 && snapshot->hasLive) {
+        count = CollectHistoryBlob(snapshot->live.pixels, count);
+    }
+    return count;
+}
+
+/* Bytes of the pixel blobs resident history alone keeps alive: each blob once,
+   and only when every reference to it comes from a resident entry's snapshots or
+   parked boxes. Blobs a live box still shows cost history nothing, since spilling
+   the entry would not free them. */
+static size_t HistoryPixelBytes(void) {
+    int count = 0;
+    for (int i = 0; i < historyCount && count >= 0; i++) {
+        const HistoryEntry* entry = HistoryEntryAt(i);
+        for (int j = 0; j < entry->opCount && count >= 0; j++) {
+            count = CollectSnapshotBlobs(&entry->ops[j].before, count);
+            if (count >= 0) {
+                count = CollectSnapshotBlobs(&entry->ops[j].after, count);
+            }
         }
-        if (snapshot->boxes[i].filePathCopy != NULL) {
-            free(snapshot->boxes[i].filePathCopy);
-            snapshot->boxes[i].filePathCopy = NULL;
+    }
+    if (count < 0) {
+        /* Without a tally, assume history owns everything it references. */
+        size_t bytes = 0;
+        for (int i = 0; i < historyCount; i++) {
+            const HistoryEntry* entry = HistoryEntryAt(i);
+            for (int j = 0; j < entry->opCount; j++) {
+                bytes += PixelStore_GetBlobByteCount(entry->ops[j].before.pixels);
+                bytes += PixelStore_GetBlobByteCount(entry->ops[j].after.pixels);
+            }
         }
+        return bytes;
     }
 
-    snapshot->boxCount = 0;
-    snapshot->selectedBox = -1;
+    qsort(historyBlobScratch, (size_t)count, sizeof(PixelBlob*), ComparePixelBlobs);
+    size_t bytes = 0;
+    for (int i = 0; i < count;) {
+        PixelBlob* blob = historyBlobScratch[i];
+        int refs = 0;
+        while (i < count && historyBlobScratch[i] == blob) {
+            refs++;
+            i++;
+        }
+        if (refs >= PixelStore_GetRefCount(blob)) {
+            bytes += PixelStore_GetBlobByteCount(blob);
+        }
+    }
+    return bytes;
 }
 
-void CaptureSnapshot(CanvasSnapshot* snapshot, Box* boxes, int boxCount, int selectedBox) {
-    if (snapshot == NULL) {
-        return;
+static int WriteJournalString(FILE* file, const char* text) {
+    int length = (text != NULL) ? (int)strlen(text) : -1;
+    if (fwrite(&length, sizeof(length), 1, file) != 1) {
+        return 0;
     }
+    return length <= 0 || fwrite(text, 1, (size_t)length, file) == (size_t)length;
+}
 
-    FreeSnapshot(snapshot);
+static int ReadJournalString(FILE* file, char** text) {
+    int length = 0;
+    *text = NULL;
+    if (fread(&length, sizeof(length), 1, file) != 1) {
+        return 0;
+    }
+    if (length < 0) {
+        return 1;
+    }
+    *text = (char*)malloc((size_t)length + 1);
+    if (*text == NULL || fread(*text, 1, (size_t)length, file) != (size_t)length) {
+        free(*text);
+        *text = NULL;
+        return 0;
+    }
+    (*text)[length] = '\0';
+    return 1;
+}
 
-    snapshot->boxCount = boxCount;
-    snapshot->selectedBox = (selectedBox >= 0 && selectedBox < boxCount) ? selectedBox : -1;
+static int WriteJournalSnapshot(FILE* file, const BoxSnapshot* snapshot) {
+    int hasPixels = (snapshot->pixels != NULL);
+    int hasShape = (snapshot->shape != NULL);
+    if (fwrite(&snapshot->box, sizeof(Box), 1, file) != 1 ||
+        fwrite(&snapshot->media, sizeof(BoxMedia), 1, file) != 1 ||
+        !WriteJournalString(file, snapshot->textCopy) ||
+        !WriteJournalString(file, snapshot->filePathCopy) ||
+        fwrite(&hasPixels, sizeof(hasPixels), 1, file) != 1 ||
+        fwrite(&hasShape, sizeof(hasShape), 1, file) != 1) {
+        return 0;
+    }
+    return (!hasPixels || PixelStore_WriteBlob(snapshot->pixels, file)) &&
+           (!hasShape || DrawingShape_Write(snapshot->shape, file));
+}
 
-    for (int i = 0; i < boxCount; i++) {
-        Box* src = &boxes[i];
-        BoxSnapshot* dest = &snapshot->boxes[i];
+static int ReadJournalSnapshot(FILE* file, BoxSnapshot* snapshot) {
+    int hasPixels = 0;
+    int hasShape = 0;
+    *snapshot = (BoxSnapshot){0};
+    if (fread(&snapshot->box, sizeof(Box), 1, file) != 1 ||
+        fread(&snapshot->media, sizeof(BoxMedia), 1, file) != 1) {
+        return 0;
+    }
+    /* Snapshots never own live handles; clear whatever pointers were written. */
+    memset(&snapshot->box.content, 0, sizeof(snapshot->box.content));
+    snapshot->box.pixels = NULL;
+    snapshot->box.media = NULL;
+    snapshot->box.lines = NULL;
+    snapshot->box.raster = NULL;
+    snapshot->box.filePath = NULL;
+    snapshot->media.music = (Music){0};
+
+    if (!ReadJournalString(file, &snapshot->textCopy) ||
+        !ReadJournalString(file, &snapshot->filePathCopy) ||
+        fread(&hasPixels, sizeof(hasPixels), 1, file) != 1 ||
+        fread(&hasShape, sizeof(hasShape), 1, file) != 1) {
+        FreeSnapshot(snapshot);
+        return 0;
+    }
+    if (hasPixels) {
+        snapshot->pixels = PixelStore_ReadBlob(file);
+        if (snapshot->pixels == NULL) {
+            FreeSnapshot(snapshot);
+            return 0;
+        }
+    }
+    if (hasShape) {
+        snapshot->shape = DrawingShape_Read(file);
+        if (snapshot->shape == NULL) {
+            FreeSnapshot(snapshot);
+            return 0;
+        }
+    }
+    return 1;
+}
 
-        dest->box = *src;
-        dest->textCopy = NULL;
-        dest->imageCopy = (Image){0};
-        dest->filePathCopy = NULL;
-        dest->box.filePath = NULL;
+static int SpillHistoryEntry(HistoryEntry* entry) {
+    if (historyJournal == NULL) {
+        historyJournal = tmpfile();
+        if (historyJournal == NULL) {
+            return 0;
+        }
+    }
 
-        switch (src->type) {
-            case BOX_TEXT:
-                if (src->content.text != NULL) {
-                    dest->textCopy = strdup(src->content.text);
-                } else {
-                    dest->textCopy = strdup("");
-                }
-                dest->box.content.text = NULL;
-                break;
-            case BOX_IMAGE:
-            case BOX_DRAWING:
-                if (src->content.texture.id != 0) {
-                    dest->imageCopy = LoadImageFromTexture(src->content.texture);
-                }
-                dest->box.content.texture = (Texture2D){0};
-                break;
-            case BOX_AUDIO:
-                if (src->filePath != NULL) {
-                    dest->filePathCopy = strdup(src->filePath);
-                }
-                dest->box.content.music = (Music){0};
-                break;
-            case BOX_VIDEO:
-                if (src->filePath != NULL) {
-                    dest->filePathCopy = strdup(src->filePath);
-                }
-                dest->box.content.video = NULL;
-                break;
-            default:
-                break;
+    /* The ops' id references stay held while they are on disk. */
+    BoxId* ids = (BoxId*)malloc((size_t)entry->opCount * sizeof(BoxId));
+    if (ids == NULL) {
+        return 0;
+    }
+    for (int i = 0; i < entry->opCount; i++) {
+        ids[i] = entry->ops[i].id;
+    }
+
+    long offset = (fseek(historyJournal, 0, SEEK_END) == 0) ? ftell(historyJournal) : -1;
+    if (offset < 0 || fwrite(&entry->opCount, sizeof(entry->opCount), 1, historyJournal) != 1) {
+        free(ids);
+        return 0;
+    }
+    for (int i = 0; i < entry->opCount; i++) {
+        const HistoryOp* op = &entry->ops[i];
+        unsigned int header[3] = {(unsigned int)op->type, op->id, op->fields};
+        if (fwrite(header, sizeof(header), 1, historyJournal) != 1 ||
+            !WriteJournalSnapshot(historyJournal, &op->before) ||
+            !WriteJournalSnapshot(historyJournal, &op->after)) {
+            free(ids);
+            return 0;
         }
     }
+
+    long end = ftell(historyJournal);
+    if (end < 0) {
+        free(ids);
+        return 0;
+    }
+    entry->spilledIds = ids;
+    entry->spilledIdCount = entry->opCount;
+    FreeHistoryOps(entry);
+    historyResidentBytes -= entry->byteCost;
+    entry->byteCost = 0;
+    entry->spilled = 1;
+    entry->journalOffset = offset;
+    entry->journalSize = end - offset;
+    historySpilledCount++;
+    historyJournalLiveBytes += entry->journalSize;
+    return 1;
 }
 
-void PushHistoryState(Box* boxes, int boxCount, int selectedBox) {
-    if (suppressHistory) {
+/* Brings entry index back into memory. Its journal record becomes dead space
+   until the journal is next compacted. */
+static int LoadSpilledHistoryEntry(int index) {
+    HistoryEntry* entry = HistoryEntryAt(index);
+    if (!entry->spilled) {
+        return 1;
+    }
+    if (historyJournal == NULL || fseek(historyJournal, entry->journalOffset, SEEK_SET) != 0) {
+        return 0;
+    }
+
+    int opCount = 0;
+    if (fread(&opCount, sizeof(opCount), 1, historyJournal) != 1 || opCount <= 0) {
+        return 0;
+    }
+    HistoryOp* ops = (HistoryOp*)calloc((size_t)opCount, sizeof(HistoryOp));
+    if (ops == NULL) {
+        return 0;
+    }
+
+    int loaded = 0;
+    for (; loaded < opCount; loaded++) {
+        HistoryOp* op = &ops[loaded];
+        unsigned int header[3] = {0};
+        if (fread(header, sizeof(header), 1, historyJournal) != 1) {
+            break;
+        }
+        op->type = (HistoryOpType)header[0];
+        op->id = header[1];
+        op->fields = header[2];
+        if (!ReadJournalSnapshot(historyJournal, &op->before)) {
+            break;
+        }
+        if (!ReadJournalSnapshot(historyJournal, &op->after)) {
+            FreeSnapshot(&op->before);
+            break;
+        }
+    }
+    if (loaded < opCount) {
+        for (int i = 0; i < loaded; i++) {
+            FreeSnapshot(&ops[i].before);
+            FreeSnapshot(&ops[i].after);
+        }
+        free(ops);
+        return 0;
+    }
+
+    entry->ops = ops;
+    entry->opCount = opCount;
+    entry->opCapacity = opCount;
+    entry->spilled = 0;
+    /* The loaded ops carry the references again. */
+    free(entry->spilledIds);
+    entry->spilledIds = NULL;
+    entry->spilledIdCount = 0;
+    entry->byteCost = HistoryEntryByteCost(entry);
+    historySpilledCount--;
+    historyJournalLiveBytes -= entry->journalSize;
+    historyResidentBytes += entry->byteCost;
+    if (historySpillCursor > index) {
+        historySpillCursor = index;
+    }
+    if (historySpillTop <= index) {
+        historySpillTop = index + 1;
+    }
+    return 1;
+}
+
+static void ReleaseParkedBoxes(HistoryEntry* entry) {
+    for (int i = 0; i < entry->opCount; i++) {
+        HistoryOp* op = &entry->ops[i];
+        if (op->before.hasLive) {
+            DestroyBox(&op->before.live);
+            op->before.hasLive = 0;
+        }
+        if (op->after.hasLive) {
+            DestroyBox(&op->after.live);
+            op->after.hasLive = 0;
+        }
+    }
+}
+
+static void DropOldestHistoryEntry(void) {
+    FreeHistoryEntry(HistoryEntryAt(0));
+    historyHead = (historyHead + 1) % historyCapacity;
+    historyCount--;
+    historyIndex--;
+    if (historySpillCursor > 0) {
+        historySpillCursor--;
+    }
+    if (historySpillTop > 0) {
+        historySpillTop--;
+    }
+}
+
+/* Rewrites the journal with only the records of entries still spilled once
+   loaded and dropped entries leave it mostly dead space. */
+static void CompactHistoryJournal(void) {
+    if (historyJournal == NULL || fseek(historyJournal, 0, SEEK_END) != 0) {
+        return;
+    }
+    long deadBytes = ftell(historyJournal) - historyJournalLiveBytes;
+    if (deadBytes <= HISTORY_JOURNAL_SLACK || deadBytes <= historyJournalLiveBytes) {
         return;
     }
 
-    if (historyIndex < historyCount - 1) {
-        for (int i = historyIndex + 1; i < historyCount; i++) {
-            FreeSnapshot(&historyStates[i]);
-            historyStates[i] = (CanvasSnapshot){0};
+    FILE* compacted = tmpfile();
+    if (compacted == NULL) {
+        return;
+    }
+    long* offsets = (long*)malloc((size_t)(historyCount > 0 ? historyCount : 1) * sizeof(long));
+    int ok = (offsets != NULL);
+    char chunk[16384];
+    for (int i = 0; ok && i < historyCount; i++) {
+        const HistoryEntry* entry = HistoryEntryAt(i);
+        if (!entry->spilled) {
+            continue;
+        }
+        offsets[i] = ftell(compacted);
+        ok = offsets[i] >= 0 && fseek(historyJournal, entry->journalOffset, SEEK_SET) == 0;
+        for (long left = entry->journalSize; ok && left > 0;) {
+            size_t size = (left < (long)sizeof(chunk)) ? (size_t)left : sizeof(chunk);
+            ok = fread(chunk, 1, size, historyJournal) == size && fwrite(chunk, 1, size, compacted) == size;
+            left -= (long)size;
         }
-        historyCount = historyIndex + 1;
+    }
+    if (!ok) {
+        free(offsets);
+        fclose(compacted);
+        return;
     }
 
-    if (historyCount == MAX_HISTORY) {
-        FreeSnapshot(&historyStates[0]);
-        for (int i = 1; i < historyCount; i++) {
-            historyStates[i - 1] = historyStates[i];
+    for (int i = 0; i < historyCount; i++) {
+        if (HistoryEntryAt(i)->spilled) {
+            HistoryEntryAt(i)->journalOffset = offsets[i];
         }
-        historyStates[historyCount - 1] = (CanvasSnapshot){0};
-        historyCount--;
-        if (historyIndex > 0) {
-            historyIndex--;
+    }
+    free(offsets);
+    fclose(historyJournal);
+    historyJournal = compacted;
+}
+
+/* Spills the resident entries furthest from historyIndex until the budget
+   holds, so the steps undo and redo reach next stay in memory. Pixels count only
+   where history alone keeps them alive. The entries on either side of
+   historyIndex are never spilled; if the journal cannot be written, the oldest
+   entries are dropped instead. */
+static void EnforceHistoryBudget(void) {
+    while (historyResidentBytes + HistoryPixelBytes() > HISTORY_MEMORY_BUDGET) {
+        while (historySpillCursor < historyCount && HistoryEntryAt(historySpillCursor)->spilled) {
+            historySpillCursor++;
+        }
+        if (historySpillTop > historyCount) {
+            historySpillTop = historyCount;
+        }
+        while (historySpillTop > historySpillCursor && HistoryEntryAt(historySpillTop - 1)->spilled) {
+            historySpillTop--;
+        }
+
+        int older = (historySpillCursor < historyIndex - 1) ? historySpillCursor : -1;
+        int newer = (historySpillTop - 1 > historyIndex) ? historySpillTop - 1 : -1;
+        int victim = older;
+        if (newer >= 0 && (older < 0 || newer - historyIndex > historyIndex - older)) {
+            victim = newer;
+        }
+        if (victim < 0) {
+            break;
+        }
+
+        if (!SpillHistoryEntry(HistoryEntryAt(victim))) {
+            if (historyIndex < 2) {
+                break;
+            }
+            DropOldestHistoryEntry();
         }
     }
+    CompactHistoryJournal();
+}
+
+static int EnsureHistoryCapacity(void) {
+    if (historyCount < historyCapacity) {
+        return 1;
+    }
 
-    CaptureSnapshot(&historyStates[historyCount], boxes, boxCount, selectedBox);
+    int newCapacity = (historyCapacity > 0) ? historyCapacity * 2 : 64;
+    HistoryEntry* ring = (HistoryEntry*)calloc((size_t)newCapacity, sizeof(HistoryEntry));
+    if (ring == NULL) {
+        return 0;
+    }
+    for (int i = 0; i < historyCount; i++) {
+        ring[i] = *HistoryEntryAt(i);
+    }
+    free(historyRing);
+    historyRing = ring;
+    historyCapacity = newCapacity;
+    historyHead = 0;
+    return 1;
+}
+
+static HistoryOp* AppendHistoryOp(HistoryOpType type, BoxId id) {
+    if (pendingEntry.opCount == pendingEntry.opCapacity) {
+        int newCapacity = pendingEntry.opCapacity > 0 ? pendingEntry.opCapacity * 2 : 4;
+        HistoryOp* grown = (HistoryOp*)realloc(pendingEntry.ops, (size_t)newCapacity * sizeof(HistoryOp));
+        if (grown == NULL) {
+            return NULL;
+        }
+        pendingEntry.ops = grown;
+        pendingEntry.opCapacity = newCapacity;
+    }
+
+    HistoryOp* op = &pendingEntry.ops[pendingEntry.opCount++];
+    *op = (HistoryOp){0};
+    op->type = type;
+    op->id = id;
+    RetainBoxId(id);
+    return op;
+}
+
+static void CommitHistoryEntry(int selectedBox) {
+    pendingEntry.selectedAfter = GetBoxIdAt(selectedBox);
+    if (pendingEntry.opCount == 0) {
+        FreeHistoryEntry(&pendingEntry);
+        return;
+    }
+
+    for (int i = historyIndex; i < historyCount; i++) {
+        FreeHistoryEntry(HistoryEntryAt(i));
+    }
+    historyCount = historyIndex;
+    if (historySpillCursor > historyCount) {
+        historySpillCursor = historyCount;
+    }
+
+    if (!EnsureHistoryCapacity()) {
+        if (historyCount == 0) {
+            FreeHistoryEntry(&pendingEntry);
+            return;
+        }
+        DropOldestHistoryEntry();
+    }
+
+    pendingEntry.selectedBefore = historySelection;
+    pendingEntry.byteCost = HistoryEntryByteCost(&pendingEntry);
+    historyResidentBytes += pendingEntry.byteCost;
+    *HistoryEntryAt(historyCount) = pendingEntry;
     historyCount++;
-    historyIndex = historyCount - 1;
+    historySpillTop = historyCount;
+    historyIndex = historyCount;
+    historySelection = pendingEntry.selectedAfter;
+    pendingEntry = (HistoryEntry){0};
+
+    /* Parked media only pays off for recent deletes; older entries rebuild from data. */
+    if (historyCount > HISTORY_PARKED_ENTRY_LIMIT) {
+        ReleaseParkedBoxes(HistoryEntryAt(historyCount - 1 - HISTORY_PARKED_ENTRY_LIMIT));
+    }
+    EnforceHistoryBudget();
 }
 
-void RestoreSnapshotState(Box* boxes, int* boxCount, int* selectedBox, int targetIndex) {
-    if (targetIndex < 0 || targetIndex >= historyCount || boxes == NULL || boxCount == NULL || selectedBox == NULL) {
+static void FinishHistoryOp(int selectedBox) {
+    if (historyGroupDepth > 0) {
+        pendingEntry.selectedAfter = GetBoxIdAt(selectedBox);
         return;
     }
+    CommitHistoryEntry(selectedBox);
+}
 
-    suppressHistory = 1;
+void BeginHistoryGroup(void) {
+    historyGroupDepth++;
+}
 
-    for (int i = 0; i < *boxCount; i++) {
-        DestroyBox(&boxes[i]);
-        boxes[i] = (Box){0};
+void EndHistoryGroup(int selectedBox) {
+    if (historyGroupDepth <= 0) {
+        return;
+    }
+    historyGroupDepth--;
+    if (historyGroupDepth == 0) {
+        CommitHistoryEntry(selectedBox);
     }
+}
 
-    CanvasSnapshot* snapshot = &historyStates[targetIndex];
-    for (int i = 0; i < snapshot->boxCount; i++) {
-        BoxSnapshot* src = &snapshot->boxes[i];
-        boxes[i] = src->box;
-        boxes[i].filePath = NULL;
+void PushCreateHistory(Box* boxes, int index, int selectedBox) {
+    if (suppressHistory || boxes == NULL || index < 0) {
+        return;
+    }
 
-        switch (src->box.type) {
-            case BOX_TEXT:
-                boxes[i].content.text = src->textCopy ? strdup(src->textCopy) : strdup("");
-                break;
-            case BOX_IMAGE:
-            case BOX_DRAWING:
-                if (src->imageCopy.data != NULL) {
-                    boxes[i].content.texture = LoadTextureFromImage(src->imageCopy);
-                } else {
-                    boxes[i].content.texture = (Texture2D){0};
-                }
-                break;
-            case BOX_AUDIO:
-                if (src->filePathCopy != NULL) {
-                    boxes[i].filePath = strdup(src->filePathCopy);
+    HistoryOp* op = AppendHistoryOp(HISTORY_OP_CREATE, boxes[index].id);
+    if (op == NULL) {
+        return;
+    }
+    CaptureSnapshot(&op->after, &boxes[index], 1);
+    FinishHistoryOp(selectedBox);
+}
+
+/* Takes over the box's live resources and leaves *box empty, so the caller's
+   DestroyBox only has an effect when history is not recording. */
+void PushDeleteHistory(Box* box, int selectedBox) {
+    if (suppressHistory || box == NULL) {
+        return;
+    }
+
+    HistoryOp* op = AppendHistoryOp(HISTORY_OP_DELETE, box->id);
+    if (op == NULL) {
+        return;
+    }
+    CaptureSnapshot(&op->before, box, 1);
+    /* Parking empties the box, so its area has to be recorded first. */
+    MarkBoxDirty(box);
+    ParkBox(&op->before, box);
+    FinishHistoryOp(selectedBox);
+}
+
+static unsigned int DiffSnapshotFields(const BoxSnapshot* before, const BoxSnapshot* after) {
+    unsigned int fields = 0;
+    const Box* a = &before->box;
+    const Box* b = &after->box;
+
+    if (a->x != b->x || a->y != b->y || a->width != b->width || a->height != b->height ||
+        a->wrapWidth != b->wrapWidth) {
+        fields |= HISTORY_FIELD_GEOMETRY;
+    }
+    if (a->fontSize != b->fontSize || !ColorsEqual(a->textColor, b->textColor)) {
+        fields |= HISTORY_FIELD_STYLE;
+    }
+    if (before->textCopy != NULL && after->textCopy != NULL && strcmp(before->textCopy, after->textCopy) != 0) {
+        fields |= HISTORY_FIELD_TEXT;
+    }
+    if (before->media.audioLoop != after->media.audioLoop || before->media.videoLoop != after->media.videoLoop) {
+        fields |= HISTORY_FIELD_LOOP;
+    }
+    if (a->zKey != b->zKey) {
+        fields |= HISTORY_FIELD_ZORDER;
+    }
+    return fields;
+}
+
+/* Takes ownership of *before; the caller's snapshot is left empty. */
+void PushModifyHistory(BoxSnapshot* before, const Box* after, int selectedBox) {
+    if (before == NULL) {
+        return;
+    }
+    if (suppressHistory || after == NULL) {
+        FreeSnapshot(before);
+        return;
+    }
+
+    BoxSnapshot afterState;
+    CaptureSnapshot(&afterState, after, before->textCopy != NULL);
+
+    unsigned int fields = DiffSnapshotFields(before, &afterState);
+    if (fields == 0) {
+        FreeSnapshot(before);
+        FreeSnapshot(&afterState);
+        return;
+    }
+    if (!(fields & HISTORY_FIELD_TEXT)) {
+        FreeSnapshot(before);
+        FreeSnapshot(&afterState);
+    }
+
+    HistoryOp* op = AppendHistoryOp(HISTORY_OP_MODIFY, after->id);
+    if (op == NULL) {
+        FreeSnapshot(before);
+        FreeSnapshot(&afterState);
+        return;
+    }
+    op->fields = fields;
+    op->before = *before;
+    op->after = afterState;
+    *before = (BoxSnapshot){0};
+    FinishHistoryOp(selectedBox);
+}
+
+void ClearHistory(void) {
+    for (int i = 0; i < historyCount; i++) {
+        FreeHistoryEntry(HistoryEntryAt(i));
+    }
+    FreeHistoryEntry(&pendingEntry);
+    free(historyRing);
+    historyRing = NULL;
+    historyCapacity = 0;
+    historyHead = 0;
+    historyCount = 0;
+    historyIndex = 0;
+    historyResidentBytes = 0;
+    free(historyBlobScratch);
+    historyBlobScratch = NULL;
+    historyBlobScratchCapacity = 0;
+    historySpillCursor = 0;
+    historySpillTop = 0;
+    historyGroupDepth = 0;
+    historySelection = BOX_ID_NONE;
+}
+
+static void MaterializeBoxFromSnapshot(Box* dest, const BoxSnapshot* src) {
+    *dest = src->box;
+    dest->filePath = NULL;
+    dest->media = NULL;
+    dest->lines = NULL;
+    dest->raster = NULL;
+    if ((src->box.type == BOX_AUDIO || src->box.type == BOX_VIDEO) && EnsureBoxMedia(dest) != NULL) {
+        *dest->media = src->media;
+    }
+
+    switch (src->box.type) {
+        case BOX_TEXT:
+            SetBoxText(dest, src->textCopy ? strdup(src->textCopy) : strdup(""));
+            break;
+        case BOX_IMAGE:
+            dest->pixels = PixelStore_Retain(src->pixels);
+            if (src->pixels != NULL) {
+                dest->content.texture = LoadTextureFromImage(PixelStore_GetImage(src->pixels));
+                if (COMPRESS_PIXEL_SOURCES) {
+                    PixelStore_Compress(src->pixels);
                 }
-                boxes[i].content.music = (Music){0};
-                boxes[i].audioStreamStarted = 0;
-                boxes[i].audioWasPlaying = 0;
-                boxes[i].audioTimePlayed = 0.0f;
-                if (boxes[i].filePath != NULL && audioDeviceReady) {
-                    Music restored = LoadMusicStream(boxes[i].filePath);
-                    if (IsMusicReady(restored)) {
-                        restored.looping = boxes[i].audioLoop ? 1 : 0;
-                        boxes[i].content.music = restored;
-                        boxes[i].audioDurationSeconds = GetMusicTimeLength(restored);
-                    } else {
-                        UnloadMusicStream(restored);
-                        boxes[i].audioDurationSeconds = 0.0f;
-                    }
+            } else {
+                dest->content.texture = (Texture2D){0};
+            }
+            break;
+        case BOX_DRAWING:
+            dest->pixels = NULL;
+            dest->content.shape = DrawingShape_Retain(src->shape);
+            break;
+        case BOX_AUDIO:
+            if (src->filePathCopy != NULL) {
+                dest->filePath = strdup(src->filePathCopy);
+            }
+            dest->media->music = (Music){0};
+            dest->media->audioStreamStarted = 0;
+            dest->media->audioWasPlaying = 0;
+            dest->media->audioTimePlayed = 0.0f;
+            if (dest->filePath != NULL && audioDeviceReady) {
+                Music restored = LoadMusicStream(dest->filePath);
+                if (IsMusicReady(restored)) {
+                    restored.looping = dest->media->audioLoop ? 1 : 0;
+                    dest->media->music = restored;
+                    dest->media->audioDurationSeconds = GetMusicTimeLength(restored);
                 } else {
-                    boxes[i].audioDurationSeconds = 0.0f;
-                }
-                if (boxes[i].width <= 0) boxes[i].width = AUDIO_BOX_WIDTH;
-                if (boxes[i].height <= 0) boxes[i].height = AUDIO_BOX_HEIGHT;
-                break;
-            case BOX_VIDEO:
-                boxes[i].content.video = NULL;
-                if (src->filePathCopy != NULL) {
-                    boxes[i].filePath = strdup(src->filePathCopy);
+                    UnloadMusicStream(restored);
+                    dest->media->audioDurationSeconds = 0.0f;
                 }
+            } else {
+                dest->media->audioDurationSeconds = 0.0f;
+            }
+            if (dest->width <= 0) dest->width = AUDIO_BOX_WIDTH;
+            if (dest->height <= 0) dest->height = AUDIO_BOX_HEIGHT;
+            break;
+        case BOX_VIDEO:
+            dest->content.video = NULL;
+            if (src->filePathCopy != NULL) {
+                dest->filePath = strdup(src->filePathCopy);
+            }
 #ifdef _WIN32
-                if (boxes[i].filePath != NULL) {
-                    WinVideoPlayer* restoredVideo = WinVideo_Load(boxes[i].filePath);
-                    if (restoredVideo != NULL) {
-                        boxes[i].content.video = restoredVideo;
-                        boxes[i].videoDecodedFrames = WinVideo_GetDecodedFrameCount(restoredVideo);
-                        boxes[i].videoFallbackFrames = WinVideo_GetFallbackFrameCount(restoredVideo);
-                        boxes[i].videoReportedDecoded = 0;
-                        boxes[i].videoReportedFallback = 0;
-                        boxes[i].videoConvertAvgUs = 0.0f;
-                        boxes[i].videoConvertPeakUs = 0.0f;
-                        boxes[i].videoConvertLastUs = 0.0f;
-                        boxes[i].videoConvertSamples = 0u;
-                        const char* restoredFormat = WinVideo_GetSampleFormatLabel(restoredVideo);
-                        if (restoredFormat != NULL) {
-                            strncpy(boxes[i].videoFormatLabel, restoredFormat, sizeof(boxes[i].videoFormatLabel) - 1);
-                            boxes[i].videoFormatLabel[sizeof(boxes[i].videoFormatLabel) - 1] = '\0';
-                        } else {
-                            boxes[i].videoFormatLabel[0] = '\0';
-                        }
-                        Texture2D* tex = WinVideo_GetTexture(restoredVideo);
-                        if (tex != NULL && tex->id != 0) {
-                            int texW = tex->width;
-                            int texH = tex->height;
-                            if (texW <= 0 || texH <= 0) {
-                                texW = 320;
-                                texH = 180;
-                            }
-                            const float maxW = 640.0f;
-                            const float maxH = 480.0f;
-                            float scale = 1.0f;
-                            if (texW > maxW || texH > maxH) {
-                                float scaleW = maxW / (float)texW;
-                                float scaleH = maxH / (float)texH;
-                                scale = (scaleW < scaleH) ? scaleW : scaleH;
-                            }
-                            boxes[i].width = (int)((float)texW * scale);
-                            boxes[i].height = (int)((float)texH * scale);
-                            if (boxes[i].width <= 0) boxes[i].width = texW;
-                            if (boxes[i].height <= 0) boxes[i].height = texH;
-                        }
+            if (dest->filePath != NULL) {
+                WinVideoPlayer* restoredVideo = WinVideo_Load(dest->filePath);
+                if (restoredVideo != NULL) {
+                    dest->content.video = restoredVideo;
+                    dest->media->videoDecodedFrames = WinVideo_GetDecodedFrameCount(restoredVideo);
+                    dest->media->videoFallbackFrames = WinVideo_GetFallbackFrameCount(restoredVideo);
+                    dest->media->videoReportedDecoded = 0;
+                    dest->media->videoReportedFallback = 0;
+                    dest->media->videoConvertAvgUs = 0.0f;
+                    dest->media->videoConvertPeakUs = 0.0f;
+                    dest->media->videoConvertLastUs = 0.0f;
+                    dest->media->videoConvertSamples = 0u;
+                    const char* restoredFormat = WinVideo_GetSampleFormatLabel(restoredVideo);
+                    if (restoredFormat != NULL) {
+                        strncpy(dest->media->videoFormatLabel, restoredFormat, sizeof(dest->media->videoFormatLabel) - 1);
+                        dest->media->videoFormatLabel[sizeof(dest->media->videoFormatLabel) - 1] = '\0';
+                    } else {
+                        dest->media->videoFormatLabel[0] = '\0';
                     }
+                    WinVideo_SetLooping(restoredVideo, dest->media->videoLoop);
                 }
+            }
 #endif
-                if (boxes[i].content.video == NULL) {
-                    if (boxes[i].filePath != NULL) {
-                        free(boxes[i].filePath);
-                        boxes[i].filePath = NULL;
-                    }
-                    boxes[i].videoDecodedFrames = 0;
-                    boxes[i].videoFallbackFrames = 0;
-                    boxes[i].videoReportedDecoded = 0;
-                    boxes[i].videoReportedFallback = 0;
-                    boxes[i].videoConvertAvgUs = 0.0f;
-                    boxes[i].videoConvertPeakUs = 0.0f;
-                    boxes[i].videoConvertLastUs = 0.0f;
-                    boxes[i].videoConvertSamples = 0u;
-                    boxes[i].videoFormatLabel[0] = '\0';
-                    const char* fallback = "(Video unavailable)";
-                    boxes[i].type = BOX_TEXT;
-                    boxes[i].content.text = strdup(fallback);
-                    boxes[i].fontSize = DEFAULT_FONT_SIZE;
-                    boxes[i].textColor = BLACK;
-                    CalculateTextBoxSize(fallback, boxes[i].fontSize, &boxes[i].width, &boxes[i].height);
+            if (dest->content.video == NULL) {
+                if (dest->filePath != NULL) {
+                    free(dest->filePath);
+                    dest->filePath = NULL;
                 }
-                break;
-            default:
-                break;
+                FreeBoxMedia(dest);
+                const char* fallback = "(Video unavailable)";
+                dest->type = BOX_TEXT;
+                SetBoxText(dest, strdup(fallback));
+                dest->fontSize = DEFAULT_FONT_SIZE;
+                dest->textColor = BLACK;
+                CalculateTextBoxSize(fallback, dest->fontSize, &dest->width, &dest->height);
+            }
+            break;
+        default:
+            break;
+    }
+
+    dest->isSelected = 0;
+}
+
+static void ApplyModifyOp(Box* boxes, const HistoryOp* op, int useAfter) {
+    int index = FindBoxIndex(op->id);
+    if (index < 0) {
+        return;
+    }
+
+    const BoxSnapshot* state = useAfter ? &op->after : &op->before;
+    Box* box = &boxes[index];
+    MarkBoxDirty(box);
+
+    if (op->fields & HISTORY_FIELD_GEOMETRY) {
+        box->x = state->box.x;
+        box->y = state->box.y;
+        box->width = state->box.width;
+        box->height = state->box.height;
+        box->wrapWidth = state->box.wrapWidth;
+        SceneIndex_Update(boxes, index);
+    }
+    if (op->fields & HISTORY_FIELD_ZORDER) {
+        box->zKey = state->box.zKey;
+    }
+    if (op->fields & HISTORY_FIELD_STYLE) {
+        box->fontSize = state->box.fontSize;
+        box->textColor = state->box.textColor;
+    }
+    if ((op->fields & HISTORY_FIELD_TEXT) && box->type == BOX_TEXT && state->textCopy != NULL) {
+        char* text = strdup(state->textCopy);
+        if (text != NULL) {
+            SetBoxText(box, text);
+        }
+    }
+    if (op->fields & HISTORY_FIELD_LOOP) {
+        if (box->media != NULL) {
+            box->media->audioLoop = state->media.audioLoop;
+            box->media->videoLoop = state->media.videoLoop;
+            if (box->type == BOX_AUDIO && audioDeviceReady && IsMusicReady(box->media->music)) {
+                box->media->music.looping = box->media->audioLoop ? 1 : 0;
+            } else if (box->type == BOX_VIDEO && box->content.video != NULL) {
+                WinVideo_SetLooping(box->content.video, box->media->videoLoop);
+            }
+        }
+    }
+    MarkBoxDirty(box);
+}
+
+static void ApplyHistoryOp(Box** boxes, int* boxCount, int* boxCapacity, HistoryOp* op, int forward) {
+    switch (op->type) {
+        case HISTORY_OP_MODIFY:
+            ApplyModifyOp(*boxes, op, forward);
+            break;
+        case HISTORY_OP_CREATE:
+        case HISTORY_OP_DELETE: {
+            int inserting = (op->type == HISTORY_OP_CREATE) ? forward : !forward;
+            BoxSnapshot* state = (op->type == HISTORY_OP_CREATE) ? &op->after : &op->before;
+            if (inserting) {
+                Box restored = {0};
+                if (state->hasLive) {
+                    restored = state->live;
+                    state->live = (Box){0};
+                    state->hasLive = 0;
+                } else {
+                    MaterializeBoxFromSnapshot(&restored, state);
+                }
+                if (RestoreBox(boxes, boxCount, boxCapacity, &restored) < 0) {
+                    DestroyBox(&restored);
+                }
+            } else {
+                int index = FindBoxIndex(op->id);
+                Box removed = {0};
+                if (index >= 0) {
+                    RemoveBoxAt(*boxes, boxCount, index, &removed);
+                    ParkBox(state, &removed);
+                }
+            }
+            break;
         }
+        default:
+            break;
+    }
+}
+
+static void ApplyHistoryEntry(Box** boxes, int* boxCount, int* boxCapacity, int* selectedBox, HistoryEntry* entry, int forward) {
+    suppressHistory = 1;
 
-        boxes[i].isSelected = 0;
+    if (forward) {
+        for (int i = 0; i < entry->opCount; i++) {
+            ApplyHistoryOp(boxes, boxCount, boxCapacity, &entry->ops[i], 1);
+        }
+    } else {
+        for (int i = entry->opCount - 1; i >= 0; i--) {
+            ApplyHistoryOp(boxes, boxCount, boxCapacity, &entry->ops[i], 0);
+        }
     }
 
-    *boxCount = snapshot->boxCount;
-    *selectedBox = (snapshot->selectedBox >= 0 && snapshot->selectedBox < *boxCount) ? snapshot->selectedBox : -1;
-    SelectBox(boxes, *boxCount, *selectedBox);
+    BoxId selection = forward ? entry->selectedAfter : entry->selectedBefore;
+    *selectedBox = FindBoxIndex(selection);
+    historySelection = GetBoxIdAt(*selectedBox);
+    SelectBox(*boxes, *boxCount, *selectedBox);
     ResetEditingState();
 
     suppressHistory = 0;
 }
 
-int PerformUndo(Box* boxes, int* boxCount, int* selectedBox) {
+int PerformUndo(Box** boxes, int* boxCount, int* boxCapacity, int* selectedBox) {
+    if (boxes == NULL || boxCount == NULL || boxCapacity == NULL || selectedBox == NULL) {
+        return 0;
+    }
     if (historyIndex > 0) {
+        if (!LoadSpilledHistoryEntry(historyIndex - 1)) {
+            return 0;
+        }
         historyIndex--;
-        RestoreSnapshotState(boxes, boxCount, selectedBox, historyIndex);
+        ApplyHistoryEntry(boxes, boxCount, boxCapacity, selectedBox, HistoryEntryAt(historyIndex), 0);
+        EnforceHistoryBudget();
         return 1;
     }
     return 0;
 }
 
-int PerformRedo(Box* boxes, int* boxCount, int* selectedBox) {
-    if (historyIndex >= 0 && historyIndex < historyCount - 1) {
+int PerformRedo(Box** boxes, int* boxCount, int* boxCapacity, int* selectedBox) {
+    if (boxes == NULL || boxCount == NULL || boxCapacity == NULL || selectedBox == NULL) {
+        return 0;
+    }
+    if (historyIndex < historyCount) {
+        if (!LoadSpilledHistoryEntry(historyIndex)) {
+            return 0;
+        }
+        ApplyHistoryEntry(boxes, boxCount, boxCapacity, selectedBox, HistoryEntryAt(historyIndex), 1);
         historyIndex++;
-        RestoreSnapshotState(boxes, boxCount, selectedBox, historyIndex);
+        EnforceHistoryBudget();
         return 1;
     }
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,605 @@
+#include "pixel_store.h"
+#include "job_queue.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define PIXEL_STORE_INITIAL_BUCKETS 64
+/* raylib's DecompressData caps its output buffer at 64 MB */
+#define PIXEL_STORE_MAX_COMPRESS_BYTES (64 * 1024 * 1024 - 1)
+
+struct PixelBlob {
+    unsigned long long hash;
+    int width;
+    int height;
+    int format;
+    int dataSize;
+    unsigned char* data;
+    unsigned char* compressed;
+    int compressedSize;
+    int refCount;
+    PixelBlob* next;
+    /* Async adoption: the worker hashes and deflates while the raw bytes stay
+       readable on the main thread. The blob joins the table once settled. */
+    Job* job;
+    int pending;
+    unsigned char* pendingCompressed;
+    int pendingCompressedSize;
+    int compressWhenSettled;
+    PixelBlob* pendingNext;
+    PixelBlob* alias;   /* set when the settled payload duplicated a stored blob */
+};
+
+static PixelBlob** gPixelBuckets = NULL;
+static int gPixelBucketCount = 0;
+static int gPixelBlobCount = 0;
+static size_t gPixelByteCount = 0;
+static PixelBlob* gPixelPending = NULL;
+
+static unsigned long long PixelStore_HashBytes(unsigned long long hash, const unsigned char* bytes, size_t length) {
+    /* 64-bit FNV-1a */
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned long long)bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static unsigned long long PixelStore_HashImage(const Image* image, int dataSize) {
+    int header[3] = {image->width, image->height, image->format};
+    unsigned long long hash = 14695981039346656037ULL;
+    hash = PixelStore_HashBytes(hash, (const unsigned char*)header, sizeof(header));
+    return PixelStore_HashBytes(hash, (const unsigned char*)image->data, (size_t)dataSize);
+}
+
+static int PixelStore_EnsureBuckets(void) {
+    if (gPixelBuckets != NULL && gPixelBlobCount < gPixelBucketCount) {
+        return 1;
+    }
+
+    int newCount = (gPixelBucketCount > 0) ? gPixelBucketCount * 2 : PIXEL_STORE_INITIAL_BUCKETS;
+    PixelBlob** buckets = (PixelBlob**)calloc((size_t)newCount, sizeof(PixelBlob*));
+    if (buckets == NULL) {
+        return gPixelBuckets != NULL;
+    }
+
+    for (int i = 0; i < gPixelBucketCount; i++) {
+        PixelBlob* blob = gPixelBuckets[i];
+        while (blob != NULL) {
+            PixelBlob* next = blob->next;
+            int slot = (int)(blob->hash % (unsigned long long)newCount);
+            blob->next = buckets[slot];
+            buckets[slot] = blob;
+            blob = next;
+        }
+    }
+
+    free(gPixelBuckets);
+    gPixelBuckets = buckets;
+    gPixelBucketCount = newCount;
+    return 1;
+}
+
+static void PixelStore_FreePayload(PixelBlob* blob) {
+    if (blob->data != NULL) {
+        MemFree(blob->data);
+        gPixelByteCount -= (size_t)blob->dataSize;
+        blob->data = NULL;
+    }
+    if (blob->compressed != NULL) {
+        MemFree(blob->compressed);
+        gPixelByteCount -= (size_t)blob->compressedSize;
+        blob->compressed = NULL;
+        blob->compressedSize = 0;
+    }
+}
+
+static int PixelStore_MakeResident(PixelBlob* blob) {
+    if (blob->data != NULL) {
+        return 1;
+    }
+    if (blob->compressed == NULL) {
+        return 0;
+    }
+
+    int size = 0;
+    unsigned char* data = DecompressData(blob->compressed, blob->compressedSize, &size);
+    if (data == NULL || size != blob->dataSize) {
+        if (data != NULL) {
+            MemFree(data);
+        }
+        return 0;
+    }
+
+    blob->data = data;
+    gPixelByteCount += (size_t)blob->dataSize;
+    return 1;
+}
+
+static PixelBlob* PixelStore_Find(const Image* image, int dataSize, unsigned long long hash) {
+    if (gPixelBuckets == NULL) {
+        return NULL;
+    }
+
+    PixelBlob* blob = gPixelBuckets[hash % (unsigned long long)gPixelBucketCount];
+    while (blob != NULL) {
+        if (blob->hash == hash && blob->width == image->width && blob->height == image->height &&
+            blob->format == image->format && blob->dataSize == dataSize) {
+            int wasCompressed = (blob->data == NULL);
+            if (PixelStore_MakeResident(blob)) {
+                int same = memcmp(blob->data, image->data, (size_t)dataSize) == 0;
+                if (wasCompressed) {
+                    PixelStore_Compress(blob);
+                }
+                if (same) {
+                    return blob;
+                }
+            }
+        }
+        blob = blob->next;
+    }
+    return NULL;
+}
+
+/* Looks up or inserts the payload. When ownsData is set the image buffer is either
+   adopted by the new blob or freed because an identical blob already exists. */
+static PixelBlob* PixelStore_Intern(Image image, int ownsData) {
+    if (image.data == NULL || image.width <= 0 || image.height <= 0) {
+        if (ownsData && image.data != NULL) {
+            MemFree(image.data);
+        }
+        return NULL;
+    }
+
+    int dataSize = GetPixelDataSize(image.width, image.height, image.format);
+    if (dataSize <= 0) {
+        if (ownsData) {
+            MemFree(image.data);
+        }
+        return NULL;
+    }
+
+    unsigned long long hash = PixelStore_HashImage(&image, dataSize);
+    PixelBlob* existing = PixelStore_Find(&image, dataSize, hash);
+    if (existing != NULL) {
+        existing->refCount++;
+        if (ownsData) {
+            MemFree(image.data);
+        }
+        return existing;
+    }
+
+    if (!PixelStore_EnsureBuckets()) {
+        if (ownsData) {
+            MemFree(image.data);
+        }
+        return NULL;
+    }
+
+    PixelBlob* blob = (PixelBlob*)calloc(1, sizeof(PixelBlob));
+    if (blob == NULL) {
+        if (ownsData) {
+            MemFree(image.data);
+        }
+        return NULL;
+    }
+
+    if (ownsData) {
+        blob->data = (unsigned char*)image.data;
+    } else {
+        blob->data = (unsigned char*)MemAlloc((unsigned int)dataSize);
+        if (blob->data == NULL) {
+            free(blob);
+            return NULL;
+        }
+        memcpy(blob->data, image.data, (size_t)dataSize);
+    }
+
+    blob->hash = hash;
+    blob->width = image.width;
+    blob->height = image.height;
+    blob->format = image.format;
+    blob->dataSize = dataSize;
+    blob->refCount = 1;
+
+    int slot = (int)(hash % (unsigned long long)gPixelBucketCount);
+    blob->next = gPixelBuckets[slot];
+    gPixelBuckets[slot] = blob;
+    gPixelBlobCount++;
+    gPixelByteCount += (size_t)dataSize;
+    return blob;
+}
+
+static void PixelStore_RunJob(void* userData) {
+    PixelBlob* blob = (PixelBlob*)userData;
+    Image view = {0};
+    view.data = blob->data;
+    view.width = blob->width;
+    view.height = blob->height;
+    view.format = blob->format;
+    blob->hash = PixelStore_HashImage(&view, blob->dataSize);
+
+    if (blob->dataSize <= PIXEL_STORE_MAX_COMPRESS_BYTES) {
+        int compressedSize = 0;
+        unsigned char* compressed = CompressData(blob->data, blob->dataSize, &compressedSize);
+        if (compressed != NULL && compressedSize > 0 && compressedSize < blob->dataSize) {
+            blob->pendingCompressed = compressed;
+            blob->pendingCompressedSize = compressedSize;
+        } else if (compressed != NULL) {
+            MemFree(compressed);
+        }
+    }
+}
+
+static void PixelStore_UnlinkPending(PixelBlob* blob) {
+    PixelBlob** link = &gPixelPending;
+    while (*link != NULL && *link != blob) {
+        link = &(*link)->pendingNext;
+    }
+    if (*link == blob) {
+        *link = blob->pendingNext;
+    }
+    blob->pendingNext = NULL;
+}
+
+/* Main thread only, after the job finished: dedupes against the table or
+   inserts the blob, then applies any compression requested meanwhile. */
+static void PixelStore_Settle(PixelBlob* blob) {
+    if (blob->job != NULL) {
+        JobQueue_Free(blob->job);
+        blob->job = NULL;
+    }
+    PixelStore_UnlinkPending(blob);
+    blob->pending = 0;
+
+    if (blob->refCount <= 0) {
+        if (blob->pendingCompressed != NULL) {
+            MemFree(blob->pendingCompressed);
+        }
+        PixelStore_FreePayload(blob);
+        free(blob);
+        return;
+    }
+
+    Image view = {0};
+    view.data = blob->data;
+    view.width = blob->width;
+    view.height = blob->height;
+    view.format = blob->format;
+    PixelBlob* existing = PixelStore_Find(&view, blob->dataSize, blob->hash);
+    if (existing != NULL || !PixelStore_EnsureBuckets()) {
+        if (blob->pendingCompressed != NULL) {
+            MemFree(blob->pendingCompressed);
+            blob->pendingCompressed = NULL;
+        }
+        if (existing != NULL) {
+            PixelStore_FreePayload(blob);
+            existing->refCount++;
+            blob->alias = existing;
+            if (blob->compressWhenSettled) {
+                PixelStore_Compress(existing);
+            }
+        }
+        return;
+    }
+
+    int slot = (int)(blob->hash % (unsigned long long)gPixelBucketCount);
+    blob->next = gPixelBuckets[slot];
+    gPixelBuckets[slot] = blob;
+    gPixelBlobCount++;
+
+    if (blob->pendingCompressed != NULL) {
+        blob->compressed = blob->pendingCompressed;
+        blob->compressedSize = blob->pendingCompressedSize;
+        blob->pendingCompressed = NULL;
+        gPixelByteCount += (size_t)blob->compressedSize;
+    }
+    if (blob->compressWhenSettled) {
+        PixelStore_Compress(blob);
+    }
+}
+
+/* Resolves a holder's handle to the blob that owns the payload, waiting for a
+   pending job when the caller needs the settled state. */
+static PixelBlob* PixelStore_Resolve(PixelBlob* blob, int waitForJob) {
+    if (blob == NULL) {
+        return NULL;
+    }
+    if (blob->pending) {
+        if (!waitForJob && !JobQueue_IsDone(blob->job)) {
+            return blob;
+        }
+        JobQueue_Wait(blob->job);
+        PixelStore_Settle(blob);
+    }
+    return (blob->alias != NULL) ? blob->alias : blob;
+}
+
+PixelBlob* PixelStore_AcquireImage(const Image* image) {
+    if (image == NULL) {
+        return NULL;
+    }
+    return PixelStore_Intern(*image, 0);
+}
+
+PixelBlob* PixelStore_AdoptImage(Image image) {
+    return PixelStore_Intern(image, 1);
+}
+
+/* Like PixelStore_AdoptImage, but hashing and compression run on the worker. The
+   returned handle is usable immediately; PixelStore_Update settles it later. */
+PixelBlob* PixelStore_AdoptImageAsync(Image image) {
+    if (image.data == NULL || image.width <= 0 || image.height <= 0) {
+        if (image.data != NULL) {
+            MemFree(image.data);
+        }
+        return NULL;
+    }
+
+    int dataSize = GetPixelDataSize(image.width, image.height, image.format);
+    PixelBlob* blob = (dataSize > 0) ? (PixelBlob*)calloc(1, sizeof(PixelBlob)) : NULL;
+    if (blob == NULL) {
+        MemFree(image.data);
+        return NULL;
+    }
+
+    blob->data = (unsigned char*)image.data;
+    blob->width = image.width;
+    blob->height = image.height;
+    blob->format = image.format;
+    blob->dataSize = dataSize;
+    blob->refCount = 1;
+    blob->pending = 1;
+    blob->pendingNext = gPixelPending;
+    gPixelPending = blob;
+    gPixelByteCount += (size_t)dataSize;
+
+    blob->job = JobQueue_Submit(PixelStore_RunJob, blob);
+    if (blob->job == NULL) {
+        PixelStore_Settle(blob);
+    }
+    return blob;
+}
+
+void PixelStore_Update(void) {
+    PixelBlob* blob = gPixelPending;
+    while (blob != NULL) {
+        PixelBlob* next = blob->pendingNext;
+        if (JobQueue_IsDone(blob->job)) {
+            PixelStore_Settle(blob);
+        }
+        blob = next;
+    }
+}
+
+int PixelStore_GetPendingCount(void) {
+    int count = 0;
+    for (PixelBlob* blob = gPixelPending; blob != NULL; blob = blob->pendingNext) {
+        count++;
+    }
+    return count;
+}
+
+PixelBlob* PixelStore_Retain(PixelBlob* blob) {
+    if (blob != NULL) {
+        blob->refCount++;
+    }
+    return blob;
+}
+
+void PixelStore_Release(PixelBlob* blob) {
+    if (blob == NULL) {
+        return;
+    }
+
+    blob->refCount--;
+    if (blob->refCount > 0) {
+        return;
+    }
+    if (blob->pending) {
+        /* The worker may still be reading the bytes; PixelStore_Update frees it. */
+        return;
+    }
+    if (blob->alias != NULL) {
+        PixelStore_Release(blob->alias);
+        free(blob);
+        return;
+    }
+
+    if (gPixelBucketCount > 0) {
+        PixelBlob** link = &gPixelBuckets[blob->hash % (unsigned long long)gPixelBucketCount];
+        while (*link != NULL && *link != blob) {
+            link = &(*link)->next;
+        }
+        if (*link == blob) {
+            *link = blob->next;
+            gPixelBlobCount--;
+        }
+    }
+    PixelStore_FreePayload(blob);
+    free(blob);
+}
+
+/* References held on this handle, so a holder can tell whether it alone keeps the
+   payload alive. */
+int PixelStore_GetRefCount(const PixelBlob* blob) {
+    return (blob != NULL) ? blob->refCount : 0;
+}
+
+/* Returns a view of the raw pixels, inflating a compressed blob if needed. The
+   view stays valid until the blob is compressed again or released. */
+Image PixelStore_GetImage(PixelBlob* blob) {
+    Image image = {0};
+    blob = PixelStore_Resolve(blob, 0);
+    if (blob == NULL || !PixelStore_MakeResident(blob)) {
+        return image;
+    }
+    image.data = blob->data;
+    image.width = blob->width;
+    image.height = blob->height;
+    image.mipmaps = 1;
+    image.format = blob->format;
+    return image;
+}
+
+/* Keeps only the DEFLATE copy of the pixels. Returns 0 when the payload does not
+   shrink or is too large for raylib's inflater, leaving the raw bytes resident. */
+int PixelStore_Compress(PixelBlob* blob) {
+    blob = PixelStore_Resolve(blob, 0);
+    if (blob == NULL) {
+        return 0;
+    }
+    if (blob->pending) {
+        blob->compressWhenSettled = 1;
+        return 1;
+    }
+
+    if (blob->compressed == NULL) {
+        if (blob->data == NULL || blob->dataSize > PIXEL_STORE_MAX_COMPRESS_BYTES) {
+            return 0;
+        }
+        int compressedSize = 0;
+        unsigned char* compressed = CompressData(blob->data, blob->dataSize, &compressedSize);
+        if (compressed == NULL) {
+            return 0;
+        }
+        if (compressedSize <= 0 || compressedSize >= blob->dataSize) {
+            MemFree(compressed);
+            return 0;
+        }
+        blob->compressed = compressed;
+        blob->compressedSize = compressedSize;
+        gPixelByteCount += (size_t)compressedSize;
+    }
+
+    if (blob->data != NULL) {
+        MemFree(blob->data);
+        gPixelByteCount -= (size_t)blob->dataSize;
+        blob->data = NULL;
+    }
+    return 1;
+}
+
+int PixelStore_IsCompressed(const PixelBlob* blob) {
+    if (blob != NULL && blob->alias != NULL) {
+        blob = blob->alias;
+    }
+    return (blob != NULL && blob->data == NULL && blob->compressed != NULL);
+}
+
+unsigned long long PixelStore_GetHash(PixelBlob* blob) {
+    blob = PixelStore_Resolve(blob, 1);
+    return (blob != NULL) ? blob->hash : 0ULL;
+}
+
+size_t PixelStore_GetBlobByteCount(const PixelBlob* blob) {
+    if (blob != NULL && blob->alias != NULL) {
+        blob = blob->alias;
+    }
+    if (blob == NULL) {
+        return 0;
+    }
+    size_t bytes = (blob->data != NULL) ? (size_t)blob->dataSize : 0;
+    return bytes + (size_t)blob->compressedSize;
+}
+
+/* Serialized layout: width, height, format, dataSize, payloadSize, compressed flag,
+   then the payload. The DEFLATE copy is written when one exists. */
+int PixelStore_WriteBlob(PixelBlob* blob, FILE* file) {
+    blob = PixelStore_Resolve(blob, 1);
+    if (blob == NULL || file == NULL) {
+        return 0;
+    }
+    if (blob->compressed == NULL && blob->data == NULL) {
+        return 0;
+    }
+
+    int isCompressed = (blob->compressed != NULL);
+    const unsigned char* payload = isCompressed ? blob->compressed : blob->data;
+    int header[6] = {
+        blob->width, blob->height, blob->format, blob->dataSize,
+        isCompressed ? blob->compressedSize : blob->dataSize, isCompressed
+    };
+    if (fwrite(header, sizeof(header), 1, file) != 1) {
+        return 0;
+    }
+    return fwrite(payload, 1, (size_t)header[4], file) == (size_t)header[4];
+}
+
+/* Reads a blob written by PixelStore_WriteBlob and interns it, so a payload that
+   is still referenced elsewhere comes back as the same shared blob. */
+PixelBlob* PixelStore_ReadBlob(FILE* file) {
+    if (file == NULL) {
+        return NULL;
+    }
+
+    int header[6] = {0};
+    if (fread(header, sizeof(header), 1, file) != 1 || header[3] <= 0 || header[4] <= 0) {
+        return NULL;
+    }
+
+    unsigned char* payload = (unsigned char*)MemAlloc((unsigned int)header[4]);
+    if (payload == NULL) {
+        return NULL;
+    }
+    if (fread(payload, 1, (size_t)header[4], file) != (size_t)header[4]) {
+        MemFree(payload);
+        return NULL;
+    }
+
+    Image image = {0};
+    image.width = header[0];
+    image.height = header[1];
+    image.format = header[2];
+    image.mipmaps = 1;
+    if (header[5]) {
+        int size = 0;
+        image.data = DecompressData(payload, header[4], &size);
+        MemFree(payload);
+        if (image.data == NULL || size != header[3]) {
+            if (image.data != NULL) {
+                MemFree(image.data);
+            }
+            return NULL;
+        }
+    } else {
+        image.data = payload;
+    }
+
+    PixelBlob* blob = PixelStore_Intern(image, 1);
+    if (blob != NULL && header[5] && blob->refCount == 1) {
+        PixelStore_Compress(blob);
+    }
+    return blob;
+}
+
+int PixelStore_GetBlobCount(void) {
+    return gPixelBlobCount;
+}
+
+size_t PixelStore_GetByteCount(void) {
+    return gPixelByteCount;
+}
+
+void PixelStore_Shutdown(void) {
+    while (gPixelPending != NULL) {
+        PixelBlob* blob = gPixelPending;
+        JobQueue_Wait(blob->job);
+        blob->refCount = 0;
+        PixelStore_Settle(blob);
+    }
+    for (int i = 0; i < gPixelBucketCount; i++) {
+        PixelBlob* blob = gPixelBuckets[i];
+        while (blob != NULL) {
+            PixelBlob* next = blob->next;
+            PixelStore_FreePayload(blob);
+            free(blob);
+            blob = next;
+        }
+    }
+    free(gPixelBuckets);
+    gPixelBuckets = NULL;
+    gPixelBucketCount = 0;
+    gPixelBlobCount = 0;
+    gPixelByteCount = 0;
+}
@@ -0,0 +1,33 @@
+#ifndef PIXEL_STORE_H
+#define PIXEL_STORE_H
+
+#include "raylib.h"
+#include <stddef.h>
+#include <stdio.h>
+
+/* Content-addressed, reference-counted pixel storage shared by boxes and history
+   snapshots. Identical pixel payloads are stored once; every holder owns one
+   reference. Blobs can drop their raw bytes and keep a DEFLATE copy instead. */
+
+typedef struct PixelBlob PixelBlob;
+
+PixelBlob* PixelStore_AcquireImage(const Image* image);
+PixelBlob* PixelStore_AdoptImage(Image image);
+PixelBlob* PixelStore_AdoptImageAsync(Image image);
+void PixelStore_Update(void);
+int PixelStore_GetPendingCount(void);
+PixelBlob* PixelStore_Retain(PixelBlob* blob);
+void PixelStore_Release(PixelBlob* blob);
+int PixelStore_GetRefCount(const PixelBlob* blob);
+Image PixelStore_GetImage(PixelBlob* blob);
+int PixelStore_Compress(PixelBlob* blob);
+int PixelStore_IsCompressed(const PixelBlob* blob);
+unsigned long long PixelStore_GetHash(PixelBlob* blob);
+size_t PixelStore_GetBlobByteCount(const PixelBlob* blob);
+int PixelStore_WriteBlob(PixelBlob* blob, FILE* file);
+PixelBlob* PixelStore_ReadBlob(FILE* file);
+int PixelStore_GetBlobCount(void);
+size_t PixelStore_GetByteCount(void);
+void PixelStore_Shutdown(void);
+
+#endif /* PIXEL_STORE_H */
@@ -0,0 +1,456 @@
+#include "scene.h"
+#include "scene_index.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SCENE_INITIAL_CAPACITY 64
+#define SCENE_ID_SLOT_BITS 22
+#define SCENE_ID_SLOT_MASK ((1u << SCENE_ID_SLOT_BITS) - 1u)
+#define SCENE_ID_GENERATION_MASK ((1u << (32 - SCENE_ID_SLOT_BITS)) - 1u)
+#define SCENE_DIRTY_CAPACITY 256
+/* Outlines are drawn up to this far outside a box. */
+#define SCENE_DIRTY_MARGIN 2.0f
+
+enum {
+    SCENE_SLOT_FREE = -2,
+    SCENE_SLOT_DETACHED = -1    /* box removed but kept by undo history */
+};
+
+typedef struct {
+    int index;
+    unsigned int generation;
+    int nextFree;
+    int refs;               /* history ops that refer to the id */
+} SceneSlot;
+
+static SceneSlot* gSceneSlots = NULL;
+static int gSceneSlotCount = 0;
+static int gSceneSlotCapacity = 0;
+static int gSceneFreeSlot = -1;
+
+/* Reverse map from array position to id, grown alongside the box array so
+   removals can fix up ids without touching the boxes themselves. */
+static BoxId* gSceneIdsByIndex = NULL;
+static int gSceneIdsCapacity = 0;
+
+/* Every key handed out lies between these, so front/back moves are O(1). Keys
+   are doubles so an "insert between" can later use midpoints. */
+static double gSceneFrontZ = 0.0;
+static double gSceneBackZ = 0.0;
+
+/* World units per screen pixel, so handles keep their on-screen size under the
+   canvas zoom. */
+static float gSceneHandleScale = 1.0f;
+
+/* Areas changed since the last TakeSceneDirtyRects. When the list fills up (or
+   nobody drains it) it degrades to "everything changed". */
+static SceneDirtyRect gSceneDirty[SCENE_DIRTY_CAPACITY];
+static int gSceneDirtyCount = 0;
+static int gSceneDirtyAll = 1;
+
+static SceneSlot* SceneSlotForId(BoxId id) {
+    unsigned int slot = (id & SCENE_ID_SLOT_MASK);
+    if (id == BOX_ID_NONE || slot == 0u || (int)slot > gSceneSlotCount) {
+        return NULL;
+    }
+    SceneSlot* entry = &gSceneSlots[slot - 1u];
+    if (entry->index == SCENE_SLOT_FREE || entry->generation != (id >> SCENE_ID_SLOT_BITS)) {
+        return NULL;
+    }
+    return entry;
+}
+
+static BoxId SceneAllocateId(int index) {
+    int slot = gSceneFreeSlot;
+    if (slot >= 0) {
+        gSceneFreeSlot = gSceneSlots[slot].nextFree;
+    } else {
+        if ((unsigned int)gSceneSlotCount >= SCENE_ID_SLOT_MASK) {
+            return BOX_ID_NONE;
+        }
+        if (gSceneSlotCount == gSceneSlotCapacity) {
+            int newCapacity = (gSceneSlotCapacity > 0) ? gSceneSlotCapacity * 2 : SCENE_INITIAL_CAPACITY;
+            SceneSlot* grown = (SceneSlot*)realloc(gSceneSlots, (size_t)newCapacity * sizeof(SceneSlot));
+            if (grown == NULL) {
+                return BOX_ID_NONE;
+            }
+            gSceneSlots = grown;
+            gSceneSlotCapacity = newCapacity;
+        }
+        slot = gSceneSlotCount++;
+        gSceneSlots[slot].generation = 0;
+    }
+    gSceneSlots[slot].index = index;
+    gSceneSlots[slot].nextFree = -1;
+    gSceneSlots[slot].refs = 0;
+    return (gSceneSlots[slot].generation << SCENE_ID_SLOT_BITS) | (unsigned int)(slot + 1);
+}
+
+/* Returns the slot to the free list. Bumping the generation keeps old ids from
+   resolving to whichever box reuses it. */
+static void SceneFreeSlot(SceneSlot* slot) {
+    slot->index = SCENE_SLOT_FREE;
+    slot->generation = (slot->generation + 1u) & SCENE_ID_GENERATION_MASK;
+    slot->nextFree = gSceneFreeSlot;
+    gSceneFreeSlot = (int)(slot - gSceneSlots);
+}
+
+/* A removed box's slot stays reserved only while undo history can bring it back. */
+static void SceneDetachSlot(SceneSlot* slot) {
+    if (slot->refs > 0) {
+        slot->index = SCENE_SLOT_DETACHED;
+    } else {
+        SceneFreeSlot(slot);
+    }
+}
+
+static void SceneBindIndex(BoxId id, int index) {
+    SceneSlot* slot = SceneSlotForId(id);
+    if (slot != NULL) {
+        slot->index = index;
+    }
+    gSceneIdsByIndex[index] = id;
+}
+
+/* Grows the scene array geometrically; new slots are zeroed. Pointers into the
+   array are invalidated when it moves. */
+int EnsureBoxCapacity(Box** boxes, int* boxCapacity, int required) {
+    if (boxes == NULL || boxCapacity == NULL || required < 0) {
+        return 0;
+    }
+    if (required <= *boxCapacity) {
+        return 1;
+    }
+
+    int newCapacity = (*boxCapacity > 0) ? *boxCapacity : SCENE_INITIAL_CAPACITY;
+    while (newCapacity < required) {
+        newCapacity *= 2;
+    }
+
+    if (newCapacity > gSceneIdsCapacity) {
+        BoxId* ids = (BoxId*)realloc(gSceneIdsByIndex, (size_t)newCapacity * sizeof(BoxId));
+        if (ids == NULL) {
+            return 0;
+        }
+        gSceneIdsByIndex = ids;
+        gSceneIdsCapacity = newCapacity;
+    }
+
+    Box* grown = (Box*)realloc(*boxes, (size_t)newCapacity * sizeof(Box));
+    if (grown == NULL) {
+        return 0;
+    }
+    memset(grown + *boxCapacity, 0, (size_t)(newCapacity - *boxCapacity) * sizeof(Box));
+    *boxes = grown;
+    *boxCapacity = newCapacity;
+    return 1;
+}
+
+/* Registers the box just written at boxes[*boxCount]: gives it a fresh id and
+   puts it on top. Returns its index. */
+int CommitNewBox(Box* boxes, int* boxCount) {
+    int index = *boxCount;
+    Box* box = &boxes[index];
+    box->id = SceneAllocateId(index);
+    box->zKey = (gSceneFrontZ += 1.0);
+    gSceneIdsByIndex[index] = box->id;
+    (*boxCount)++;
+    MarkBoxDirty(box);
+    return index;
+}
+
+/* Re-adds a box that undo/redo brought back, keeping its id and zKey so history
+   entries recorded against it still resolve. Returns its index or -1. */
+int RestoreBox(Box** boxes, int* boxCount, int* boxCapacity, const Box* box) {
+    if (!EnsureBoxCapacity(boxes, boxCapacity, *boxCount + 1)) {
+        return -1;
+    }
+    int index = *boxCount;
+    Box* dest = &(*boxes)[index];
+    *dest = *box;
+
+    SceneSlot* slot = SceneSlotForId(dest->id);
+    if (slot == NULL || slot->index != SCENE_SLOT_DETACHED) {
+        dest->id = SceneAllocateId(index);
+    }
+    SceneBindIndex(dest->id, index);
+    if (dest->zKey > gSceneFrontZ) {
+        gSceneFrontZ = dest->zKey;
+    }
+    if (dest->zKey < gSceneBackZ) {
+        gSceneBackZ = dest->zKey;
+    }
+    (*boxCount)++;
+    MarkBoxDirty(dest);
+    return index;
+}
+
+/* Takes boxes[index] out by moving the last box into its place. The id stays
+   reserved so undo can restore the box under it. Returns the index the moved box
+   came from, or -1 when nothing moved. */
+int RemoveBoxAt(Box* boxes, int* boxCount, int index, Box* removed) {
+    if (index < 0 || index >= *boxCount) {
+        return -1;
+    }
+
+    SceneSlot* slot = SceneSlotForId(gSceneIdsByIndex[index]);
+    if (slot != NULL) {
+        SceneDetachSlot(slot);
+    }
+    if (removed != NULL) {
+        *removed = boxes[index];
+    }
+    MarkBoxDirty(&boxes[index]);
+
+    int last = *boxCount - 1;
+    int movedFrom = -1;
+    if (index != last) {
+        boxes[index] = boxes[last];
+        SceneBindIndex(gSceneIdsByIndex[last], index);
+        movedFrom = last;
+    }
+    boxes[last] = (Box){0};
+    gSceneIdsByIndex[last] = BOX_ID_NONE;
+    (*boxCount)--;
+    SceneIndex_Remove(boxes, *boxCount, index);
+    return movedFrom;
+}
+
+void RemoveAllBoxes(Box* boxes, int* boxCount) {
+    for (int i = 0; i < *boxCount; i++) {
+        SceneSlot* slot = SceneSlotForId(gSceneIdsByIndex[i]);
+        if (slot != NULL) {
+            SceneDetachSlot(slot);
+        }
+        gSceneIdsByIndex[i] = BOX_ID_NONE;
+        boxes[i] = (Box){0};
+    }
+    *boxCount = 0;
+    SceneIndex_Clear();
+    MarkSceneDirty();
+}
+
+int FindBoxIndex(BoxId id) {
+    SceneSlot* slot = SceneSlotForId(id);
+    return (slot != NULL && slot->index >= 0) ? slot->index : -1;
+}
+
+BoxId GetBoxIdAt(int index) {
+    return (index >= 0 && index < gSceneIdsCapacity) ? gSceneIdsByIndex[index] : BOX_ID_NONE;
+}
+
+/* History ops hold a reference to the id they were recorded against. When the
+   last one is released, a removed box's slot is recycled. */
+void RetainBoxId(BoxId id) {
+    SceneSlot* slot = SceneSlotForId(id);
+    if (slot != NULL) {
+        slot->refs++;
+    }
+}
+
+void ReleaseBoxId(BoxId id) {
+    SceneSlot* slot = SceneSlotForId(id);
+    if (slot == NULL || slot->refs <= 0) {
+        return;
+    }
+    slot->refs--;
+    if (slot->refs == 0 && slot->index == SCENE_SLOT_DETACHED) {
+        SceneFreeSlot(slot);
+    }
+}
+
+void FreeBoxIds(void) {
+    free(gSceneSlots);
+    free(gSceneIdsByIndex);
+    gSceneSlots = NULL;
+    gSceneSlotCount = 0;
+    gSceneSlotCapacity = 0;
+    gSceneFreeSlot = -1;
+    gSceneIdsByIndex = NULL;
+    gSceneIdsCapacity = 0;
+}
+
+/* Reordering only rewrites the key; nothing in the array moves. Returns 1 when
+   the key changed. */
+int BringBoxToFront(Box* box) {
+    if (box == NULL || box->zKey >= gSceneFrontZ) {
+        return 0;
+    }
+    box->zKey = (gSceneFrontZ += 1.0);
+    MarkBoxDirty(box);
+    return 1;
+}
+
+int SendBoxToBack(Box* box) {
+    if (box == NULL || box->zKey <= gSceneBackZ) {
+        return 0;
+    }
+    box->zKey = (gSceneBackZ -= 1.0);
+    MarkBoxDirty(box);
+    return 1;
+}
+
+BoxMedia* EnsureBoxMedia(Box* box) {
+    if (box == NULL) {
+        return NULL;
+    }
+    if (box->media == NULL) {
+        box->media = (BoxMedia*)calloc(1, sizeof(BoxMedia));
+    }
+    return box->media;
+}
+
+/* Frees the side record only; unloading the music stream is the caller's job. */
+void FreeBoxMedia(Box* box) {
+    if (box == NULL || box->media == NULL) {
+        return;
+    }
+    free(box->media);
+    box->media = NULL;
+}
+
+Rectangle GetBoxRect(const Box* box) {
+    Rectangle rect = {(float)box->x, (float)box->y, (float)box->width, (float)box->height};
+    return rect;
+}
+
+void SetSceneHandleScale(float scale) {
+    gSceneHandleScale = (scale > 0.0f) ? scale : 1.0f;
+}
+
+float GetSceneHandleScale(void) {
+    return gSceneHandleScale;
+}
+
+float GetSceneHitReach(void) {
+    return SCENE_HIT_REACH * gSceneHandleScale;
+}
+
+/* Records the box's current area as changed. Geometry changes need a call before
+   and after, so both the old and the new area are redrawn. */
+void MarkBoxDirty(const Box* box) {
+    if (box == NULL || gSceneDirtyAll) {
+        return;
+    }
+    if (gSceneDirtyCount == SCENE_DIRTY_CAPACITY) {
+        MarkSceneDirty();
+        return;
+    }
+    SceneDirtyRect* dirty = &gSceneDirty[gSceneDirtyCount++];
+    dirty->id = box->id;
+    dirty->bounds = (Rectangle){
+        (float)box->x - SCENE_DIRTY_MARGIN,
+        (float)box->y - SCENE_DIRTY_MARGIN,
+        (float)box->width + 2.0f * SCENE_DIRTY_MARGIN,
+        (float)box->height + 2.0f * SCENE_DIRTY_MARGIN
+    };
+}
+
+void MarkSceneDirty(void) {
+    gSceneDirtyAll = 1;
+    gSceneDirtyCount = 0;
+}
+
+/* Hands out the areas changed since the previous call and starts a new list.
+   Returns -1 when everything has to be considered changed. */
+int TakeSceneDirtyRects(const SceneDirtyRect** rects) {
+    int count = gSceneDirtyAll ? -1 : gSceneDirtyCount;
+    *rects = gSceneDirty;
+    gSceneDirtyAll = 0;
+    gSceneDirtyCount = 0;
+    return count;
+}
+
+void SelectBox(Box* boxes, int boxCount, int index) {
+    for (int i = 0; i < boxCount; i++) {
+        boxes[i].isSelected = (i == index) ? 1 : 0;
+    }
+}
+
+ResizeMode GetResizeModeForPoint(const Box* box, Vector2 point) {
+    return GetResizeModeForRect(GetBoxRect(box), point);
+}
+
+ResizeMode GetResizeModeForRect(Rectangle rect, Vector2 point) {
+    float x = rect.x;
+    float y = rect.y;
+    float w = rect.width;
+    float h = rect.height;
+    float handleSize = SCENE_HANDLE_SIZE * gSceneHandleScale;
+
+    Vector2 handleCenters[] = {
+        {x, y},
+        {x + w / 2.0f, y},
+        {x + w, y},
+        {x + w, y + h / 2.0f},
+        {x + w, y + h},
+        {x + w / 2.0f, y + h},
+        {x, y + h},
+        {x, y + h / 2.0f}
+    };
+
+    ResizeMode handleModes[] = {
+        RESIZE_TOP_LEFT,
+        RESIZE_TOP,
+        RESIZE_TOP_RIGHT,
+        RESIZE_RIGHT,
+        RESIZE_BOTTOM_RIGHT,
+        RESIZE_BOTTOM,
+        RESIZE_BOTTOM_LEFT,
+        RESIZE_LEFT
+    };
+
+    for (int i = 0; i < 8; i++) {
+        Rectangle handleRect = {
+            handleCenters[i].x - handleSize / 2.0f,
+            handleCenters[i].y - handleSize / 2.0f,
+            handleSize,
+            handleSize
+        };
+
+        if (CheckCollisionPointRec(point, handleRect)) {
+            return handleModes[i];
+        }
+    }
+
+    const float margin = SCENE_EDGE_MARGIN * gSceneHandleScale;
+    if (point.x >= x - margin && point.x <= x + margin && point.y > y + margin && point.y < y + h - margin) {
+        return RESIZE_LEFT;
+    }
+    if (point.x >= x + w - margin && point.x <= x + w + margin && point.y > y + margin && point.y < y + h - margin) {
+        return RESIZE_RIGHT;
+    }
+    if (point.y >= y - margin && point.y <= y + margin && point.x > x + margin && point.x < x + w - margin) {
+        return RESIZE_TOP;
+    }
+    if (point.y >= y + h - margin && point.y <= y + h + margin && point.x > x + margin && point.x < x + w - margin) {
+        return RESIZE_BOTTOM;
+    }
+
+    return RESIZE_NONE;
+}
+
+/* True when point is inside the box or on one of its handles/edge zones. Anything
+   beyond the hit reach is rejected before building handle rects. */
+int IsPointOnBox(const Box* box, Vector2 point) {
+    const float reach = GetSceneHitReach();
+    if (point.x < (float)box->x - reach || point.x > (float)(box->x + box->width) + reach ||
+        point.y < (float)box->y - reach || point.y > (float)(box->y + box->height) + reach) {
+        return 0;
+    }
+    if (GetResizeModeForPoint(box, point) != RESIZE_NONE) {
+        return 1;
+    }
+    return CheckCollisionPointRec(point, GetBoxRect(box));
+}
+
+int FindTopmostBoxAtPoint(Vector2 point, Box* boxes, int boxCount) {
+    int best = -1;
+    for (int i = 0; i < boxCount; i++) {
+        if ((best < 0 || boxes[i].zKey > boxes[best].zKey) && IsPointOnBox(&boxes[i], point)) {
+            best = i;
+        }
+    }
+    return best;
+}
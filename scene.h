@@ -0,0 +1,142 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include "raylib.h"
+#include "pixel_store.h"
+#include "drawing_shape.h"
+#include "text_layout.h"
+#include "win_video.h"
+
+/* Box storage shared by the canvas and the scene benchmark. A Box holds only
+   what hit testing and drawing read every frame; audio/video playback state and
+   diagnostics live in a separately allocated BoxMedia side record.
+
+   Array position is storage only: boxes are appended on creation and removed by
+   moving the last box into the hole. Stacking comes from each box's zKey, and
+   anything that has to survive those moves (history, selection records) refers
+   to a box by its BoxId. */
+
+#define SCENE_HANDLE_SIZE 10.0f
+#define SCENE_EDGE_MARGIN 6.0f
+/* How far outside a box its resize handles and edge zones can be hit, before
+   the handle scale is applied. */
+#define SCENE_HIT_REACH ((SCENE_HANDLE_SIZE / 2.0f > SCENE_EDGE_MARGIN) ? SCENE_HANDLE_SIZE / 2.0f : SCENE_EDGE_MARGIN)
+
+/* Generational handle: slot number in the low bits, reuse count in the high bits,
+   so a stale id never resolves to a box that later took over its slot. */
+typedef unsigned int BoxId;
+#define BOX_ID_NONE 0u
+
+typedef enum {
+    BOX_IMAGE,
+    BOX_TEXT,
+    BOX_VIDEO,
+    BOX_AUDIO,
+    BOX_DRAWING
+} BoxType;
+
+typedef enum {
+    RESIZE_NONE,
+    RESIZE_LEFT,
+    RESIZE_RIGHT,
+    RESIZE_TOP,
+    RESIZE_BOTTOM,
+    RESIZE_TOP_LEFT,
+    RESIZE_TOP_RIGHT,
+    RESIZE_BOTTOM_LEFT,
+    RESIZE_BOTTOM_RIGHT
+} ResizeMode;
+
+typedef struct {
+    Music music;
+    int videoDecodedFrames;
+    int videoFallbackFrames;
+    int videoReportedDecoded;
+    int videoReportedFallback;
+    float videoConvertAvgUs;
+    float videoConvertPeakUs;
+    float videoConvertLastUs;
+    unsigned int videoConvertSamples;
+    char videoFormatLabel[8];
+    float videoPositionSeconds;
+    float videoDurationSeconds;
+    int videoLoop;
+    int audioLoop;
+    int audioStreamStarted;
+    int audioWasPlaying;
+    float audioTimePlayed;
+    float audioDurationSeconds;
+} BoxMedia;
+
+/* Rendered BOX_TEXT content, reused until the text, font size, color, box size
+   or display scale it was rendered for changes. */
+typedef struct {
+    RenderTexture2D target;
+    int stale;              /* text replaced since it was rendered */
+    int width;
+    int height;
+    int fontSize;
+    Color color;
+    float scale;            /* texture pixels per world unit */
+    unsigned int usedFrame;
+} BoxTextRaster;
+
+typedef struct {
+    int x;
+    int y;
+    int width;
+    int height;
+    BoxType type;
+    int isSelected;
+    BoxId id;
+    double zKey;            /* stacking order, higher draws on top */
+    union {
+        Texture2D texture;      /* BOX_IMAGE */
+        DrawingShape* shape;    /* BOX_DRAWING */
+        char* text;
+        WinVideoPlayer* video;
+    } content;
+    PixelBlob* pixels;      /* CPU-side source for BOX_IMAGE textures */
+    BoxMedia* media;        /* BOX_AUDIO/BOX_VIDEO only */
+    TextLines* lines;       /* BOX_TEXT only: line index of content.text */
+    BoxTextRaster* raster;  /* BOX_TEXT only, created when first visible */
+    char* filePath;
+    int fontSize;
+    int wrapWidth;          /* BOX_TEXT: width lines wrap at, 0 to fit the longest line */
+    Color textColor;
+} Box;
+
+/* Area a box covered when its appearance changed, for caches of rendered content. */
+typedef struct {
+    BoxId id;
+    Rectangle bounds;
+} SceneDirtyRect;
+
+int EnsureBoxCapacity(Box** boxes, int* boxCapacity, int required);
+int CommitNewBox(Box* boxes, int* boxCount);
+int RestoreBox(Box** boxes, int* boxCount, int* boxCapacity, const Box* box);
+int RemoveBoxAt(Box* boxes, int* boxCount, int index, Box* removed);
+void RemoveAllBoxes(Box* boxes, int* boxCount);
+int FindBoxIndex(BoxId id);
+BoxId GetBoxIdAt(int index);
+void RetainBoxId(BoxId id);
+void ReleaseBoxId(BoxId id);
+void FreeBoxIds(void);
+int BringBoxToFront(Box* box);
+int SendBoxToBack(Box* box);
+BoxMedia* EnsureBoxMedia(Box* box);
+void FreeBoxMedia(Box* box);
+Rectangle GetBoxRect(const Box* box);
+void SetSceneHandleScale(float scale);
+float GetSceneHandleScale(void);
+float GetSceneHitReach(void);
+void MarkBoxDirty(const Box* box);
+void MarkSceneDirty(void);
+int TakeSceneDirtyRects(const SceneDirtyRect** rects);
+void SelectBox(Box* boxes, int boxCount, int index);
+ResizeMode GetResizeModeForPoint(const Box* box, Vector2 point);
+ResizeMode GetResizeModeForRect(Rectangle rect, Vector2 point);
+int IsPointOnBox(const Box* box, Vector2 point);
+int FindTopmostBoxAtPoint(Vector2 point, Box* boxes, int boxCount);
+
+#endif /* SCENE_H */
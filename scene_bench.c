@@ -0,0 +1,233 @@
+#include "raylib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "scene.h"
+#include "scene_index.h"
+
+/* Measures the per-frame CPU passes over the scene (hit testing and the draw
+   traversal) at a large box count, against the previous all-in-one Box layout
+   and against the grid index. */
+
+#define BENCH_DEFAULT_BOXES 10000
+#define BENCH_HIT_QUERIES 20000
+#define BENCH_DRAW_PASSES 2000
+#define BENCH_DRAG_STEPS 20000
+
+/* Layout of Box before hot/cold splitting, kept here for comparison only. */
+typedef struct {
+    int x;
+    int y;
+    int width;
+    int height;
+    BoxType type;
+    union {
+        Texture2D texture;
+        char* text;
+        Music music;
+        WinVideoPlayer* video;
+    } content;
+    PixelBlob* pixels;
+    char* filePath;
+    int fontSize;
+    Color textColor;
+    int isSelected;
+    int videoDecodedFrames;
+    int videoFallbackFrames;
+    int videoReportedDecoded;
+    int videoReportedFallback;
+    float videoConvertAvgUs;
+    float videoConvertPeakUs;
+    float videoConvertLastUs;
+    unsigned int videoConvertSamples;
+    char videoFormatLabel[8];
+    float videoPositionSeconds;
+    float videoDurationSeconds;
+    int videoLoop;
+    int audioLoop;
+    int audioStreamStarted;
+    int audioWasPlaying;
+    float audioTimePlayed;
+    float audioDurationSeconds;
+} LegacyBox;
+
+static double ElapsedMs(clock_t start) {
+    return (double)(clock() - start) * 1000.0 / (double)CLOCKS_PER_SEC;
+}
+
+static int LegacyFindTopmostBoxAtPoint(Vector2 point, const LegacyBox* boxes, int boxCount) {
+    for (int i = boxCount - 1; i >= 0; i--) {
+        Rectangle rect = {(float)boxes[i].x, (float)boxes[i].y, (float)boxes[i].width, (float)boxes[i].height};
+        if (GetResizeModeForRect(rect, point) != RESIZE_NONE) {
+            return i;
+        }
+        if (CheckCollisionPointRec(point, rect)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* The CPU side of the render loop: cull against the view, then dispatch on type. */
+static long long DrawTraversal(const Box* boxes, int boxCount, Rectangle view) {
+    long long visited = 0;
+    for (int i = 0; i < boxCount; i++) {
+        const Box* box = &boxes[i];
+        if ((float)(box->x + box->width) < view.x || (float)box->x > view.x + view.width ||
+            (float)(box->y + box->height) < view.y || (float)box->y > view.y + view.height) {
+            continue;
+        }
+        visited += (long long)box->type + box->isSelected + 1;
+    }
+    return visited;
+}
+
+static long long LegacyDrawTraversal(const LegacyBox* boxes, int boxCount, Rectangle view) {
+    long long visited = 0;
+    for (int i = 0; i < boxCount; i++) {
+        const LegacyBox* box = &boxes[i];
+        if ((float)(box->x + box->width) < view.x || (float)box->x > view.x + view.width ||
+            (float)(box->y + box->height) < view.y || (float)box->y > view.y + view.height) {
+            continue;
+        }
+        visited += (long long)box->type + box->isSelected + 1;
+    }
+    return visited;
+}
+
+int main(int argc, char** argv) {
+    int boxCount = (argc > 1) ? atoi(argv[1]) : BENCH_DEFAULT_BOXES;
+    if (boxCount <= 0) {
+        boxCount = BENCH_DEFAULT_BOXES;
+    }
+
+    Box* boxes = NULL;
+    int boxCapacity = 0;
+    LegacyBox* legacy = (LegacyBox*)calloc((size_t)boxCount, sizeof(LegacyBox));
+    if (legacy == NULL || !EnsureBoxCapacity(&boxes, &boxCapacity, boxCount)) {
+        fprintf(stderr, "Out of memory for %d boxes\n", boxCount);
+        free(legacy);
+        free(boxes);
+        return EXIT_FAILURE;
+    }
+
+    srand(1234);
+    const int worldSize = 20000;
+    for (int i = 0; i < boxCount; i++) {
+        Box* box = &boxes[i];
+        box->x = rand() % worldSize;
+        box->y = rand() % worldSize;
+        box->width = 40 + rand() % 200;
+        box->height = 30 + rand() % 150;
+        box->type = (BoxType)(rand() % 5);
+        box->zKey = (double)i;
+
+        LegacyBox* old = &legacy[i];
+        old->x = box->x;
+        old->y = box->y;
+        old->width = box->width;
+        old->height = box->height;
+        old->type = box->type;
+    }
+
+    Vector2* queries = (Vector2*)malloc(sizeof(Vector2) * BENCH_HIT_QUERIES);
+    if (queries == NULL) {
+        free(legacy);
+        free(boxes);
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < BENCH_HIT_QUERIES; i++) {
+        queries[i] = (Vector2){(float)(rand() % worldSize), (float)(rand() % worldSize)};
+    }
+    Rectangle view = {0.0f, 0.0f, 1920.0f, 1080.0f};
+
+    long long hits = 0;
+    clock_t start = clock();
+    for (int i = 0; i < BENCH_HIT_QUERIES; i++) {
+        hits += FindTopmostBoxAtPoint(queries[i], boxes, boxCount);
+    }
+    double hitMs = ElapsedMs(start);
+
+    long long legacyHits = 0;
+    start = clock();
+    for (int i = 0; i < BENCH_HIT_QUERIES; i++) {
+        legacyHits += LegacyFindTopmostBoxAtPoint(queries[i], legacy, boxCount);
+    }
+    double legacyHitMs = ElapsedMs(start);
+
+    start = clock();
+    SceneIndex_Rebuild(boxes, boxCount);
+    double buildMs = ElapsedMs(start);
+
+    long long indexedHits = 0;
+    start = clock();
+    for (int i = 0; i < BENCH_HIT_QUERIES; i++) {
+        indexedHits += SceneIndex_FindTopmostAtPoint(queries[i], boxes, boxCount);
+    }
+    double indexedHitMs = ElapsedMs(start);
+
+    long long visited = 0;
+    start = clock();
+    for (int pass = 0; pass < BENCH_DRAW_PASSES; pass++) {
+        visited += DrawTraversal(boxes, boxCount, view);
+    }
+    double drawMs = ElapsedMs(start);
+
+    long long legacyVisited = 0;
+    start = clock();
+    for (int pass = 0; pass < BENCH_DRAW_PASSES; pass++) {
+        legacyVisited += LegacyDrawTraversal(legacy, boxCount, view);
+    }
+    double legacyDrawMs = ElapsedMs(start);
+
+    long long indexedVisited = 0;
+    start = clock();
+    for (int pass = 0; pass < BENCH_DRAW_PASSES; pass++) {
+        const int* indices = NULL;
+        int count = SceneIndex_QueryRect(view, boxes, boxCount, &indices);
+        for (int i = 0; i < count; i++) {
+            indexedVisited += (long long)boxes[indices[i]].type + boxes[indices[i]].isSelected + 1;
+        }
+    }
+    double indexedDrawMs = ElapsedMs(start);
+
+    /* Drag random boxes around and check the incrementally maintained index
+       still agrees with a linear scan. */
+    int dragMismatches = 0;
+    start = clock();
+    for (int step = 0; step < BENCH_DRAG_STEPS; step++) {
+        int index = rand() % boxCount;
+        boxes[index].x += rand() % 41 - 20;
+        boxes[index].y += rand() % 41 - 20;
+        SceneIndex_Update(boxes, index);
+    }
+    double dragMs = ElapsedMs(start);
+    for (int i = 0; i < BENCH_HIT_QUERIES; i++) {
+        if (SceneIndex_FindTopmostAtPoint(queries[i], boxes, boxCount) != FindTopmostBoxAtPoint(queries[i], boxes, boxCount)) {
+            dragMismatches++;
+        }
+    }
+
+    printf("Scene benchmark (%d boxes)\n", boxCount);
+    printf("  Box size: %d bytes (previous layout: %d bytes)\n", (int)sizeof(Box), (int)sizeof(LegacyBox));
+    printf("  Hit test: %.2f us/query (previous layout: %.2f us/query)\n",
+           hitMs * 1000.0 / BENCH_HIT_QUERIES, legacyHitMs * 1000.0 / BENCH_HIT_QUERIES);
+    printf("  Draw traversal: %.2f us/frame (previous layout: %.2f us/frame)\n",
+           drawMs * 1000.0 / BENCH_DRAW_PASSES, legacyDrawMs * 1000.0 / BENCH_DRAW_PASSES);
+    printf("  Grid index: build %.2f ms, hit test %.2f us/query, view query %.2f us/frame, move %.3f us/update\n",
+           buildMs, indexedHitMs * 1000.0 / BENCH_HIT_QUERIES, indexedDrawMs * 1000.0 / BENCH_DRAW_PASSES,
+           dragMs * 1000.0 / BENCH_DRAG_STEPS);
+    if (hits != legacyHits || visited != legacyVisited) {
+        printf("  WARNING: layouts disagree (hits %lld vs %lld, visited %lld vs %lld)\n", hits, legacyHits, visited, legacyVisited);
+    }
+    if (indexedHits != hits || indexedVisited != visited || dragMismatches != 0) {
+        printf("  WARNING: grid index disagrees (hits %lld vs %lld, visited %lld vs %lld, %d mismatches after moves)\n",
+               indexedHits, hits, indexedVisited, visited, dragMismatches);
+    }
+
+    SceneIndex_Shutdown();
+    free(queries);
+    free(legacy);
+    free(boxes);
+    return EXIT_SUCCESS;
+}
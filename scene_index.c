@@ -0,0 +1,426 @@
+#include "scene_index.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SCENE_INDEX_CELL_SIZE 256.0f
+#define SCENE_INDEX_INITIAL_CELLS 256
+/* Boxes covering more cells than this go on a short list checked by every query
+   instead of being copied into each cell. */
+#define SCENE_INDEX_MAX_CELLS_PER_BOX 64
+
+typedef struct {
+    int cx;
+    int cy;
+    int used;
+    int count;
+    int capacity;
+    int* items;
+} SceneIndexCell;
+
+typedef struct {
+    int cx0;
+    int cy0;
+    int cx1;
+    int cy1;
+    int large;
+    unsigned int stamp;     /* last rect query that reported this box */
+} SceneIndexEntry;
+
+/* Open-addressed cell table; cells are created on demand and never removed, so
+   probing needs no tombstones. */
+static SceneIndexCell* gSceneIndexCells = NULL;
+static int gSceneIndexCellCapacity = 0;
+static int gSceneIndexCellUsed = 0;
+
+/* One entry per indexed box, parallel to the scene array. Only the leading
+   gSceneIndexCount boxes are indexed; the rest are appended on the next query. */
+static SceneIndexEntry* gSceneIndexEntries = NULL;
+static int gSceneIndexEntryCapacity = 0;
+static int gSceneIndexCount = 0;
+
+static int* gSceneIndexLarge = NULL;
+static int gSceneIndexLargeCount = 0;
+static int gSceneIndexLargeCapacity = 0;
+
+static int* gSceneIndexResults = NULL;
+static int gSceneIndexResultCapacity = 0;
+static unsigned int gSceneIndexStamp = 0;
+
+static int SceneIndex_GrowInts(int** items, int* capacity, int required) {
+    if (required <= *capacity) {
+        return 1;
+    }
+    int newCapacity = (*capacity > 0) ? *capacity : 8;
+    while (newCapacity < required) {
+        newCapacity *= 2;
+    }
+    int* grown = (int*)realloc(*items, (size_t)newCapacity * sizeof(int));
+    if (grown == NULL) {
+        return 0;
+    }
+    *items = grown;
+    *capacity = newCapacity;
+    return 1;
+}
+
+static void SceneIndex_RemoveInt(int* items, int* count, int value) {
+    for (int i = 0; i < *count; i++) {
+        if (items[i] == value) {
+            items[i] = items[*count - 1];
+            (*count)--;
+            return;
+        }
+    }
+}
+
+static int SceneIndex_CellCoord(float value) {
+    return (int)floorf(value / SCENE_INDEX_CELL_SIZE);
+}
+
+static unsigned int SceneIndex_HashCell(int cx, int cy) {
+    return ((unsigned int)cx * 73856093u) ^ ((unsigned int)cy * 19349663u);
+}
+
+static SceneIndexCell* SceneIndex_ProbeCell(SceneIndexCell* cells, int capacity, int cx, int cy) {
+    unsigned int mask = (unsigned int)capacity - 1u;
+    unsigned int slot = SceneIndex_HashCell(cx, cy) & mask;
+    while (cells[slot].used && (cells[slot].cx != cx || cells[slot].cy != cy)) {
+        slot = (slot + 1u) & mask;
+    }
+    return &cells[slot];
+}
+
+static int SceneIndex_GrowCells(void) {
+    int newCapacity = (gSceneIndexCellCapacity > 0) ? gSceneIndexCellCapacity * 2 : SCENE_INDEX_INITIAL_CELLS;
+    SceneIndexCell* cells = (SceneIndexCell*)calloc((size_t)newCapacity, sizeof(SceneIndexCell));
+    if (cells == NULL) {
+        return 0;
+    }
+    for (int i = 0; i < gSceneIndexCellCapacity; i++) {
+        if (gSceneIndexCells[i].used) {
+            *SceneIndex_ProbeCell(cells, newCapacity, gSceneIndexCells[i].cx, gSceneIndexCells[i].cy) = gSceneIndexCells[i];
+        }
+    }
+    free(gSceneIndexCells);
+    gSceneIndexCells = cells;
+    gSceneIndexCellCapacity = newCapacity;
+    return 1;
+}
+
+static SceneIndexCell* SceneIndex_FindCell(int cx, int cy, int create) {
+    if (gSceneIndexCellCapacity == 0) {
+        if (!create || !SceneIndex_GrowCells()) {
+            return NULL;
+        }
+    }
+    SceneIndexCell* cell = SceneIndex_ProbeCell(gSceneIndexCells, gSceneIndexCellCapacity, cx, cy);
+    if (cell->used) {
+        return cell;
+    }
+    if (!create) {
+        return NULL;
+    }
+    if ((gSceneIndexCellUsed + 1) * 10 > gSceneIndexCellCapacity * 7) {
+        if (!SceneIndex_GrowCells()) {
+            return NULL;
+        }
+        cell = SceneIndex_ProbeCell(gSceneIndexCells, gSceneIndexCellCapacity, cx, cy);
+    }
+    cell->cx = cx;
+    cell->cy = cy;
+    cell->used = 1;
+    gSceneIndexCellUsed++;
+    return cell;
+}
+
+/* Boxes are indexed by their plain bounds; the hit reach depends on the zoom, so
+   point queries widen the point by it instead. */
+static SceneIndexEntry SceneIndex_ComputeEntry(const Box* box) {
+    SceneIndexEntry entry = {0};
+    entry.cx0 = SceneIndex_CellCoord((float)box->x);
+    entry.cy0 = SceneIndex_CellCoord((float)box->y);
+    entry.cx1 = SceneIndex_CellCoord((float)(box->x + box->width));
+    entry.cy1 = SceneIndex_CellCoord((float)(box->y + box->height));
+    long long cells = (long long)(entry.cx1 - entry.cx0 + 1) * (long long)(entry.cy1 - entry.cy0 + 1);
+    entry.large = (cells > SCENE_INDEX_MAX_CELLS_PER_BOX) ? 1 : 0;
+    return entry;
+}
+
+static void SceneIndex_Unlink(int index) {
+    const SceneIndexEntry* entry = &gSceneIndexEntries[index];
+    if (entry->large) {
+        SceneIndex_RemoveInt(gSceneIndexLarge, &gSceneIndexLargeCount, index);
+        return;
+    }
+    for (int cy = entry->cy0; cy <= entry->cy1; cy++) {
+        for (int cx = entry->cx0; cx <= entry->cx1; cx++) {
+            SceneIndexCell* cell = SceneIndex_FindCell(cx, cy, 0);
+            if (cell != NULL) {
+                SceneIndex_RemoveInt(cell->items, &cell->count, index);
+            }
+        }
+    }
+}
+
+static int SceneIndex_Link(int index) {
+    const SceneIndexEntry* entry = &gSceneIndexEntries[index];
+    if (entry->large) {
+        if (!SceneIndex_GrowInts(&gSceneIndexLarge, &gSceneIndexLargeCapacity, gSceneIndexLargeCount + 1)) {
+            return 0;
+        }
+        gSceneIndexLarge[gSceneIndexLargeCount++] = index;
+        return 1;
+    }
+    for (int cy = entry->cy0; cy <= entry->cy1; cy++) {
+        for (int cx = entry->cx0; cx <= entry->cx1; cx++) {
+            SceneIndexCell* cell = SceneIndex_FindCell(cx, cy, 1);
+            if (cell == NULL || !SceneIndex_GrowInts(&cell->items, &cell->capacity, cell->count + 1)) {
+                return 0;
+            }
+            cell->items[cell->count++] = index;
+        }
+    }
+    return 1;
+}
+
+static int SceneIndex_EnsureEntries(int required) {
+    if (required <= gSceneIndexEntryCapacity) {
+        return 1;
+    }
+    int newCapacity = (gSceneIndexEntryCapacity > 0) ? gSceneIndexEntryCapacity : 64;
+    while (newCapacity < required) {
+        newCapacity *= 2;
+    }
+    SceneIndexEntry* grown = (SceneIndexEntry*)realloc(gSceneIndexEntries, (size_t)newCapacity * sizeof(SceneIndexEntry));
+    if (grown == NULL) {
+        return 0;
+    }
+    gSceneIndexEntries = grown;
+    gSceneIndexEntryCapacity = newCapacity;
+    return 1;
+}
+
+/* Indexes boxes appended since the last query. If the array shrank without being
+   reported, or an allocation failed earlier, everything is re-indexed. */
+static void SceneIndex_Sync(const Box* boxes, int boxCount) {
+    if (boxCount < gSceneIndexCount) {
+        SceneIndex_Clear();
+    }
+    if (boxCount == gSceneIndexCount || !SceneIndex_EnsureEntries(boxCount)) {
+        return;
+    }
+    while (gSceneIndexCount < boxCount) {
+        int index = gSceneIndexCount;
+        gSceneIndexEntries[index] = SceneIndex_ComputeEntry(&boxes[index]);
+        gSceneIndexEntries[index].stamp = gSceneIndexStamp;
+        if (!SceneIndex_Link(index)) {
+            SceneIndex_Clear();
+            return;
+        }
+        gSceneIndexCount++;
+    }
+}
+
+/* Called after RemoveBoxAt: the box at index is gone and, unless it was the
+   last one, the box formerly at boxCount now sits in its place. */
+void SceneIndex_Remove(const Box* boxes, int boxCount, int index) {
+    if (index < 0 || index >= gSceneIndexCount) {
+        return;
+    }
+    SceneIndex_Unlink(index);
+    if (boxCount < gSceneIndexCount) {
+        if (index != boxCount) {
+            SceneIndex_Unlink(boxCount);
+            gSceneIndexEntries[index] = gSceneIndexEntries[boxCount];
+            if (!SceneIndex_Link(index)) {
+                SceneIndex_Clear();
+                return;
+            }
+        }
+        gSceneIndexCount--;
+    } else {
+        /* The moved box came from the unindexed tail. */
+        gSceneIndexEntries[index] = SceneIndex_ComputeEntry(&boxes[index]);
+        gSceneIndexEntries[index].stamp = gSceneIndexStamp;
+        if (!SceneIndex_Link(index)) {
+            SceneIndex_Clear();
+        }
+    }
+}
+
+void SceneIndex_Update(const Box* boxes, int index) {
+    if (index < 0 || index >= gSceneIndexCount) {
+        return;
+    }
+    SceneIndexEntry entry = SceneIndex_ComputeEntry(&boxes[index]);
+    SceneIndexEntry* current = &gSceneIndexEntries[index];
+    if (entry.cx0 == current->cx0 && entry.cy0 == current->cy0 && entry.cx1 == current->cx1 &&
+        entry.cy1 == current->cy1 && entry.large == current->large) {
+        return;
+    }
+    SceneIndex_Unlink(index);
+    entry.stamp = current->stamp;
+    *current = entry;
+    if (!SceneIndex_Link(index)) {
+        SceneIndex_Clear();
+    }
+}
+
+void SceneIndex_Rebuild(const Box* boxes, int boxCount) {
+    SceneIndex_Clear();
+    SceneIndex_Sync(boxes, boxCount);
+}
+
+/* Empties the index but keeps its allocations for reuse. */
+void SceneIndex_Clear(void) {
+    for (int i = 0; i < gSceneIndexCellCapacity; i++) {
+        gSceneIndexCells[i].count = 0;
+    }
+    gSceneIndexLargeCount = 0;
+    gSceneIndexCount = 0;
+}
+
+void SceneIndex_Shutdown(void) {
+    for (int i = 0; i < gSceneIndexCellCapacity; i++) {
+        free(gSceneIndexCells[i].items);
+    }
+    free(gSceneIndexCells);
+    free(gSceneIndexEntries);
+    free(gSceneIndexLarge);
+    free(gSceneIndexResults);
+    gSceneIndexCells = NULL;
+    gSceneIndexCellCapacity = 0;
+    gSceneIndexCellUsed = 0;
+    gSceneIndexEntries = NULL;
+    gSceneIndexEntryCapacity = 0;
+    gSceneIndexCount = 0;
+    gSceneIndexLarge = NULL;
+    gSceneIndexLargeCount = 0;
+    gSceneIndexLargeCapacity = 0;
+    gSceneIndexResults = NULL;
+    gSceneIndexResultCapacity = 0;
+}
+
+int SceneIndex_FindTopmostAtPoint(Vector2 point, const Box* boxes, int boxCount) {
+    SceneIndex_Sync(boxes, boxCount);
+    if (gSceneIndexCount != boxCount) {
+        return FindTopmostBoxAtPoint(point, (Box*)boxes, boxCount);
+    }
+
+    /* Usually one cell; up to four when the point is within reach of a cell edge.
+       A box listed in several of them is just tested again. */
+    const float reach = GetSceneHitReach();
+    int cx0 = SceneIndex_CellCoord(point.x - reach);
+    int cy0 = SceneIndex_CellCoord(point.y - reach);
+    int cx1 = SceneIndex_CellCoord(point.x + reach);
+    int cy1 = SceneIndex_CellCoord(point.y + reach);
+    int best = -1;
+    for (int cy = cy0; cy <= cy1; cy++) {
+        for (int cx = cx0; cx <= cx1; cx++) {
+            SceneIndexCell* cell = SceneIndex_FindCell(cx, cy, 0);
+            if (cell == NULL) {
+                continue;
+            }
+            for (int i = 0; i < cell->count; i++) {
+                int index = cell->items[i];
+                if ((best < 0 || boxes[index].zKey > boxes[best].zKey) && IsPointOnBox(&boxes[index], point)) {
+                    best = index;
+                }
+            }
+        }
+    }
+    for (int i = 0; i < gSceneIndexLargeCount; i++) {
+        int index = gSceneIndexLarge[i];
+        if ((best < 0 || boxes[index].zKey > boxes[best].zKey) && IsPointOnBox(&boxes[index], point)) {
+            best = index;
+        }
+    }
+    return best;
+}
+
+static const Box* gSceneIndexSortBoxes = NULL;
+
+static int SceneIndex_CompareZ(const void* a, const void* b) {
+    double left = gSceneIndexSortBoxes[*(const int*)a].zKey;
+    double right = gSceneIndexSortBoxes[*(const int*)b].zKey;
+    return (left > right) - (left < right);
+}
+
+static void SceneIndex_SortByZ(const Box* boxes, int count) {
+    gSceneIndexSortBoxes = boxes;
+    qsort(gSceneIndexResults, (size_t)count, sizeof(int), SceneIndex_CompareZ);
+    gSceneIndexSortBoxes = NULL;
+}
+
+/* Touching edges count as overlap, matching the render loop's view cull. */
+static int SceneIndex_Overlaps(Rectangle rect, const Box* box) {
+    return (float)(box->x + box->width) >= rect.x && (float)box->x <= rect.x + rect.width &&
+           (float)(box->y + box->height) >= rect.y && (float)box->y <= rect.y + rect.height;
+}
+
+static void SceneIndex_Collect(const Box* boxes, int index, Rectangle rect, int* count) {
+    SceneIndexEntry* entry = &gSceneIndexEntries[index];
+    if (entry->stamp == gSceneIndexStamp) {
+        return;
+    }
+    entry->stamp = gSceneIndexStamp;
+    if (SceneIndex_Overlaps(rect, &boxes[index])) {
+        gSceneIndexResults[(*count)++] = index;
+    }
+}
+
+int SceneIndex_QueryRect(Rectangle rect, const Box* boxes, int boxCount, const int** indices) {
+    *indices = NULL;
+    SceneIndex_Sync(boxes, boxCount);
+    if (!SceneIndex_GrowInts(&gSceneIndexResults, &gSceneIndexResultCapacity, boxCount > 0 ? boxCount : 1)) {
+        return 0;
+    }
+    *indices = gSceneIndexResults;
+
+    int count = 0;
+    int cx0 = SceneIndex_CellCoord(rect.x);
+    int cy0 = SceneIndex_CellCoord(rect.y);
+    int cx1 = SceneIndex_CellCoord(rect.x + rect.width);
+    int cy1 = SceneIndex_CellCoord(rect.y + rect.height);
+    long long cellSpan = (long long)(cx1 - cx0 + 1) * (long long)(cy1 - cy0 + 1);
+
+    /* A rect covering more cells than there are boxes is cheaper to answer by
+       scanning the array. */
+    if (gSceneIndexCount != boxCount || cellSpan > (long long)boxCount) {
+        for (int i = 0; i < boxCount; i++) {
+            if (SceneIndex_Overlaps(rect, &boxes[i])) {
+                gSceneIndexResults[count++] = i;
+            }
+        }
+        SceneIndex_SortByZ(boxes, count);
+        return count;
+    }
+
+    gSceneIndexStamp++;
+    if (gSceneIndexStamp == 0) {
+        for (int i = 0; i < gSceneIndexCount; i++) {
+            gSceneIndexEntries[i].stamp = 0;
+        }
+        gSceneIndexStamp = 1;
+    }
+
+    for (int cy = cy0; cy <= cy1; cy++) {
+        for (int cx = cx0; cx <= cx1; cx++) {
+            SceneIndexCell* cell = SceneIndex_FindCell(cx, cy, 0);
+            if (cell == NULL) {
+                continue;
+            }
+            for (int i = 0; i < cell->count; i++) {
+                SceneIndex_Collect(boxes, cell->items[i], rect, &count);
+            }
+        }
+    }
+    for (int i = 0; i < gSceneIndexLargeCount; i++) {
+        SceneIndex_Collect(boxes, gSceneIndexLarge[i], rect, &count);
+    }
+
+    SceneIndex_SortByZ(boxes, count);
+    return count;
+}
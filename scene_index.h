@@ -0,0 +1,25 @@
+#ifndef SCENE_INDEX_H
+#define SCENE_INDEX_H
+
+#include "scene.h"
+
+/* Uniform-grid spatial index over the scene array, keyed by box index. Boxes
+   appended at the end of the array are picked up by the next query; moves,
+   resizes and removals must be reported after they have been applied to the
+   array. Stacking is read from Box.zKey at query time, so reordering needs no
+   update. */
+
+void SceneIndex_Remove(const Box* boxes, int boxCount, int index);
+void SceneIndex_Update(const Box* boxes, int index);
+void SceneIndex_Rebuild(const Box* boxes, int boxCount);
+void SceneIndex_Clear(void);
+void SceneIndex_Shutdown(void);
+
+/* Same answer as FindTopmostBoxAtPoint, including handle and edge reach. */
+int SceneIndex_FindTopmostAtPoint(Vector2 point, const Box* boxes, int boxCount);
+
+/* Indices of boxes overlapping rect, back to front by zKey. The array is owned by the
+   index and stays valid until the next query or update. */
+int SceneIndex_QueryRect(Rectangle rect, const Box* boxes, int boxCount, const int** indices);
+
+#endif /* SCENE_INDEX_H */
@@ -0,0 +1,346 @@
+#include "scene_tiles.h"
+#include "scene_index.h"
+
+#include "rlgl.h"
+#include <math.h>
+#include <stdlib.h>
+
+#define SCENE_TILES_SIZE 256            /* tile edge in screen pixels */
+/* Tiles kept around for panning back, as a multiple of the visible count. */
+#define SCENE_TILES_POOL_FACTOR 2
+/* Outlines reach this far outside a box (the dirty margin in scene.c). */
+#define SCENE_TILES_OUTLINE_MARGIN 2.0f
+
+typedef struct {
+    int tx;
+    int ty;
+    int used;               /* holds tile (tx, ty) at gSceneTilesZoom */
+    int stale;
+    unsigned int lastFrame;
+    RenderTexture2D target;
+} SceneTile;
+
+static SceneTile* gSceneTiles = NULL;
+static int gSceneTileCount = 0;
+static int gSceneTileCapacity = 0;
+static float gSceneTilesZoom = 0.0f;
+static unsigned int gSceneTilesFrame = 0;
+static int gSceneTilesUnavailable = 0;
+
+/* Tiles blitted this frame, as pool slots. */
+static int* gSceneTilesVisible = NULL;
+static int gSceneTilesVisibleCount = 0;
+static int gSceneTilesVisibleCapacity = 0;
+
+/* Live boxes this frame (ids and indices) and last frame (ids). */
+static BoxId* gSceneTilesLiveIds = NULL;
+static int* gSceneTilesLiveIndices = NULL;
+static int gSceneTilesLiveCount = 0;
+static int gSceneTilesLiveIdCapacity = 0;
+static int gSceneTilesLiveIndexCapacity = 0;
+static BoxId* gSceneTilesPrevLive = NULL;
+static int gSceneTilesPrevLiveCount = 0;
+static int gSceneTilesPrevLiveCapacity = 0;
+
+static int SceneTiles_Grow(void** items, int* capacity, int required, size_t itemSize) {
+    if (required <= *capacity) {
+        return 1;
+    }
+    int newCapacity = (*capacity > 0) ? *capacity : 16;
+    while (newCapacity < required) {
+        newCapacity *= 2;
+    }
+    void* grown = realloc(*items, (size_t)newCapacity * itemSize);
+    if (grown == NULL) {
+        return 0;
+    }
+    *items = grown;
+    *capacity = newCapacity;
+    return 1;
+}
+
+static int SceneTiles_HasId(const BoxId* ids, int count, BoxId id) {
+    for (int i = 0; i < count; i++) {
+        if (ids[i] == id) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+void SceneTiles_BeginFrame(void) {
+    gSceneTilesLiveCount = 0;
+}
+
+void SceneTiles_MarkLive(const Box* boxes, int index) {
+    BoxId id = boxes[index].id;
+    if (SceneTiles_HasId(gSceneTilesLiveIds, gSceneTilesLiveCount, id)) {
+        return;
+    }
+    if (!SceneTiles_Grow((void**)&gSceneTilesLiveIds, &gSceneTilesLiveIdCapacity, gSceneTilesLiveCount + 1, sizeof(BoxId)) ||
+        !SceneTiles_Grow((void**)&gSceneTilesLiveIndices, &gSceneTilesLiveIndexCapacity, gSceneTilesLiveCount + 1, sizeof(int))) {
+        return;
+    }
+    gSceneTilesLiveIds[gSceneTilesLiveCount] = id;
+    gSceneTilesLiveIndices[gSceneTilesLiveCount] = index;
+    gSceneTilesLiveCount++;
+}
+
+static void SceneTiles_InvalidateAll(void) {
+    for (int i = 0; i < gSceneTileCount; i++) {
+        gSceneTiles[i].stale = 1;
+    }
+}
+
+static void SceneTiles_Invalidate(Rectangle rect) {
+    float worldSize = (float)SCENE_TILES_SIZE / gSceneTilesZoom;
+    int tx0 = (int)floorf(rect.x / worldSize);
+    int ty0 = (int)floorf(rect.y / worldSize);
+    int tx1 = (int)floorf((rect.x + rect.width) / worldSize);
+    int ty1 = (int)floorf((rect.y + rect.height) / worldSize);
+    for (int i = 0; i < gSceneTileCount; i++) {
+        SceneTile* tile = &gSceneTiles[i];
+        if (tile->used && tile->tx >= tx0 && tile->tx <= tx1 && tile->ty >= ty0 && tile->ty <= ty1) {
+            tile->stale = 1;
+        }
+    }
+}
+
+/* Goes through the dirty list so the box's area is handled with the rest of it. */
+static void SceneTiles_InvalidateBoxById(const Box* boxes, BoxId id) {
+    int index = FindBoxIndex(id);
+    if (index >= 0) {
+        MarkBoxDirty(&boxes[index]);
+    }
+}
+
+/* Folds the dirty list and live-set changes into tile staleness. A box that is
+   live both now and last frame is in no tile, so its changes are skipped. */
+static void SceneTiles_ApplyInvalidations(const Box* boxes) {
+    for (int i = 0; i < gSceneTilesLiveCount; i++) {
+        if (!SceneTiles_HasId(gSceneTilesPrevLive, gSceneTilesPrevLiveCount, gSceneTilesLiveIds[i])) {
+            SceneTiles_InvalidateBoxById(boxes, gSceneTilesLiveIds[i]);
+        }
+    }
+    for (int i = 0; i < gSceneTilesPrevLiveCount; i++) {
+        if (!SceneTiles_HasId(gSceneTilesLiveIds, gSceneTilesLiveCount, gSceneTilesPrevLive[i])) {
+            SceneTiles_InvalidateBoxById(boxes, gSceneTilesPrevLive[i]);
+        }
+    }
+
+    const SceneDirtyRect* dirty = NULL;
+    int dirtyCount = TakeSceneDirtyRects(&dirty);
+    if (dirtyCount < 0) {
+        SceneTiles_InvalidateAll();
+    }
+    for (int i = 0; i < dirtyCount; i++) {
+        if (SceneTiles_HasId(gSceneTilesLiveIds, gSceneTilesLiveCount, dirty[i].id) &&
+            SceneTiles_HasId(gSceneTilesPrevLive, gSceneTilesPrevLiveCount, dirty[i].id)) {
+            continue;
+        }
+        SceneTiles_Invalidate(dirty[i].bounds);
+    }
+
+    if (SceneTiles_Grow((void**)&gSceneTilesPrevLive, &gSceneTilesPrevLiveCapacity, gSceneTilesLiveCount, sizeof(BoxId))) {
+        for (int i = 0; i < gSceneTilesLiveCount; i++) {
+            gSceneTilesPrevLive[i] = gSceneTilesLiveIds[i];
+        }
+        gSceneTilesPrevLiveCount = gSceneTilesLiveCount;
+    }
+}
+
+/* Live boxes are drawn over every tile, so a box stacked above a live box and
+   overlapping it has to be drawn live as well to stay on top. Boxes promoted
+   here are checked in turn, which pulls in whole stacks. */
+static void SceneTiles_PromoteCovering(const Box* boxes, int boxCount) {
+    float reach = 2.0f * SCENE_TILES_OUTLINE_MARGIN;
+    for (int i = 0; i < gSceneTilesLiveCount; i++) {
+        const Box* live = &boxes[gSceneTilesLiveIndices[i]];
+        Rectangle rect = GetBoxRect(live);
+        rect.x -= reach;
+        rect.y -= reach;
+        rect.width += 2.0f * reach;
+        rect.height += 2.0f * reach;
+        const int* order = NULL;
+        int count = SceneIndex_QueryRect(rect, boxes, boxCount, &order);
+        for (int j = count - 1; j >= 0 && boxes[order[j]].zKey > live->zKey; j--) {
+            SceneTiles_MarkLive(boxes, order[j]);
+        }
+    }
+}
+
+static void SceneTiles_SortLive(const Box* boxes) {
+    for (int i = 1; i < gSceneTilesLiveCount; i++) {
+        int index = gSceneTilesLiveIndices[i];
+        int j = i - 1;
+        while (j >= 0 && boxes[gSceneTilesLiveIndices[j]].zKey > boxes[index].zKey) {
+            gSceneTilesLiveIndices[j + 1] = gSceneTilesLiveIndices[j];
+            j--;
+        }
+        gSceneTilesLiveIndices[j + 1] = index;
+    }
+}
+
+/* Finds the slot holding (tx, ty), or claims one: a free slot, a new one while
+   the pool is under budget, else the least recently blitted. */
+static SceneTile* SceneTiles_Acquire(int tx, int ty, int budget) {
+    int unused = -1;
+    int oldest = -1;
+    for (int i = 0; i < gSceneTileCount; i++) {
+        const SceneTile* tile = &gSceneTiles[i];
+        if (!tile->used) {
+            if (unused < 0) {
+                unused = i;
+            }
+            continue;
+        }
+        if (tile->tx == tx && tile->ty == ty) {
+            return &gSceneTiles[i];
+        }
+        if (tile->lastFrame != gSceneTilesFrame && (oldest < 0 || tile->lastFrame < gSceneTiles[oldest].lastFrame)) {
+            oldest = i;
+        }
+    }
+
+    int slot = unused;
+    if (slot < 0 && (gSceneTileCount < budget || oldest < 0) &&
+        SceneTiles_Grow((void**)&gSceneTiles, &gSceneTileCapacity, gSceneTileCount + 1, sizeof(SceneTile))) {
+        RenderTexture2D target = LoadRenderTexture(SCENE_TILES_SIZE, SCENE_TILES_SIZE);
+        if (target.id != 0) {
+            slot = gSceneTileCount++;
+            gSceneTiles[slot].target = target;
+        }
+    }
+    if (slot < 0) {
+        slot = oldest;
+    }
+    if (slot < 0) {
+        return NULL;
+    }
+    SceneTile* tile = &gSceneTiles[slot];
+    tile->tx = tx;
+    tile->ty = ty;
+    tile->used = 1;
+    tile->stale = 1;
+    return tile;
+}
+
+static void SceneTiles_Render(SceneTile* tile, const Box* boxes, int boxCount, SceneTilesDrawFn draw, void* user) {
+    float worldSize = (float)SCENE_TILES_SIZE / gSceneTilesZoom;
+    Rectangle world = {(float)tile->tx * worldSize, (float)tile->ty * worldSize, worldSize, worldSize};
+    const int* order = NULL;
+    int count = SceneIndex_QueryRect(world, boxes, boxCount, &order);
+
+    Camera2D tileCamera = {0};
+    tileCamera.target = (Vector2){world.x, world.y};
+    tileCamera.zoom = gSceneTilesZoom;
+
+    BeginTextureMode(tile->target);
+    ClearBackground(RAYWHITE);
+    /* Keep destination alpha at 1 so the tile blits as an opaque layer. */
+    rlSetBlendFactorsSeparate(RL_SRC_ALPHA, RL_ONE_MINUS_SRC_ALPHA, RL_ONE, RL_ONE_MINUS_SRC_ALPHA, RL_FUNC_ADD, RL_FUNC_ADD);
+    BeginBlendMode(BLEND_CUSTOM_SEPARATE);
+    BeginMode2D(tileCamera);
+    for (int i = 0; i < count; i++) {
+        if (!SceneTiles_HasId(gSceneTilesLiveIds, gSceneTilesLiveCount, boxes[order[i]].id)) {
+            draw(boxes, order[i], world, user);
+        }
+    }
+    EndMode2D();
+    EndBlendMode();
+    EndTextureMode();
+
+    tile->stale = 0;
+}
+
+int SceneTiles_Update(Camera2D camera, int screenWidth, int screenHeight,
+                      const Box* boxes, int boxCount, SceneTilesDrawFn draw, void* user) {
+    gSceneTilesFrame++;
+    gSceneTilesVisibleCount = 0;
+
+    if (camera.zoom != gSceneTilesZoom) {
+        for (int i = 0; i < gSceneTileCount; i++) {
+            gSceneTiles[i].used = 0;
+        }
+        gSceneTilesZoom = camera.zoom;
+    }
+    SceneTiles_PromoteCovering(boxes, boxCount);
+    SceneTiles_ApplyInvalidations(boxes);
+    SceneTiles_SortLive(boxes);
+    if (gSceneTilesUnavailable) {
+        return 0;
+    }
+
+    float worldSize = (float)SCENE_TILES_SIZE / gSceneTilesZoom;
+    Vector2 viewMin = GetScreenToWorld2D((Vector2){0.0f, 0.0f}, camera);
+    Vector2 viewMax = GetScreenToWorld2D((Vector2){(float)screenWidth, (float)screenHeight}, camera);
+    int tx0 = (int)floorf(viewMin.x / worldSize);
+    int ty0 = (int)floorf(viewMin.y / worldSize);
+    int tx1 = (int)floorf(viewMax.x / worldSize);
+    int ty1 = (int)floorf(viewMax.y / worldSize);
+    int visible = (tx1 - tx0 + 1) * (ty1 - ty0 + 1);
+    if (!SceneTiles_Grow((void**)&gSceneTilesVisible, &gSceneTilesVisibleCapacity, visible, sizeof(int))) {
+        return 0;
+    }
+
+    for (int ty = ty0; ty <= ty1; ty++) {
+        for (int tx = tx0; tx <= tx1; tx++) {
+            SceneTile* tile = SceneTiles_Acquire(tx, ty, visible * SCENE_TILES_POOL_FACTOR);
+            if (tile == NULL) {
+                if (gSceneTileCount == 0) {
+                    TraceLog(LOG_WARNING, "Tile cache disabled: render textures unavailable");
+                    gSceneTilesUnavailable = 1;
+                }
+                return 0;
+            }
+            tile->lastFrame = gSceneTilesFrame;
+            if (tile->stale) {
+                SceneTiles_Render(tile, boxes, boxCount, draw, user);
+            }
+            gSceneTilesVisible[gSceneTilesVisibleCount++] = (int)(tile - gSceneTiles);
+        }
+    }
+    return 1;
+}
+
+void SceneTiles_Draw(void) {
+    float worldSize = (float)SCENE_TILES_SIZE / gSceneTilesZoom;
+    /* Render textures are stored bottom-up. */
+    Rectangle source = {0.0f, 0.0f, (float)SCENE_TILES_SIZE, -(float)SCENE_TILES_SIZE};
+    for (int i = 0; i < gSceneTilesVisibleCount; i++) {
+        const SceneTile* tile = &gSceneTiles[gSceneTilesVisible[i]];
+        Rectangle dest = {(float)tile->tx * worldSize, (float)tile->ty * worldSize, worldSize, worldSize};
+        DrawTexturePro(tile->target.texture, source, dest, (Vector2){0.0f, 0.0f}, 0.0f, WHITE);
+    }
+}
+
+int SceneTiles_GetLive(const int** indices) {
+    *indices = gSceneTilesLiveIndices;
+    return gSceneTilesLiveCount;
+}
+
+void SceneTiles_Shutdown(void) {
+    for (int i = 0; i < gSceneTileCount; i++) {
+        UnloadRenderTexture(gSceneTiles[i].target);
+    }
+    free(gSceneTiles);
+    free(gSceneTilesVisible);
+    free(gSceneTilesLiveIds);
+    free(gSceneTilesLiveIndices);
+    free(gSceneTilesPrevLive);
+    gSceneTiles = NULL;
+    gSceneTileCount = 0;
+    gSceneTileCapacity = 0;
+    gSceneTilesZoom = 0.0f;
+    gSceneTilesVisible = NULL;
+    gSceneTilesVisibleCount = 0;
+    gSceneTilesVisibleCapacity = 0;
+    gSceneTilesLiveIds = NULL;
+    gSceneTilesLiveIndices = NULL;
+    gSceneTilesLiveCount = 0;
+    gSceneTilesLiveIdCapacity = 0;
+    gSceneTilesLiveIndexCapacity = 0;
+    gSceneTilesPrevLive = NULL;
+    gSceneTilesPrevLiveCount = 0;
+    gSceneTilesPrevLiveCapacity = 0;
+}
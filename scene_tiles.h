@@ -0,0 +1,37 @@
+#ifndef SCENE_TILES_H
+#define SCENE_TILES_H
+
+#include "scene.h"
+
+/* Retained rendering of the static part of the scene. The visible world is cut
+   into fixed-size screen tiles at the current zoom, and each tile is a render
+   texture holding every box over it that is not live, back to front. A tile is
+   redrawn only when a box over it is reported with MarkBoxDirty, a box enters or
+   leaves the live set, or the zoom changes; panning reuses tiles.
+
+   Live boxes (playing media, the box being edited or dragged) stay out of the
+   tiles and are drawn over them every frame, together with any box stacked
+   above one of them and overlapping it, so the composite keeps zKey order. */
+
+/* clip is the world rect of the tile being drawn; content outside it may be skipped. */
+typedef void (*SceneTilesDrawFn)(const Box* boxes, int index, Rectangle clip, void* user);
+
+/* Starts a new live set; follow with one SceneTiles_MarkLive per live box. */
+void SceneTiles_BeginFrame(void);
+void SceneTiles_MarkLive(const Box* boxes, int index);
+
+/* Applies pending invalidations and redraws stale visible tiles with draw. Must
+   run outside BeginDrawing/BeginMode2D. Returns 0 when no render texture is
+   available, in which case the caller draws every box directly. */
+int SceneTiles_Update(Camera2D camera, int screenWidth, int screenHeight,
+                      const Box* boxes, int boxCount, SceneTilesDrawFn draw, void* user);
+
+/* Blits the visible tiles; call inside BeginMode2D with the same camera. */
+void SceneTiles_Draw(void);
+
+/* Indices of this frame's live boxes, back to front by zKey. */
+int SceneTiles_GetLive(const int** indices);
+
+void SceneTiles_Shutdown(void);
+
+#endif /* SCENE_TILES_H */
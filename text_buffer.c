@@ -0,0 +1,165 @@
+#include "text_buffer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define TEXT_BUFFER_MIN_CAPACITY 256
+
+static int TextBuffer_GapSize(const TextBuffer* buffer) {
+    return buffer->gapEnd - buffer->gapStart;
+}
+
+static int TextBuffer_Reserve(TextBuffer* buffer, int gapRequired) {
+    if (TextBuffer_GapSize(buffer) >= gapRequired) {
+        return 1;
+    }
+    int length = TextBuffer_GetLength(buffer);
+    int newCapacity = (buffer->capacity > 0) ? buffer->capacity : TEXT_BUFFER_MIN_CAPACITY;
+    while (newCapacity - length < gapRequired) {
+        newCapacity *= 2;
+    }
+    char* grown = (char*)realloc(buffer->data, (size_t)newCapacity);
+    if (grown == NULL) {
+        return 0;
+    }
+    /* Keep the text after the gap at the end of the larger allocation. */
+    int tail = buffer->capacity - buffer->gapEnd;
+    memmove(grown + newCapacity - tail, grown + buffer->gapEnd, (size_t)tail);
+    buffer->data = grown;
+    buffer->gapEnd = newCapacity - tail;
+    buffer->capacity = newCapacity;
+    return 1;
+}
+
+static void TextBuffer_MoveGap(TextBuffer* buffer, int index) {
+    if (index < buffer->gapStart) {
+        int count = buffer->gapStart - index;
+        memmove(buffer->data + buffer->gapEnd - count, buffer->data + index, (size_t)count);
+        buffer->gapStart -= count;
+        buffer->gapEnd -= count;
+    } else if (index > buffer->gapStart) {
+        int count = index - buffer->gapStart;
+        memmove(buffer->data + buffer->gapStart, buffer->data + buffer->gapEnd, (size_t)count);
+        buffer->gapStart += count;
+        buffer->gapEnd += count;
+    }
+}
+
+static int TextBuffer_Clamp(const TextBuffer* buffer, int index) {
+    int length = TextBuffer_GetLength(buffer);
+    if (index < 0) return 0;
+    if (index > length) return length;
+    return index;
+}
+
+int TextBuffer_SetText(TextBuffer* buffer, const char* text, int length) {
+    buffer->gapStart = 0;
+    buffer->gapEnd = buffer->capacity;
+    if (text == NULL || length <= 0) {
+        return 1;
+    }
+    if (!TextBuffer_Reserve(buffer, length)) {
+        return 0;
+    }
+    memcpy(buffer->data, text, (size_t)length);
+    buffer->gapStart = length;
+    return 1;
+}
+
+int TextBuffer_GetLength(const TextBuffer* buffer) {
+    return buffer->capacity - TextBuffer_GapSize(buffer);
+}
+
+char TextBuffer_GetChar(const TextBuffer* buffer, int index) {
+    if (index < 0 || index >= TextBuffer_GetLength(buffer)) {
+        return '\0';
+    }
+    if (index < buffer->gapStart) {
+        return buffer->data[index];
+    }
+    return buffer->data[index + TextBuffer_GapSize(buffer)];
+}
+
+int TextBuffer_Insert(TextBuffer* buffer, int index, const char* text, int length) {
+    if (text == NULL || length <= 0) {
+        return 1;
+    }
+    if (!TextBuffer_Reserve(buffer, length)) {
+        return 0;
+    }
+    TextBuffer_MoveGap(buffer, TextBuffer_Clamp(buffer, index));
+    memcpy(buffer->data + buffer->gapStart, text, (size_t)length);
+    buffer->gapStart += length;
+    return 1;
+}
+
+void TextBuffer_Delete(TextBuffer* buffer, int start, int end) {
+    start = TextBuffer_Clamp(buffer, start);
+    end = TextBuffer_Clamp(buffer, end);
+    if (end <= start) {
+        return;
+    }
+    TextBuffer_MoveGap(buffer, start);
+    buffer->gapEnd += end - start;
+}
+
+const char* TextBuffer_GetRange(TextBuffer* buffer, int start, int end) {
+    static const char empty = '\0';
+    start = TextBuffer_Clamp(buffer, start);
+    end = TextBuffer_Clamp(buffer, end);
+    if (buffer->data == NULL || end <= start) {
+        return &empty;
+    }
+    if (start < buffer->gapStart && end > buffer->gapStart) {
+        if (end - buffer->gapStart <= buffer->gapStart - start) {
+            TextBuffer_MoveGap(buffer, end);
+        } else {
+            TextBuffer_MoveGap(buffer, start);
+        }
+    }
+    if (end <= buffer->gapStart) {
+        return buffer->data + start;
+    }
+    return buffer->data + start + TextBuffer_GapSize(buffer);
+}
+
+char* TextBuffer_CopyRange(const TextBuffer* buffer, int start, int end) {
+    start = TextBuffer_Clamp(buffer, start);
+    end = TextBuffer_Clamp(buffer, end);
+    int length = (end > start) ? end - start : 0;
+    char* copy = (char*)malloc((size_t)length + 1);
+    if (copy == NULL) {
+        return NULL;
+    }
+    int before = 0;
+    if (start < buffer->gapStart) {
+        before = ((end < buffer->gapStart) ? end : buffer->gapStart) - start;
+        memcpy(copy, buffer->data + start, (size_t)before);
+    }
+    if (length > before) {
+        memcpy(copy + before, buffer->data + start + before + TextBuffer_GapSize(buffer), (size_t)(length - before));
+    }
+    copy[length] = '\0';
+    return copy;
+}
+
+char* TextBuffer_Take(TextBuffer* buffer) {
+    if (!TextBuffer_Reserve(buffer, 1)) {
+        return NULL;
+    }
+    int length = TextBuffer_GetLength(buffer);
+    TextBuffer_MoveGap(buffer, length);
+    buffer->data[length] = '\0';
+    char* text = buffer->data;
+    char* shrunk = (char*)realloc(text, (size_t)length + 1);
+    *buffer = (TextBuffer){0};
+    return (shrunk != NULL) ? shrunk : text;
+}
+
+void TextBuffer_Free(TextBuffer* buffer) {
+    if (buffer == NULL) {
+        return;
+    }
+    free(buffer->data);
+    *buffer = (TextBuffer){0};
+}
@@ -0,0 +1,39 @@
+#ifndef TEXT_BUFFER_H
+#define TEXT_BUFFER_H
+
+/* Text of the box being edited, kept as a gap buffer: the bytes before and
+   after the edit point sit at the two ends of one allocation with the free gap
+   between them. Typing or deleting at the caret moves no text, and moving the
+   edit point only moves the bytes between the old and new position. The
+   buffer grows by doubling, so there is no length limit.
+
+   Offsets in the API are logical, as if the gap were not there. */
+
+typedef struct {
+    char* data;
+    int capacity;
+    int gapStart;
+    int gapEnd;
+} TextBuffer;
+
+/* Replaces the contents with text[0..length). Returns 0 when out of memory. */
+int TextBuffer_SetText(TextBuffer* buffer, const char* text, int length);
+int TextBuffer_GetLength(const TextBuffer* buffer);
+char TextBuffer_GetChar(const TextBuffer* buffer, int index);
+
+/* Returns 0 when out of memory, leaving the text unchanged. */
+int TextBuffer_Insert(TextBuffer* buffer, int index, const char* text, int length);
+void TextBuffer_Delete(TextBuffer* buffer, int start, int end);
+
+/* Contiguous view of [start, end). If the gap splits the range it is moved to
+   whichever end of the range needs fewer bytes shifted. The pointer is valid
+   until the next call that changes the buffer or asks for another range. */
+const char* TextBuffer_GetRange(TextBuffer* buffer, int start, int end);
+/* Terminated copy of [start, end) for the caller to free. */
+char* TextBuffer_CopyRange(const TextBuffer* buffer, int start, int end);
+/* Hands the whole text over as a terminated string for the caller to free,
+   without copying it, and leaves the buffer empty. */
+char* TextBuffer_Take(TextBuffer* buffer);
+void TextBuffer_Free(TextBuffer* buffer);
+
+#endif /* TEXT_BUFFER_H */
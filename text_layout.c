@@ -0,0 +1,798 @@
+#include "text_layout.h"
+
+#include "rlgl.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* MeasureText's own size handling for the default font. */
+#define TEXT_LAYOUT_MIN_FONT_SIZE 10
+#define TEXT_LAYOUT_CACHED_CODEPOINTS 256
+/* Pixel height the distance field glyphs are generated at. */
+#define TEXT_LAYOUT_SDF_BASE_SIZE 40
+#define TEXT_LAYOUT_SDF_FIRST_CODEPOINT 32
+#define TEXT_LAYOUT_SDF_LATIN_COUNT 224     /* printable ASCII and Latin-1 */
+
+/* Punctuation beyond Latin-1 that the interface itself uses. */
+static const int TEXT_LAYOUT_SDF_EXTRA_CODEPOINTS[] = {0x2013, 0x2014, 0x2022, 0x2026, 0x20AC};
+#define TEXT_LAYOUT_SDF_EXTRA_COUNT ((int)(sizeof(TEXT_LAYOUT_SDF_EXTRA_CODEPOINTS) / sizeof(TEXT_LAYOUT_SDF_EXTRA_CODEPOINTS[0])))
+#define TEXT_LAYOUT_SDF_GLYPH_COUNT (TEXT_LAYOUT_SDF_LATIN_COUNT + TEXT_LAYOUT_SDF_EXTRA_COUNT)
+
+/* Coverage from the distance stored in alpha, anti-aliased over one screen
+   pixel whatever the scale. */
+static const char* TEXT_LAYOUT_SDF_FS =
+    "#version 330\n"
+    "in vec2 fragTexCoord;\n"
+    "in vec4 fragColor;\n"
+    "uniform sampler2D texture0;\n"
+    "out vec4 finalColor;\n"
+    "void main() {\n"
+    "    float distance = texture(texture0, fragTexCoord).a - 0.5;\n"
+    "    float px = max(length(vec2(dFdx(distance), dFdy(distance))), 1e-4);\n"
+    "    float alpha = smoothstep(-px, px, distance);\n"
+    "    finalColor = vec4(fragColor.rgb, fragColor.a * alpha);\n"
+    "}\n";
+
+/* Distance field font and its shader; texture id 0 while the default font is in use. */
+static Font gSdfFont = {0};
+static Shader gSdfShader = {0};
+static int gTextRunDepth = 0;
+
+/* Unscaled advances of the active font for the first 256 codepoints. */
+static float gGlyphAdvances[TEXT_LAYOUT_CACHED_CODEPOINTS];
+static unsigned int gGlyphFontTexture = 0;     /* texture id the advances were read from */
+
+/* One-line prefix width cache, keyed by a copy of the line and the font size. */
+static int* gPrefixWidths = NULL;
+static int gPrefixCapacity = 0;
+static char* gPrefixLine = NULL;
+static int gPrefixLineCapacity = 0;
+static int gPrefixLength = -1;
+static int gPrefixFontSize = 0;
+
+/* Row starts of the line being wrapped, before they are copied to the line. */
+static int* gBreakScratch = NULL;
+static int gBreakScratchCapacity = 0;
+
+static float TextLayout_ReadAdvance(Font font, int codepoint) {
+    int index = GetGlyphIndex(font, codepoint);
+    if (font.glyphs[index].advanceX != 0) {
+        return (float)font.glyphs[index].advanceX;
+    }
+    return font.recs[index].width + (float)font.glyphs[index].offsetX;
+}
+
+/* Returns 0 while the default font is not loaded, like MeasureText. */
+static int TextLayout_EnsureGlyphAdvances(Font font) {
+    if (font.texture.id == 0) {
+        return 0;
+    }
+    if (gGlyphFontTexture != font.texture.id) {
+        for (int i = 0; i < TEXT_LAYOUT_CACHED_CODEPOINTS; i++) {
+            gGlyphAdvances[i] = TextLayout_ReadAdvance(font, i);
+        }
+        gGlyphFontTexture = font.texture.id;
+    }
+    return 1;
+}
+
+static float TextLayout_GetAdvance(Font font, int codepoint) {
+    if (codepoint >= 0 && codepoint < TEXT_LAYOUT_CACHED_CODEPOINTS) {
+        return gGlyphAdvances[codepoint];
+    }
+    return TextLayout_ReadAdvance(font, codepoint);
+}
+
+/* UTF-8 decode of the codepoint at text[index] that never reads past length.
+   Malformed or cut-off sequences decode as a one-byte '?', like
+   GetCodepointNext on a terminated copy. */
+static int TextLayout_NextCodepoint(const char* text, int index, int length, int* size) {
+    const unsigned char* bytes = (const unsigned char*)text + index;
+    int needed = 1;
+    int codepoint = bytes[0];
+    *size = 1;
+    if (bytes[0] < 0x80) {
+        return codepoint;
+    } else if ((bytes[0] & 0xE0) == 0xC0) {
+        needed = 2;
+        codepoint = bytes[0] & 0x1F;
+    } else if ((bytes[0] & 0xF0) == 0xE0) {
+        needed = 3;
+        codepoint = bytes[0] & 0x0F;
+    } else if ((bytes[0] & 0xF8) == 0xF0) {
+        needed = 4;
+        codepoint = bytes[0] & 0x07;
+    } else {
+        return '?';
+    }
+    if (needed > length - index) {
+        return '?';
+    }
+    for (int i = 1; i < needed; i++) {
+        if ((bytes[i] & 0xC0) != 0x80) {
+            return '?';
+        }
+        codepoint = (codepoint << 6) | (bytes[i] & 0x3F);
+    }
+    *size = needed;
+    return codepoint;
+}
+
+static Font TextLayout_GetFont(void) {
+    return (gSdfFont.texture.id != 0) ? gSdfFont : GetFontDefault();
+}
+
+/* The default font keeps DrawText's rules: sizes below 10 draw at 10, and
+   letters are spaced a tenth of the size apart. Distance field glyphs carry
+   their own spacing in their advances. */
+static void TextLayout_GetScale(Font font, int fontSize, float* scale, float* spacing) {
+    if (gSdfFont.texture.id != 0) {
+        *spacing = 0.0f;
+        *scale = (float)fontSize / (float)font.baseSize;
+        return;
+    }
+    if (fontSize < TEXT_LAYOUT_MIN_FONT_SIZE) {
+        fontSize = TEXT_LAYOUT_MIN_FONT_SIZE;
+    }
+    *spacing = (float)(fontSize / TEXT_LAYOUT_MIN_FONT_SIZE);
+    *scale = (float)fontSize / (float)font.baseSize;
+}
+
+int TextLayout_MeasureSegment(const char* text, int length, int fontSize) {
+    Font font = TextLayout_GetFont();
+    if (text == NULL || length <= 0 || !TextLayout_EnsureGlyphAdvances(font)) {
+        return 0;
+    }
+
+    float scale = 1.0f;
+    float spacing = 0.0f;
+    TextLayout_GetScale(font, fontSize, &scale, &spacing);
+
+    float advance = 0.0f;
+    int glyphCount = 0;
+    for (int i = 0; i < length;) {
+        int size = 1;
+        int codepoint = TextLayout_NextCodepoint(text, i, length, &size);
+        advance += TextLayout_GetAdvance(font, codepoint);
+        glyphCount++;
+        i += size;
+    }
+    return (int)(advance * scale + (float)(glyphCount - 1) * spacing);
+}
+
+static int TextLayout_Reserve(void** buffer, int* capacity, int required, size_t itemSize) {
+    if (required <= *capacity) {
+        return 1;
+    }
+    int newCapacity = (*capacity > 0) ? *capacity : 128;
+    while (newCapacity < required) {
+        newCapacity *= 2;
+    }
+    void* grown = realloc(*buffer, (size_t)newCapacity * itemSize);
+    if (grown == NULL) {
+        return 0;
+    }
+    *buffer = grown;
+    *capacity = newCapacity;
+    return 1;
+}
+
+const int* TextLayout_GetLinePrefixWidths(const char* line, int length, int fontSize) {
+    static const int empty = 0;
+    if (line == NULL || length <= 0) {
+        return &empty;
+    }
+    if (gPrefixLength == length && gPrefixFontSize == fontSize && memcmp(gPrefixLine, line, (size_t)length) == 0) {
+        return gPrefixWidths;
+    }
+    if (!TextLayout_Reserve((void**)&gPrefixWidths, &gPrefixCapacity, length + 1, sizeof(int)) ||
+        !TextLayout_Reserve((void**)&gPrefixLine, &gPrefixLineCapacity, length, 1)) {
+        gPrefixLength = -1;
+        return &empty;
+    }
+
+    Font font = TextLayout_GetFont();
+    int fontReady = TextLayout_EnsureGlyphAdvances(font);
+    float scale = 1.0f;
+    float spacing = 0.0f;
+    TextLayout_GetScale(font, fontSize, &scale, &spacing);
+
+    float advance = 0.0f;
+    int glyphCount = 0;
+    gPrefixWidths[0] = 0;
+    for (int i = 0; i < length;) {
+        int size = 1;
+        int codepoint = TextLayout_NextCodepoint(line, i, length, &size);
+        advance += fontReady ? TextLayout_GetAdvance(font, codepoint) : 0.0f;
+        glyphCount++;
+        for (int b = 1; b < size; b++) {
+            gPrefixWidths[i + b] = gPrefixWidths[i];
+        }
+        i += size;
+        gPrefixWidths[i] = fontReady ? (int)(advance * scale + (float)(glyphCount - 1) * spacing) : 0;
+    }
+
+    memcpy(gPrefixLine, line, (size_t)length);
+    gPrefixLength = length;
+    gPrefixFontSize = fontSize;
+    return gPrefixWidths;
+}
+
+int TextLayout_GetIndexFromX(const char* line, int length, int fontSize, int x) {
+    if (line == NULL || length <= 0 || x < 0) {
+        return 0;
+    }
+    const int* widths = TextLayout_GetLinePrefixWidths(line, length, fontSize);
+    if (gPrefixLength != length) {
+        return length;
+    }
+
+    /* First prefix wider than x; widths never decrease along the line. */
+    int low = 1;
+    int high = length;
+    if (widths[high] <= x) {
+        return length;
+    }
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (widths[mid] > x) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+    return low;
+}
+
+static int TextLayout_ReserveLines(TextLines* lines, int required) {
+    if (required <= lines->capacity) {
+        return 1;
+    }
+    int capacity = lines->capacity;
+    if (!TextLayout_Reserve((void**)&lines->starts, &capacity, required, sizeof(int))) {
+        return 0;
+    }
+    capacity = lines->capacity;
+    if (!TextLayout_Reserve((void**)&lines->widths, &capacity, required, sizeof(int))) {
+        return 0;
+    }
+    capacity = lines->capacity;
+    if (!TextLayout_Reserve((void**)&lines->rowCounts, &capacity, required, sizeof(int))) {
+        return 0;
+    }
+    capacity = lines->capacity;
+    if (!TextLayout_Reserve((void**)&lines->rowBreaks, &capacity, required, sizeof(int*))) {
+        return 0;
+    }
+    capacity = lines->capacity;
+    if (!TextLayout_Reserve((void**)&lines->firstRows, &capacity, required, sizeof(int))) {
+        return 0;
+    }
+    lines->capacity = capacity;
+    return 1;
+}
+
+static void TextLayout_ResetRows(TextLines* lines, int line) {
+    lines->rowCounts[line] = 0;
+    lines->rowBreaks[line] = NULL;
+}
+
+static void TextLayout_FreeRows(TextLines* lines, int first, int end) {
+    for (int i = first; i < end; i++) {
+        free(lines->rowBreaks[i]);
+        TextLayout_ResetRows(lines, i);
+    }
+}
+
+/* The line must be wrapped again, and the first rows of the lines after it recounted. */
+static void TextLayout_DropRows(TextLines* lines, int line) {
+    lines->rowCounts[line] = 0;
+    if (lines->rowsValid > line) {
+        lines->rowsValid = line;
+    }
+}
+
+int TextLayout_IndexLines(TextLines* lines, const char* text, int length) {
+    if (lines->count > 0) {
+        TextLayout_FreeRows(lines, 0, lines->count);
+    }
+    lines->count = 0;
+    lines->length = 0;
+    lines->rowsValid = 0;
+    if (!TextLayout_ReserveLines(lines, 1)) {
+        return 0;
+    }
+    lines->starts[0] = 0;
+    lines->widths[0] = -1;
+    TextLayout_ResetRows(lines, 0);
+    lines->count = 1;
+    for (int i = 0; i < length; i++) {
+        if (text[i] != '\n') {
+            continue;
+        }
+        if (!TextLayout_ReserveLines(lines, lines->count + 1)) {
+            lines->count = 0;
+            return 0;
+        }
+        lines->starts[lines->count] = i + 1;
+        lines->widths[lines->count] = -1;
+        TextLayout_ResetRows(lines, lines->count);
+        lines->count++;
+    }
+    lines->length = length;
+    return 1;
+}
+
+int TextLayout_InsertLines(TextLines* lines, int index, const char* inserted, int length) {
+    if (length <= 0) {
+        return 1;
+    }
+    int line = TextLayout_FindLine(lines, index);
+    int added = 0;
+    for (int i = 0; i < length; i++) {
+        if (inserted[i] == '\n') {
+            added++;
+        }
+    }
+    if (!TextLayout_ReserveLines(lines, lines->count + added)) {
+        return 0;
+    }
+
+    int tail = lines->count - (line + 1);
+    memmove(lines->starts + line + 1 + added, lines->starts + line + 1, (size_t)tail * sizeof(int));
+    memmove(lines->widths + line + 1 + added, lines->widths + line + 1, (size_t)tail * sizeof(int));
+    memmove(lines->rowCounts + line + 1 + added, lines->rowCounts + line + 1, (size_t)tail * sizeof(int));
+    memmove(lines->rowBreaks + line + 1 + added, lines->rowBreaks + line + 1, (size_t)tail * sizeof(int*));
+    for (int i = line + 1 + added; i < lines->count + added; i++) {
+        lines->starts[i] += length;
+    }
+    int next = line + 1;
+    for (int i = 0; i < length; i++) {
+        if (inserted[i] == '\n') {
+            lines->starts[next] = index + i + 1;
+            lines->widths[next] = -1;
+            TextLayout_ResetRows(lines, next);
+            next++;
+        }
+    }
+    lines->widths[line] = -1;
+    TextLayout_DropRows(lines, line);
+    lines->count += added;
+    lines->length += length;
+    return 1;
+}
+
+void TextLayout_DeleteLines(TextLines* lines, int start, int end) {
+    if (end <= start || lines->count == 0) {
+        return;
+    }
+    /* Lines starting inside (start, end] lost their newline and merge into the first. */
+    int line = TextLayout_FindLine(lines, start);
+    int last = TextLayout_FindLine(lines, end);
+    int removed = last - line;
+    int tail = lines->count - (last + 1);
+    TextLayout_FreeRows(lines, line + 1, last + 1);
+    memmove(lines->starts + line + 1, lines->starts + last + 1, (size_t)tail * sizeof(int));
+    memmove(lines->widths + line + 1, lines->widths + last + 1, (size_t)tail * sizeof(int));
+    memmove(lines->rowCounts + line + 1, lines->rowCounts + last + 1, (size_t)tail * sizeof(int));
+    memmove(lines->rowBreaks + line + 1, lines->rowBreaks + last + 1, (size_t)tail * sizeof(int*));
+    lines->count -= removed;
+    for (int i = line + 1; i < lines->count; i++) {
+        lines->starts[i] -= end - start;
+    }
+    lines->widths[line] = -1;
+    TextLayout_DropRows(lines, line);
+    lines->length -= end - start;
+}
+
+int TextLayout_CopyLines(TextLines* dest, const TextLines* source) {
+    if (dest->count > 0) {
+        TextLayout_FreeRows(dest, 0, dest->count);
+    }
+    dest->count = 0;
+    dest->length = 0;
+    dest->rowsValid = 0;
+    if (!TextLayout_ReserveLines(dest, source->count)) {
+        return 0;
+    }
+    memcpy(dest->starts, source->starts, (size_t)source->count * sizeof(int));
+    memcpy(dest->widths, source->widths, (size_t)source->count * sizeof(int));
+    memcpy(dest->rowCounts, source->rowCounts, (size_t)source->count * sizeof(int));
+    memcpy(dest->firstRows, source->firstRows, (size_t)source->count * sizeof(int));
+    dest->rowsValid = source->rowsValid;
+    for (int i = 0; i < source->count; i++) {
+        dest->rowBreaks[i] = NULL;
+        if (source->rowBreaks[i] == NULL || source->rowCounts[i] <= 1) {
+            continue;
+        }
+        size_t size = (size_t)(source->rowCounts[i] - 1) * sizeof(int);
+        dest->rowBreaks[i] = (int*)malloc(size);
+        if (dest->rowBreaks[i] != NULL) {
+            memcpy(dest->rowBreaks[i], source->rowBreaks[i], size);
+        } else {
+            TextLayout_DropRows(dest, i);
+        }
+    }
+    dest->count = source->count;
+    dest->length = source->length;
+    dest->fontSize = source->fontSize;
+    dest->wrapWidth = source->wrapWidth;
+    dest->wrapFontSize = source->wrapFontSize;
+    return 1;
+}
+
+void TextLayout_FreeLines(TextLines* lines) {
+    if (lines == NULL) {
+        return;
+    }
+    if (lines->count > 0) {
+        TextLayout_FreeRows(lines, 0, lines->count);
+    }
+    free(lines->starts);
+    free(lines->widths);
+    free(lines->rowCounts);
+    free(lines->rowBreaks);
+    free(lines->firstRows);
+    *lines = (TextLines){0};
+}
+
+int TextLayout_FindLine(const TextLines* lines, int index) {
+    int low = 0;
+    int high = lines->count - 1;
+    if (high <= 0) {
+        return 0;
+    }
+    /* Last line whose start is at or before index. */
+    while (low < high) {
+        int mid = low + (high - low + 1) / 2;
+        if (lines->starts[mid] <= index) {
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
+    }
+    return low;
+}
+
+int TextLayout_GetLineStart(const TextLines* lines, int line) {
+    if (line <= 0 || lines->count == 0) {
+        return 0;
+    }
+    if (line >= lines->count) {
+        return lines->length;
+    }
+    return lines->starts[line];
+}
+
+int TextLayout_GetLineEnd(const TextLines* lines, int line) {
+    if (line + 1 < lines->count) {
+        return lines->starts[line + 1] - 1;
+    }
+    return lines->length;
+}
+
+int TextLayout_GetLineWidth(TextLines* lines, int line, const char* lineText, int fontSize) {
+    if (line < 0 || line >= lines->count) {
+        return 0;
+    }
+    if (lines->fontSize != fontSize) {
+        for (int i = 0; i < lines->count; i++) {
+            lines->widths[i] = -1;
+        }
+        lines->fontSize = fontSize;
+    }
+    if (lines->widths[line] < 0) {
+        int length = TextLayout_GetLineEnd(lines, line) - lines->starts[line];
+        lines->widths[line] = TextLayout_MeasureSegment(lineText, length, fontSize);
+    }
+    return lines->widths[line];
+}
+
+int TextLayout_IsLineMeasured(const TextLines* lines, int line, int fontSize) {
+    return line >= 0 && line < lines->count && lines->fontSize == fontSize && lines->widths[line] >= 0;
+}
+
+int TextLayout_GetMaxLineWidth(TextLines* lines, const char* text, int fontSize) {
+    int maxWidth = 0;
+    for (int i = 0; i < lines->count; i++) {
+        int width = TextLayout_GetLineWidth(lines, i, text + lines->starts[i], fontSize);
+        if (width > maxWidth) {
+            maxWidth = width;
+        }
+    }
+    return maxWidth;
+}
+
+/* Greedy wrap of one line into gBreakScratch. Whitespace may hang past the
+   edge; it never starts a row of its own. */
+static int TextLayout_BreakLine(const TextLines* lines, const char* text, int length) {
+    Font font = TextLayout_GetFont();
+    if (!TextLayout_EnsureGlyphAdvances(font)) {
+        return 1;
+    }
+    float scale = 1.0f;
+    float spacing = 0.0f;
+    TextLayout_GetScale(font, lines->wrapFontSize, &scale, &spacing);
+
+    int rows = 1;
+    int rowStart = 0;
+    float advance = 0.0f;       /* of the row so far */
+    int glyphCount = 0;
+    int breakAt = 0;            /* just past the row's last whitespace */
+    float breakAdvance = 0.0f;
+    int breakGlyphs = 0;
+    for (int i = 0; i < length;) {
+        int size = 1;
+        int codepoint = TextLayout_NextCodepoint(text, i, length, &size);
+        float glyphAdvance = TextLayout_GetAdvance(font, codepoint);
+        if (codepoint != ' ' && codepoint != '\t') {
+            while (glyphCount > 0 &&
+                   (int)((advance + glyphAdvance) * scale + (float)glyphCount * spacing) > lines->wrapWidth) {
+                if (breakAt > rowStart) {
+                    rowStart = breakAt;
+                    advance -= breakAdvance;
+                    glyphCount -= breakGlyphs;
+                } else {
+                    /* A word wider than the row on its own. */
+                    rowStart = i;
+                    advance = 0.0f;
+                    glyphCount = 0;
+                }
+                if (!TextLayout_Reserve((void**)&gBreakScratch, &gBreakScratchCapacity, rows, sizeof(int))) {
+                    return rows;
+                }
+                gBreakScratch[rows - 1] = rowStart;
+                rows++;
+                breakAdvance = 0.0f;
+                breakGlyphs = 0;
+            }
+        }
+        advance += glyphAdvance;
+        glyphCount++;
+        i += size;
+        if (codepoint == ' ' || codepoint == '\t') {
+            breakAt = i;
+            breakAdvance = advance;
+            breakGlyphs = glyphCount;
+        }
+    }
+    return rows;
+}
+
+int TextLayout_PrepareWrap(TextLines* lines, int fontSize, int wrapWidth) {
+    if (wrapWidth < 0) {
+        wrapWidth = 0;
+    }
+    /* Unwrapped lines are one row at any size. */
+    if (wrapWidth != lines->wrapWidth || (wrapWidth > 0 && fontSize != lines->wrapFontSize)) {
+        for (int i = 0; i < lines->count; i++) {
+            lines->rowCounts[i] = 0;
+        }
+        lines->rowsValid = 0;
+        lines->wrapWidth = wrapWidth;
+    }
+    lines->wrapFontSize = fontSize;
+    return lines->rowsValid;
+}
+
+int TextLayout_IsLineWrapped(const TextLines* lines, int line) {
+    return line >= 0 && line < lines->count && lines->rowCounts[line] > 0;
+}
+
+int TextLayout_WrapLine(TextLines* lines, int line, const char* lineText) {
+    if (line < 0 || line >= lines->count) {
+        return 0;
+    }
+    if (lines->rowCounts[line] <= 0) {
+        int rows = 1;
+        if (lines->wrapWidth > 0 && lineText != NULL) {
+            rows = TextLayout_BreakLine(lines, lineText, TextLayout_GetLineEnd(lines, line) - lines->starts[line]);
+        }
+        int* breaks = NULL;
+        if (rows > 1) {
+            breaks = (int*)realloc(lines->rowBreaks[line], (size_t)(rows - 1) * sizeof(int));
+            if (breaks != NULL) {
+                memcpy(breaks, gBreakScratch, (size_t)(rows - 1) * sizeof(int));
+                lines->rowBreaks[line] = breaks;
+            }
+        }
+        if (breaks == NULL) {
+            free(lines->rowBreaks[line]);
+            lines->rowBreaks[line] = NULL;
+            rows = 1;
+        }
+        lines->rowCounts[line] = rows;
+    }
+    if (line == lines->rowsValid) {
+        lines->firstRows[line] = (line == 0) ? 0 : lines->firstRows[line - 1] + lines->rowCounts[line - 1];
+        lines->rowsValid++;
+    }
+    return lines->rowCounts[line];
+}
+
+int TextLayout_GetRowCount(const TextLines* lines) {
+    if (lines->count == 0 || lines->rowsValid < lines->count) {
+        return lines->count;
+    }
+    int last = lines->count - 1;
+    return lines->firstRows[last] + lines->rowCounts[last];
+}
+
+int TextLayout_GetFirstRow(const TextLines* lines, int line) {
+    if (line <= 0) {
+        return 0;
+    }
+    if (line >= lines->rowsValid) {
+        return line;
+    }
+    return lines->firstRows[line];
+}
+
+int TextLayout_FindRowLine(const TextLines* lines, int row) {
+    int low = 0;
+    int high = lines->rowsValid - 1;
+    if (high <= 0) {
+        return 0;
+    }
+    /* Last line starting at or before row. */
+    while (low < high) {
+        int mid = low + (high - low + 1) / 2;
+        if (lines->firstRows[mid] <= row) {
+            low = mid;
+        } else {
+            high = mid - 1;
+        }
+    }
+    return low;
+}
+
+int TextLayout_FindRow(const TextLines* lines, int index) {
+    int line = TextLayout_FindLine(lines, index);
+    int row = TextLayout_GetFirstRow(lines, line);
+    if (line < lines->count && lines->rowBreaks[line] != NULL) {
+        int offset = index - lines->starts[line];
+        for (int r = 0; r + 1 < lines->rowCounts[line] && lines->rowBreaks[line][r] <= offset; r++) {
+            row++;
+        }
+    }
+    return row;
+}
+
+/* Row r of its line, clamped to the rows the line has. */
+static int TextLayout_GetRowInLine(const TextLines* lines, int line, int row) {
+    int r = row - TextLayout_GetFirstRow(lines, line);
+    int rows = (line < lines->count && lines->rowCounts[line] > 0) ? lines->rowCounts[line] : 1;
+    if (r < 0) return 0;
+    if (r >= rows) return rows - 1;
+    return r;
+}
+
+int TextLayout_GetRowStart(const TextLines* lines, int row) {
+    int line = TextLayout_FindRowLine(lines, row);
+    int r = TextLayout_GetRowInLine(lines, line, row);
+    int start = TextLayout_GetLineStart(lines, line);
+    return (r > 0 && lines->rowBreaks[line] != NULL) ? start + lines->rowBreaks[line][r - 1] : start;
+}
+
+int TextLayout_GetRowEnd(const TextLines* lines, int row) {
+    int line = TextLayout_FindRowLine(lines, row);
+    int r = TextLayout_GetRowInLine(lines, line, row);
+    if (line < lines->count && r + 1 < lines->rowCounts[line] && lines->rowBreaks[line] != NULL) {
+        return lines->starts[line] + lines->rowBreaks[line][r];
+    }
+    return TextLayout_GetLineEnd(lines, line);
+}
+
+int TextLayout_LoadFont(const char* path) {
+    unsigned int dataSize = 0;
+    unsigned char* data = (path != NULL && FileExists(path)) ? LoadFileData(path, &dataSize) : NULL;
+    if (data == NULL) {
+        return 0;
+    }
+
+    Shader shader = LoadShaderFromMemory(NULL, TEXT_LAYOUT_SDF_FS);
+    if (shader.id == 0 || shader.id == rlGetShaderIdDefault()) {
+        TraceLog(LOG_WARNING, "Text: distance field shader unavailable, using the default font");
+        UnloadFileData(data);
+        return 0;
+    }
+
+    int codepoints[TEXT_LAYOUT_SDF_GLYPH_COUNT];
+    for (int i = 0; i < TEXT_LAYOUT_SDF_LATIN_COUNT; i++) {
+        codepoints[i] = TEXT_LAYOUT_SDF_FIRST_CODEPOINT + i;
+    }
+    for (int i = 0; i < TEXT_LAYOUT_SDF_EXTRA_COUNT; i++) {
+        codepoints[TEXT_LAYOUT_SDF_LATIN_COUNT + i] = TEXT_LAYOUT_SDF_EXTRA_CODEPOINTS[i];
+    }
+    Font font = {0};
+    font.baseSize = TEXT_LAYOUT_SDF_BASE_SIZE;
+    font.glyphCount = TEXT_LAYOUT_SDF_GLYPH_COUNT;
+    font.glyphs = LoadFontData(data, (int)dataSize, font.baseSize, codepoints, font.glyphCount, FONT_SDF);
+    UnloadFileData(data);
+    if (font.glyphs == NULL) {
+        UnloadShader(shader);
+        return 0;
+    }
+    Image atlas = GenImageFontAtlas(font.glyphs, &font.recs, font.glyphCount, font.baseSize, 0, 1);
+    font.texture = LoadTextureFromImage(atlas);
+    UnloadImage(atlas);
+    if (font.texture.id == 0) {
+        UnloadFont(font);
+        UnloadShader(shader);
+        return 0;
+    }
+    SetTextureFilter(font.texture, TEXTURE_FILTER_BILINEAR);
+
+    TextLayout_Shutdown();
+    gSdfFont = font;
+    gSdfShader = shader;
+    return 1;
+}
+
+void TextLayout_BeginText(void) {
+    if (gTextRunDepth++ == 0 && gSdfFont.texture.id != 0) {
+        BeginShaderMode(gSdfShader);
+    }
+}
+
+void TextLayout_EndText(void) {
+    if (gTextRunDepth > 0 && --gTextRunDepth == 0 && gSdfFont.texture.id != 0) {
+        EndShaderMode();
+    }
+}
+
+void TextLayout_DrawSegment(const char* text, int length, float x, float y, int fontSize, Color color) {
+    Font font = TextLayout_GetFont();
+    if (text == NULL || length <= 0 || !TextLayout_EnsureGlyphAdvances(font)) {
+        return;
+    }
+
+    float scale = 1.0f;
+    float spacing = 0.0f;
+    TextLayout_GetScale(font, fontSize, &scale, &spacing);
+    float drawSize = scale * (float)font.baseSize;
+
+    TextLayout_BeginText();
+    Vector2 position = {x, y};
+    for (int i = 0; i < length;) {
+        int size = 1;
+        int codepoint = TextLayout_NextCodepoint(text, i, length, &size);
+        if (codepoint != ' ' && codepoint != '\t') {
+            DrawTextCodepoint(font, codepoint, position, drawSize, color);
+        }
+        position.x += TextLayout_GetAdvance(font, codepoint) * scale + spacing;
+        i += size;
+    }
+    TextLayout_EndText();
+}
+
+int TextLayout_MeasureText(const char* text, int fontSize) {
+    return (text != NULL) ? TextLayout_MeasureSegment(text, (int)strlen(text), fontSize) : 0;
+}
+
+void TextLayout_DrawText(const char* text, int x, int y, int fontSize, Color color) {
+    if (text != NULL) {
+        TextLayout_DrawSegment(text, (int)strlen(text), (float)x, (float)y, fontSize, color);
+    }
+}
+
+void TextLayout_Shutdown(void) {
+    free(gPrefixWidths);
+    free(gPrefixLine);
+    gPrefixWidths = NULL;
+    gPrefixLine = NULL;
+    gPrefixCapacity = 0;
+    gPrefixLineCapacity = 0;
+    gPrefixLength = -1;
+    gPrefixFontSize = 0;
+    free(gBreakScratch);
+    gBreakScratch = NULL;
+    gBreakScratchCapacity = 0;
+    gGlyphFontTexture = 0;
+    if (gSdfFont.texture.id != 0) {
+        UnloadFont(gSdfFont);
+        UnloadShader(gSdfShader);
+    }
+    gSdfFont = (Font){0};
+    gSdfShader = (Shader){0};
+    gTextRunDepth = 0;
+}
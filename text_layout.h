@@ -0,0 +1,112 @@
+#ifndef TEXT_LAYOUT_H
+#define TEXT_LAYOUT_H
+
+#include "raylib.h"
+
+/* Measurement and drawing of all canvas text, without allocating. Glyph
+   advances are cached per codepoint and summed unscaled, then scaled and
+   spaced for the font size. With the default font the results match
+   MeasureText exactly. Text passed in is a byte range; it need not be
+   terminated. */
+
+/* Loads a TTF as one distance field atlas that every text size is drawn
+   from, with a shader that keeps edges sharp at any scale. Returns 0 and
+   keeps the current font when the file or shader cannot be loaded. Cached
+   widths measured with the previous font are invalid afterwards. */
+int TextLayout_LoadFont(const char* path);
+
+int TextLayout_MeasureSegment(const char* text, int length, int fontSize);
+
+/* Width of each byte prefix of a line: widths[i] covers line[0..i). A byte
+   inside a multi-byte character counts as the position before it. The array
+   belongs to a one-line cache that is reused while the same line and size are
+   asked for again, and stays valid until the next call. */
+const int* TextLayout_GetLinePrefixWidths(const char* line, int length, int fontSize);
+
+/* Byte offset of the caret for an x position within a line: just past the
+   first character whose right edge lies beyond x. Binary search over the
+   line's prefix widths. */
+int TextLayout_GetIndexFromX(const char* line, int length, int fontSize, int x);
+
+/* Line-start index of a text buffer, with each line's width cached for one
+   font size. Edits keep it in step through TextLayout_InsertLines and
+   TextLayout_DeleteLines, so finding the line that holds a byte offset is a
+   binary search rather than a scan of the text. */
+typedef struct TextLines {
+    int* starts;        /* byte offset where each line begins; starts[0] is 0 */
+    int* widths;        /* width of each line at fontSize, -1 until measured */
+    int count;
+    int capacity;
+    int length;         /* bytes in the indexed text */
+    int fontSize;
+    /* Word-wrapped layout, cached per line and kept for one wrap width and
+       font size. An edit drops only the edited lines' rows; rows of the lines
+       after them are kept and only their first-row numbers are recounted. */
+    int* rowCounts;     /* rows each line wraps into, 0 until wrapped */
+    int** rowBreaks;    /* offsets within the line where its later rows begin */
+    int* firstRows;     /* row each line starts on, valid below rowsValid */
+    int rowsValid;
+    int wrapWidth;      /* 0 when lines are not wrapped */
+    int wrapFontSize;
+} TextLines;
+
+/* Rebuilds the index for text[0..length). Returns 0 when out of memory, in
+   which case the index is left empty. */
+int TextLayout_IndexLines(TextLines* lines, const char* text, int length);
+/* Records that inserted[0..length) was inserted at index. */
+int TextLayout_InsertLines(TextLines* lines, int index, const char* inserted, int length);
+/* Records that bytes [start, end) were removed. */
+void TextLayout_DeleteLines(TextLines* lines, int start, int end);
+/* Makes dest a copy of source, measured widths included. */
+int TextLayout_CopyLines(TextLines* dest, const TextLines* source);
+void TextLayout_FreeLines(TextLines* lines);
+
+/* Line holding byte offset index; an offset just past a newline belongs to
+   the next line. */
+int TextLayout_FindLine(const TextLines* lines, int index);
+int TextLayout_GetLineStart(const TextLines* lines, int line);
+/* Offset of the line's terminating newline, or the text length. */
+int TextLayout_GetLineEnd(const TextLines* lines, int line);
+/* Cached width of a line; lineText points at the line's first byte and is
+   only read when the width has to be measured. */
+int TextLayout_GetLineWidth(TextLines* lines, int line, const char* lineText, int fontSize);
+int TextLayout_IsLineMeasured(const TextLines* lines, int line, int fontSize);
+/* Widest line of a terminated string the index was built from. */
+int TextLayout_GetMaxLineWidth(TextLines* lines, const char* text, int fontSize);
+
+/* Word wrap. Lines break after the whitespace before a word that would pass
+   wrapWidth, or inside a word wider than wrapWidth on its own; a wrap width
+   of 0 leaves every line as one row. Rows are laid out line by line:
+       for (line = TextLayout_PrepareWrap(...); line < lines->count; line++)
+           TextLayout_WrapLine(lines, line, <text of line if not wrapped>);
+   PrepareWrap returns the first line whose rows are not current, which is the
+   first edited line or 0 after the width or size changed. The row queries
+   below need every line laid out. */
+int TextLayout_PrepareWrap(TextLines* lines, int fontSize, int wrapWidth);
+int TextLayout_IsLineWrapped(const TextLines* lines, int line);
+/* Returns the line's row count; lineText is only read when the line is not
+   wrapped yet. */
+int TextLayout_WrapLine(TextLines* lines, int line, const char* lineText);
+int TextLayout_GetRowCount(const TextLines* lines);
+int TextLayout_GetFirstRow(const TextLines* lines, int line);
+/* Line that row belongs to. */
+int TextLayout_FindRowLine(const TextLines* lines, int row);
+/* Row holding byte offset index; an offset at a wrap point belongs to the row
+   that begins there. */
+int TextLayout_FindRow(const TextLines* lines, int index);
+int TextLayout_GetRowStart(const TextLines* lines, int row);
+/* Start of the next row of the same line, or the line's end. */
+int TextLayout_GetRowEnd(const TextLines* lines, int row);
+
+/* Stand-ins for MeasureText and DrawText using the loaded font. */
+int TextLayout_MeasureText(const char* text, int fontSize);
+void TextLayout_DrawText(const char* text, int x, int y, int fontSize, Color color);
+void TextLayout_DrawSegment(const char* text, int length, float x, float y, int fontSize, Color color);
+/* Brackets a run of draw calls so the distance field shader is bound once
+   for all of them rather than per call. Runs may nest. */
+void TextLayout_BeginText(void);
+void TextLayout_EndText(void);
+
+void TextLayout_Shutdown(void);
+
+#endif /* TEXT_LAYOUT_H */